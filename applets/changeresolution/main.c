@@ -351,14 +351,30 @@ int main(int argc, char **argv)
 	gchar *gappman_confpath = SYSCONFDIR "/conf.xml";
 	gchar *text;
 	int window_width, window_height;
+	gint snapshot_width, snapshot_height;
+	gboolean snapshot_loaded;
 
 	gtk_init(&argc, &argv);
 	screen = gdk_screen_get_default();
 	window_width = gdk_screen_get_width(screen);
 	window_height = gdk_screen_get_height(screen);
 
+	// Use the configuration gappman is running with if it published one
+	snapshot_loaded = gm_load_conf_snapshot() == GM_SUCCESS;
+	if (snapshot_loaded)
+	{
+		gm_parseconf_get_window_geometry(&snapshot_width, &snapshot_height);
+		if (snapshot_width > 0 && snapshot_height > 0)
+		{
+			window_width = snapshot_width;
+			window_height = snapshot_height;
+		}
+	}
 #if defined(DEBUG)
-gm_network_get_window_geometry_from_gappman(2103, "localhost", &window_width, &window_height);
+	else
+	{
+		gm_network_get_window_geometry_from_gappman(2103, "localhost", &window_width, &window_height);
+	}
 #endif
 
 	gm_layout_set_window_geometry(window_width, window_height);
@@ -392,20 +408,32 @@ gm_network_get_window_geometry_from_gappman(2103, "localhost", &window_width, &w
 	// Remove border
 	gtk_window_set_decorated(GTK_WINDOW(mainwin), FALSE);
 
-	// get generic fontsize from gappman
-	if (gm_network_get_fontsize_from_gappman(2103, "localhost", &fontsize) ==
-		GM_SUCCESS)
+	if (snapshot_loaded)
 	{
-		gm_layout_set_fontsize(fontsize);
+		programs = gm_get_programs();
+		fontsize = gm_parseconf_get_fontsize();
+		if (fontsize > 0)
+		{
+			gm_layout_set_fontsize(fontsize);
+		}
 	}
-
-	// get configuration file path from gappman
-	if (gm_network_get_confpath_from_gappman(2103, "localhost", &gappman_confpath) ==
-		GM_SUCCESS)
+	else
 	{
-		if (gm_load_conf(gappman_confpath) == GM_SUCCESS)
+		// get generic fontsize from gappman
+		if (gm_network_get_fontsize_from_gappman(2103, "localhost", &fontsize) ==
+			GM_SUCCESS)
+		{
+			gm_layout_set_fontsize(fontsize);
+		}
+
+		// get configuration file path from gappman
+		if (gm_network_get_confpath_from_gappman(2103, "localhost", &gappman_confpath) ==
+			GM_SUCCESS)
 		{
-			programs = gm_get_programs();
+			if (gm_load_conf(gappman_confpath) == GM_SUCCESS)
+			{
+				programs = gm_get_programs();
+			}
 		}
 	}
 
@@ -20,7 +20,8 @@ then
         if test -d "$srcdir/../libs/layout" && \
            test -d "$srcdir/../libs/parseconf" && \
            test -d "$srcdir/../libs/network" && \
-           test -d "$srcdir/../libs/generic"
+           test -d "$srcdir/../libs/generic" && \
+           test -d "$srcdir/../libs/launcher"
         then
                 LIBGM='$(top_srcdir)/../libs'
         fi
@@ -30,8 +31,8 @@ fi
 #where to find the header and library files.
 if test -n "$LIBGM"
 then
-        AC_SUBST([GM_INCLUDES], ["-I$LIBGM/generic -I$LIBGM/layout -I$LIBGM/parseconf -I$LIBGM/network"])
-        AC_SUBST([GM_OBJS], ["$LIBGM/generic/libgm_generic.la $LIBGM/layout/libgm_layout.la $LIBGM/parseconf/libgm_parseconf.la $LIBGM/network/libgm_network.la"])
+        AC_SUBST([GM_INCLUDES], ["-I$LIBGM/generic -I$LIBGM/layout -I$LIBGM/parseconf -I$LIBGM/launcher -I$LIBGM/network"])
+        AC_SUBST([GM_OBJS], ["$LIBGM/generic/libgm_generic.la $LIBGM/layout/libgm_layout.la $LIBGM/parseconf/libgm_parseconf.la $LIBGM/launcher/libgm_launcher.la $LIBGM/network/libgm_network.la"])
 else
         AC_SUBST([GM_INCLUDES], [""])
         AC_SUBST([GM_OBJS], [""])
@@ -58,6 +59,12 @@ then
                   LIBS="$LIBGM $LIBS"],
                 [AC_MSG_ERROR([No libgm_layout found])])
 
+        AC_CHECK_LIB([gm_launcher], [gm_launcher_start],
+                [AC_CHECK_HEADERS([gm_launcher.h])
+                  LIBGM="-lgm_launcher"
+                  LIBS="$LIBGM $LIBS"],
+                [AC_MSG_ERROR([No libgm_launcher found])])
+
         AC_CHECK_LIB([gm_parseconf], [gm_load_conf],
                 [AC_CHECK_HEADERS([gm_parseconf.h])
                   LIBGM="-lgm_parseconf"
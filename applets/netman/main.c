@@ -20,6 +20,7 @@
 #include <dbus/dbus-glib.h>
 #include <string.h>
 #include <gm_layout.h>
+#include <gm_launcher.h>
 #include "parseconf.h"
 
 static GtkWidget *main_button = NULL;
@@ -76,35 +77,25 @@ static void check_status(GPid pid, gint status, nm_elements * elt)
 
 static gint exec_program(nm_elements * elt)
 {
-	GError *error;
-	int i;
-	char **args;
 	GPid childpid;
 
-	error = NULL;
-
-	// We keep the conversion to execv format in elt->argv
-	// to prevent converting it each time we exec the program
-	if (elt->argv == NULL)
+	// We keep the launcher in elt->launcher to prevent
+	// building the argument vector each time we exec the program
+	if (elt->launcher == NULL)
 	{
-		args = (char **)malloc((elt->numArguments + 2) * sizeof(char *));
-		args[0] = (char *)elt->exec;
-		for (i = 0; i < elt->numArguments; i++)
+		elt->launcher = gm_launcher_create((const gchar *) elt->exec,
+										   elt->args, elt->numArguments);
+		if (elt->launcher == NULL)
 		{
-			args[i + 1] = elt->args[i];
+			return FALSE;
 		}
-		args[i + 1] = NULL;
-		elt->argv = args;
+		gm_launcher_set_flags(elt->launcher, GM_LAUNCHER_SEARCH_PATH
+							  | GM_LAUNCHER_STDOUT_TO_DEV_NULL
+							  | GM_LAUNCHER_STDERR_TO_DEV_NULL);
 	}
 
-	if (!g_spawn_async(NULL, elt->argv, NULL,
-					   G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDOUT_TO_DEV_NULL
-					   | G_SPAWN_STDERR_TO_DEV_NULL,
-					   NULL, NULL, &childpid, &error))
+	if (gm_launcher_start(elt->launcher, &childpid) != GM_SUCCESS)
 	{
-		g_warning("Error executing program: %s", error->message);
-		g_error_free(error);
-		error = NULL;
 		return FALSE;
 	}
 
@@ -36,7 +36,7 @@ struct nm_element *create_nm_element(nm_elements * prev)
 	elt->exec = NULL;
 	elt->next = prev;
 	elt->args = NULL;
-	elt->argv = NULL;
+	elt->launcher = NULL;
 	elt->status = 1;			// default fail
 	elt->pid = -1;
 	elt->image_success = NULL;
@@ -170,10 +170,7 @@ void nm_free_elements(nm_elements * elt)
 			free(elt->args[i]);
 			free(elt->args);
 
-			for (i = 0; elt->argv[i] != NULL; i++)
-			{
-				free(elt->argv[i]);
-			}
+			gm_launcher_free(elt->launcher);
 
 			next = elt->next;
 			free(elt);
@@ -13,6 +13,7 @@
 
 #include <gtk/gtk.h>
 #include <libxml/xmlreader.h>
+#include <gm_launcher.h>
 
 /**
 * \struct nm_element
@@ -30,8 +31,8 @@ struct nm_element
 	const xmlChar *logofail;	///< absolute path to image file
 	char **args;				///< array of strings containing arguments
 								// that need to be passed to the executable
-	char **argv;				///< Same as args but suited for use with
-								// execv
+	gm_launcher *launcher;		///< launcher for exec and args, created
+								// when exec is started the first time
 	int numArguments;			///< will hold the total amount of elements
 								// in the args array
 	int pid;					///< should hold the process ID of the
@@ -477,22 +477,26 @@ int main(int argc, char **argv)
 							 NULL, quit_program_callback);
 	}
 
-	status = gm_network_get_confpath_from_gappman(2103, "localhost", &gappman_confpath);
-	if (status == GM_SUCCESS)
+	// Use the configuration gappman is running with if it published one
+	if (gm_load_conf_snapshot() != GM_SUCCESS)
 	{
- 		///< \todo replace gm_load_conf with gm_network_get_programs_from_gappman
-  	if (gm_load_conf(gappman_confpath) != GM_SUCCESS)
+		status = gm_network_get_confpath_from_gappman(2103, "localhost", &gappman_confpath);
+		if (status == GM_SUCCESS)
 		{
-			msg = g_strdup_printf("Could not load gappman configuration file:\n%s\n", gappman_confpath);
-			gm_layout_show_error_dialog(msg, NULL, quit_program_callback);
-			g_free(msg);
+			///< \todo replace gm_load_conf with gm_network_get_programs_from_gappman
+			if (gm_load_conf(gappman_confpath) != GM_SUCCESS)
+			{
+				msg = g_strdup_printf("Could not load gappman configuration file:\n%s\n", gappman_confpath);
+				gm_layout_show_error_dialog(msg, NULL, quit_program_callback);
+				g_free(msg);
+			}
+		}
+		else
+		{
+			gm_layout_show_error_dialog
+				("Could not retrieve gappman configuration file\n",
+				 NULL, quit_program_callback);
 		}
-	}
-	else
-	{
-		gm_layout_show_error_dialog
-			("Could not retrieve gappman configuration file\n",
-			 NULL, quit_program_callback);
 	}
 
 /* 
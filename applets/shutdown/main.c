@@ -21,6 +21,7 @@
 #include <gm_parseconf.h>
 #include <gm_layout.h>
 #include <gm_network.h>
+#include <gm_launcher.h>
 
 static int WINDOWED = 0;
 
@@ -47,56 +48,47 @@ static void quit_program(GtkWidget * dummy, GdkEvent * event)
   }
 }
 
-///< \todo check if startprogram can be replaced by a generic startprograms in a lib. BTW: Appmanager also uses a startprogram function.
+/**
+* \brief Starts the program of elt. The program is searched in PATH if exec does not contain a slash.
+* The programs started by gappman are stopped first, so they can exit cleanly before the system goes down.
+* \param widget pointer to GtkWidget of the button that was pressed to start the program
+* \param elt pointer to the menu_element structure for the program that needs to be started
+* \return gboolean FALSE if the program could not be started, TRUE otherwise.
+*/
 static gboolean startprogram(GtkWidget * widget, gm_menu_element *elt)
 {
-	char **args;
-	gint number_of_arguments;
-	int i;
-	__pid_t childpid;
-	FILE *fp;
-
-	/**
-      Create argument list. First element should be the filename
-      of the executable and last element needs to be NULL.
-      see man exec for more details
-    */
-	number_of_arguments = gm_menu_element_get_amount_of_arguments(elt);
-	args = (char **)malloc((number_of_arguments + 2) * sizeof(char *));
-	args[0] = (char *)elt->exec;
-	for (i = 0; i < number_of_arguments; i++)
+	gm_launcher *launcher;
+	GmReturnCode status;
+	int killed;
+
+	launcher = gm_launcher_create_from_menu_element(elt);
+	if (launcher == NULL)
 	{
-		args[i + 1] = elt->args[i];
+		return FALSE;
 	}
-	args[i + 1] = NULL;
+	gm_launcher_set_flags(launcher, GM_LAUNCHER_SEARCH_PATH);
 
-	fp = fopen((char *)elt->exec, "r");
-	if (fp)
+	// Disable button
+	gtk_widget_set_sensitive(GTK_WIDGET(widget), FALSE);
+
+	if (gm_network_stop_processes_in_gappman(2103, "localhost", &killed) != GM_SUCCESS)
+	{
+		g_warning("Could not stop the programs started by gappman");
+	}
+	else if (killed > 0)
 	{
-		// Disable button
-		gtk_widget_set_sensitive(GTK_WIDGET(widget), FALSE);
+		g_warning("%d programs started by gappman had to be killed", killed);
+	}
 
-		(void)fclose(fp);
+	status = gm_launcher_start(launcher, NULL);
+	gm_launcher_free(launcher);
 
-		childpid = fork();
-		if (childpid == 0)
-		{
-			(void)execvp((char *)elt->exec, args);
-			_exit(0);
-		}
-		else if (childpid < 0)
-		{
-			g_warning("Failed to fork!\n");
-			return FALSE;
-		}
-	}
-	else
+	if (status != GM_SUCCESS)
 	{
-		g_warning("File: %s not found!\n", (char *)elt->exec);
+		gtk_widget_set_sensitive(GTK_WIDGET(widget), TRUE);
 		return FALSE;
 	}
 
-	free(args);
 	return TRUE;
 }
 
@@ -23,6 +23,7 @@
 #include <math.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <signal.h>
 #include <getopt.h>
 #include <errno.h>
 #include <sys/socket.h>
@@ -31,16 +32,43 @@
 #include <gm_layout.h>
 #include <gm_generic.h>
 #include <gm_keybinder.h>
+#include <gm_launcher.h>
+#include <gm_zygote.h>
 #include "listener.h"
 #include "appmanager_panel.h"
 #include "appmanager_buttonmenu.h"
+#include "appmanager_autostart.h"
+#include "appmanager_supervisor.h"
+#include "appmanager_prefetch.h"
+#include "appmanager_output.h"
+#include "appmanager_resolution.h"
+#include "appmanager_focus.h"
+#include "appmanager_events.h"
 
 #ifndef SYSCONFDIR
 #define SYSCONFDIR "/etc/gappman"
 #endif
 
-static struct process_info *started_apps;      ///< holds the currently started apps
+#define STOP_TIMEOUT 5000 ///< milliseconds programs get to exit after SIGTERM before they are killed
+#define STOP_KILL_TIMEOUT 1000 ///< milliseconds to wait for killed programs to be reaped
+
 static gm_menu *programs;              ///< list of all programs gappman manages.
+static GHashTable *launchers;          ///< launchers of started programs indexed by menu_element
+static guint64 program_cpus = 0;       ///< CPUs started programs run on if gappman is pinned to housekeeping CPUs
+static gboolean stopping = FALSE;      ///< TRUE while appmanager_stop_processes waits for programs to exit
+static GList *stop_waiters = NULL;     ///< stop_waiter structures of the callers waiting for the programs to exit
+static guint stop_source = 0;          ///< source id of the deadline of the programs being stopped
+static guint stop_killed = 0;          ///< amount of programs killed by the current stop
+static GSList *stop_spared = NULL;     ///< process IDs of the programs that asked to stop the others, they are not stopped
+
+/**
+* \brief caller of appmanager_stop_processes waiting for the programs to exit
+*/
+struct stop_waiter
+{
+	STOP_FUNC done;	///< called once the programs exited
+	gpointer user_data;	///< passed to done
+};
 
 static struct metadata *config; ///< holds the configuration data used by gappman
 
@@ -56,6 +84,20 @@ void handle_key_event(const char *keystring, void *user_data)
 	gtk_window_present((GtkWindow*) user_data);
 }
 
+/**
+* \brief publishes the configuration gappman is running with so applets can
+* map it instead of parsing the configuration file themselves.
+*/
+static void publish_configuration()
+{
+	if (gm_parseconf_publish_snapshot(config->conffile, gm_layout_get_fontsize(),
+									  config->window_width,
+									  config->window_height) != GM_SUCCESS)
+	{
+		g_warning("Could not publish configuration snapshot");
+	}
+}
+
 void appmanager_update_resolution(gchar * programname, int width, int height)
 {
 	gm_menu_element *elt = NULL;
@@ -73,188 +115,454 @@ void appmanager_update_resolution(gchar * programname, int width, int height)
 		config->screen_width = width;
 		config->screen_height = height;
 	}
+	publish_configuration();
 }
 
-struct process_info *appmanager_get_started_apps()
+/**
+* \brief queues a switch of the screen resolution. The screen is switched
+* once the requests settled, so launching and exiting programs in quick
+* succession does not switch back and forth.
+* \param width screen width, -1 for gappman's resolution
+* \param height screen height, -1 for gappman's resolution
+*/
+static void restore_resolution(gint width, gint height)
 {
-	return started_apps;
+	if (width > 0 && height > 0)
+	{
+		appmanager_resolution_request(width, height);
+	}
+	else
+	{
+		appmanager_resolution_request(config->screen_width, config->screen_height);
+	}
 }
 
+static void stop_finished();
+static guint count_stopping();
+
 /**
-* \brief Checks if the application is still responding and enables the button when it doesn't respond.
-* \param local_appw process_info structure which holds the application's button widget and the PID of the running application.
-* \return TRUE if application responds, FALSE if not.
+* \brief Called when a started application exits. Enables the application's
+* button, removes the application from the process table and restores the
+* resolution of the most recently started application that is still running.
+* If the application is going to be restarted its button stays disabled and
+* the resolution is kept, so the restart does not switch resolutions. While
+* all programs are being stopped the resolution is restored only once, when
+* the last program exited.
+* \param pid process ID of the application that exited
+* \param status exit status of the application as returned by waitpid
+* \param local_appw process_info structure which holds the application's button widget and the PID of the exited application.
 */
-static gint check_app_status(struct process_info *local_appw)
+static void process_exited(GPid pid, gint status, struct process_info *local_appw)
 {
-	struct process_info *tmp;
-	gm_menu_element *elt;
+	gint width;
+	gint height;
+	gboolean restarting = FALSE;
+
+	local_appw->status = status;
+	g_spawn_close_pid(pid);
 
-	waitpid(local_appw->PID, &(local_appw->status), WNOHANG);
+	appmanager_latency_process_exited(pid);
+	appmanager_sampler_process_exited(pid);
+	appmanager_events_process_exited(pid, status);
 
-	// Check if process is still running by sending a 0 signal
-	// and check if process does not respond
-	if (kill(local_appw->PID, 0) == -1)
+	appmanager_autostart_process_exited(local_appw->menu_elt, status);
+
+	if (!stopping)
 	{
-		if (GTK_IS_WIDGET(local_appw->menu_elt->widget))
-		{
-			// Enable button
-			gtk_widget_set_sensitive(GTK_WIDGET(local_appw->menu_elt->widget), TRUE);
-		}
+		restarting = appmanager_supervisor_process_exited(local_appw->menu_elt, status);
+	}
+
+	// the buttons may be destroyed already if gappman is quitting
+	if (!restarting && gtk_main_level() > 0
+		&& GTK_IS_WIDGET(local_appw->menu_elt->widget))
+	{
+		// Enable button
+		gtk_widget_set_sensitive(GTK_WIDGET(local_appw->menu_elt->widget), TRUE);
+	}
+
+	if (appmanager_processes_remove(local_appw, &width, &height) && !restarting
+		&& !stopping)
+	{
+		restore_resolution(width, height);
+	}
+
+	if (stopping && count_stopping() == 0)
+	{
+		stop_finished();
+	}
+}
+
+/**
+* \brief signals a program. Programs run in a process group of their own, so
+* the programs a wrapper started get the signal as well.
+*/
+static void signal_process(struct process_info *proc, gpointer signum)
+{
+	if (g_slist_find(stop_spared, GINT_TO_POINTER(proc->PID)) != NULL)
+	{
+		return;
+	}
+	if (kill(-proc->PID, GPOINTER_TO_INT(signum)) == 0)
+	{
+		return;
+	}
+	// the program may have moved itself to another process group
+	if (errno == ESRCH && kill(proc->PID, GPOINTER_TO_INT(signum)) == 0)
+	{
+		return;
+	}
+	if (errno != ESRCH)
+	{
+		g_warning("Could not signal %s (%d): %s", proc->menu_elt->name,
+				  proc->PID, g_strerror(errno));
+	}
+}
+
+static void count_process(struct process_info *proc, guint *amount)
+{
+	if (g_slist_find(stop_spared, GINT_TO_POINTER(proc->PID)) == NULL)
+	{
+		(*amount)++;
+	}
+}
+
+/**
+* \brief returns the amount of programs appmanager_stop_processes stops,
+* which are all programs except the ones that asked to stop them
+*/
+static guint count_stopping()
+{
+	guint amount = 0;
+
+	appmanager_processes_foreach((GFunc) count_process, &amount);
+	return amount;
+}
+
+/**
+* \brief keeps the program requester belongs to running, so e.g. the
+* shutdown applet can still shut down the system after the other programs
+* were stopped
+* \param requester process ID of the process that asked to stop the programs,
+* 0 if unknown
+*/
+static void spare_requester(GPid requester)
+{
+	struct process_info *proc;
+
+	if (requester <= 0)
+	{
+		return;
+	}
+
+	proc = appmanager_processes_lookup_descendant(requester);
+	if (proc != NULL && g_slist_find(stop_spared, GINT_TO_POINTER(proc->PID)) == NULL)
+	{
+		stop_spared = g_slist_prepend(stop_spared, GINT_TO_POINTER(proc->PID));
+	}
+}
+
+/**
+* \brief ends appmanager_stop_processes and tells everybody who asked to
+* stop the programs how many had to be killed
+*/
+static void stop_finished()
+{
+	GList *waiters;
+	GList *l;
+	struct stop_waiter *waiter;
+
+	if (stop_source != 0)
+	{
+		g_source_remove(stop_source);
+		stop_source = 0;
+	}
+
+	restore_resolution(-1, -1);
+	stopping = FALSE;
+	g_slist_free(stop_spared);
+	stop_spared = NULL;
+
+	waiters = g_list_reverse(stop_waiters);
+	stop_waiters = NULL;
+	for (l = waiters; l != NULL; l = l->next)
+	{
+		waiter = l->data;
+		waiter->done(stop_killed, waiter->user_data);
+		g_free(waiter);
+	}
+	g_list_free(waiters);
+}
+
+/**
+* \brief kills the programs that did not exit within STOP_TIMEOUT after
+* SIGTERM, or gives up on them if they were killed already
+*/
+static gboolean stop_deadline_passed(gpointer data)
+{
+	stop_source = 0;
+
+	if (stop_killed == 0)
+	{
+		stop_killed = count_stopping();
+		g_warning("%u programs did not exit within %d ms, killing them",
+				  stop_killed, STOP_TIMEOUT);
+		appmanager_processes_foreach((GFunc) signal_process, GINT_TO_POINTER(SIGKILL));
+		stop_source = g_timeout_add(STOP_KILL_TIMEOUT, stop_deadline_passed, NULL);
+	}
+	else
+	{
+		g_warning("%u programs could not be killed", count_stopping());
+		stop_finished();
+	}
+	return FALSE;
+}
+
+void appmanager_stop_processes(GPid requester, STOP_FUNC done, gpointer user_data)
+{
+	struct stop_waiter *waiter;
+	guint amount;
 
-		// remove local_appw from list
-		if ((local_appw->prev == NULL) && (local_appw->next == NULL))
+	// a requester that joins a running stop may have got SIGTERM already
+	spare_requester(requester);
+	amount = count_stopping();
+	if (!stopping && amount == 0)
+	{
+		g_slist_free(stop_spared);
+		stop_spared = NULL;
+		done(0, user_data);
+		return;
+	}
+
+	// callers that ask while the programs are being stopped wait for
+	// the same result
+	waiter = g_new(struct stop_waiter, 1);
+	waiter->done = done;
+	waiter->user_data = user_data;
+	stop_waiters = g_list_prepend(stop_waiters, waiter);
+	if (stopping)
+	{
+		// the requester may have been the last program left
+		if (amount == 0)
 		{
-			// local_appw only element in the list,
-			// so we reset the list.
-			started_apps = NULL;
-			// change resolution back to gappman menu resolution
-			gm_res_changeresolution(config->screen_width, config->screen_height);
+			stop_finished();
 		}
-		else
-		{
-			if (local_appw->prev != NULL)
-			{
-				tmp = local_appw->prev;
-				tmp->next = local_appw->next;
-				// we may need to change resolution to
-				// local_appw->prev if local_appw was
-				// last program started
-				elt = tmp->menu_elt;
-			}
+		return;
+	}
+	stopping = TRUE;
+	stop_killed = 0;
 
-			if (local_appw->next != NULL)
-			{
-				tmp = local_appw->next;
-				tmp->prev = local_appw->prev;
-				// local_appw was not the last program
-				// started so we leave resolution unchanged
-				elt = NULL;
-			}
-			else
-			{
-				// local_appw is last element
-				// we therefore need to relocate
-				// the started_apps pointer
-				started_apps = local_appw->prev;
-			}
+	// programs that are stopped should not be restarted
+	appmanager_supervisor_reset();
 
-			if (elt != NULL)
-			{
-				if (elt->app_width > 0 && elt->app_height > 0)
-				{
-					gm_res_changeresolution(elt->app_width, elt->app_height);
-				}
-			}
-		}
+	g_message("Stopping %u programs", amount);
+	appmanager_processes_foreach((GFunc) signal_process, GINT_TO_POINTER(SIGTERM));
+	// process_exited finishes the stop once the last program exited
+	stop_source = g_timeout_add(STOP_TIMEOUT, stop_deadline_passed, NULL);
+}
 
-		// No need for local_appw anymore
-		free(local_appw);
+/**
+* \brief checks if a window belongs to a program. Programs started through a
+* wrapper create their windows from a descendant process.
+* \param pid _NET_WM_PID of the window
+* \param proc process of the program
+* \return TRUE if pid is the program or one of its descendants
+*/
+static gboolean window_of_process(gint pid, struct process_info *proc)
+{
+	return appmanager_processes_lookup_descendant(pid) == proc;
+}
 
-		// Stop glib timer
+/**
+* \brief makes a running program the current program, which switches to its
+* resolution, and raises and focuses its window. A program that is still
+* starting, or whose windows have no _NET_WM_PID, has no window that can be
+* found. It still becomes the current program, so its window gets the right
+* resolution once it appears.
+* \param proc process of the program
+* \return TRUE if a window of the program was found
+*/
+static gboolean activate_program(struct process_info *proc)
+{
+	gulong xwindow;
+	gint width;
+	gint height;
+
+	appmanager_processes_raise(proc);
+	appmanager_processes_get_resolution(&width, &height);
+	restore_resolution(width, height);
+
+	xwindow = gm_keybinder_find_window((WindowMatchFunc) window_of_process, proc);
+	if (xwindow == 0)
+	{
+		g_message("%s is already running but has no window to activate yet",
+				  proc->menu_elt->name);
 		return FALSE;
 	}
-	// Continue glib timer
+
+	gm_keybinder_activate_window(xwindow, gtk_get_current_event_time());
 	return TRUE;
 }
 
 /**
-* \brief Creates an process_info structure
-* \param PID the process ID of the application
-* \param widget pointer to the GtkWidget which belongs to the button of the application
-* \param *elt menu_element of the application the new process_info must be created for 
+* \brief returns the launcher for elt. The launcher is created the first time
+* the program of elt is started.
+* \param elt menu_element of the application
+* \return launcher or NULL if elt has no executable
 */
-static void create_new_process_info_struct(int PID, gm_menu_element *elt)
+static gm_launcher *get_launcher(gm_menu_element *elt)
 {
-	struct process_info *tmp;
-	tmp = (struct process_info *)malloc(sizeof(struct process_info));
-	if (tmp != NULL)
-	{
-		tmp->PID = PID;
-		tmp->menu_elt = elt;
-		tmp->prev = started_apps;
-		tmp->next = NULL;
-		if (started_apps != NULL)
+	gm_launcher *launcher;
+	gm_launch_profile *profile;
+
+	if (launchers == NULL)
+	{
+		launchers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+										  (GDestroyNotify) gm_launcher_free);
+	}
+
+	launcher = g_hash_table_lookup(launchers, elt);
+	if (launcher == NULL)
+	{
+		launcher = gm_launcher_create_from_menu_element(elt);
+		if (launcher != NULL)
 		{
-			started_apps->next = tmp;
+			// lets appmanager_stop_processes signal the program together
+			// with the programs it started
+			gm_launcher_set_flags(launcher, launcher->flags | GM_LAUNCHER_NEW_PROCESS_GROUP);
+			// do not let the program inherit gappman's housekeeping CPUs
+			if (program_cpus != 0 && (elt->profile == NULL || elt->profile->cpus == 0))
+			{
+				profile = elt->profile != NULL ?
+					g_memdup(elt->profile, sizeof(gm_launch_profile)) :
+					gm_launch_profile_create();
+				profile->cpus = program_cpus;
+				gm_launcher_set_profile(launcher, profile);
+				g_free(profile);
+			}
+			g_hash_table_insert(launchers, elt, launcher);
 		}
-		// shift global started_apps pointer so it always points to
-		// last started process
-		started_apps = tmp;
 	}
+	return launcher;
 }
 
 /**
-* \brief Starts the program with any specified arguments by forking and letting the child (fork) start the program
-* \param widget pointer to GtkWidget of the button that was pressed to start the application
+* \brief Starts the program with any specified arguments
 * \param elt pointer to the menu_element structure for the application that needs to be started
-* \return gboolean FALSE if the fork failed or the program's executable could not be found. TRUE if fork succeeded and program was found.
+* \return gboolean FALSE if the program could not be started. TRUE if the program was started.
 */
 static gboolean startprogram(gm_menu_element *elt)
 {
-	char **args;
-	gint number_of_arguments;
-	int i;
-	__pid_t childpid;
-	FILE *fp;
-
-	/**
-      Create argument list. First element should be the filename
-      of the executable and last element needs to be NULL.
-      see man exec for more details
-    */
-	number_of_arguments = gm_menu_element_get_amount_of_arguments(elt);
-	args = (char **)malloc((number_of_arguments + 2) * sizeof(char *));
-	args[0] = (char *)elt->exec;
-	for (i = 0; i < number_of_arguments; i++)
-	{
-		args[i + 1] = elt->args[i];
-	}
-	args[i + 1] = NULL;
-
-	fp = fopen((char *)elt->exec, "r");
-	if (fp)
-	{
-		// Disable button
-		gtk_widget_set_sensitive(elt->widget, FALSE);
+	gm_launcher *launcher;
+	struct process_info *appw;
+	GPid childpid;
+	GmReturnCode status;
+	gint64 requested;
+	gboolean use_zygote;
+	gint output_fd;
+	gint width;
+	gint height;
+
+	// programs started now would not be stopped anymore
+	if (stopping)
+	{
+		g_message("Not starting %s while programs are being stopped", elt->name);
+		return FALSE;
+	}
 
-		fclose(fp);
+	requested = gm_get_monotonic_time();
 
-		if (elt->app_width > 0 && elt->app_height > 0)
+	// Switch to the running instance instead of starting another one
+	if (elt->single_instance == 1)
+	{
+		appw = appmanager_processes_lookup_elt(elt);
+		if (appw != NULL)
 		{
-			gm_res_changeresolution(elt->app_width, elt->app_height);
+			// the running instance is the current program now, even if
+			// it has no window that could be activated yet
+			activate_program(appw);
+			return TRUE;
 		}
+	}
 
-		childpid = fork();
-		if (childpid == 0)
-		{
-			if (execv((char *)elt->exec, args) == -1)
-			{
-				g_warning("Could not execute %s: errno: %d\n", elt->exec,
-						  errno);
-				_exit(1);
-			}
-			_exit(0);
-		}
-		else if (childpid < 0)
+	launcher = get_launcher(elt);
+	if (launcher == NULL)
+	{
+		g_warning("No executable specified for %s", elt->name);
+		return FALSE;
+	}
+
+	// Disable button, single instance programs keep it enabled so
+	// their window can be activated
+	if (elt->single_instance != 1)
+	{
+		gtk_widget_set_sensitive(elt->widget, FALSE);
+	}
+
+	// the program must start at its own resolution, only the switches
+	// back after programs exit are collected
+	if (elt->app_width > 0 && elt->app_height > 0)
+	{
+		appmanager_resolution_request(elt->app_width, elt->app_height);
+		appmanager_resolution_flush();
+	}
+
+	output_fd = appmanager_output_open(elt);
+	gm_launcher_set_output(launcher, output_fd);
+
+	// the zygote can not pass the output pipe to the program
+	use_zygote = elt->zygote == 1 && output_fd == -1 && gm_zygote_is_running();
+	if (use_zygote)
+	{
+		status = gm_zygote_launch(launcher, &childpid);
+		// a zygote that did not reply was stopped, start the program
+		// directly instead
+		if (status != GM_SUCCESS && !gm_zygote_is_running())
 		{
-			g_warning("Failed to fork!\n");
-			return FALSE;
+			use_zygote = FALSE;
 		}
-		else
+	}
+	if (!use_zygote)
+	{
+		status = gm_launcher_start(launcher, &childpid);
+	}
+
+	if (output_fd != -1)
+	{
+		// only the program writes to the pipe
+		close(output_fd);
+	}
+
+	if (status != GM_SUCCESS)
+	{
+		gtk_widget_set_sensitive(elt->widget, TRUE);
+		// restore the resolution of the last started program or gappman
+		if (elt->app_width > 0 && elt->app_height > 0)
 		{
-			create_new_process_info_struct(childpid, elt);
-			g_timeout_add(1000, (GSourceFunc) check_app_status,
-						  (gpointer) started_apps);
+			appmanager_processes_get_resolution(&width, &height);
+			restore_resolution(width, height);
 		}
+		return FALSE;
+	}
+
+	// glib or the zygote reaps the child and calls process_exited
+	// as soon as it exits
+	appw = appmanager_processes_add(childpid, elt);
+	appmanager_latency_launched(childpid, elt, requested);
+	appmanager_supervisor_process_started(elt);
+	appmanager_prefetch_launched(childpid, elt);
+	appmanager_sampler_process_started(childpid, elt);
+	appmanager_events_process_started(childpid, elt, requested);
+	if (use_zygote)
+	{
+		gm_zygote_child_watch_add(childpid, (GChildWatchFunc) process_exited,
+								  (gpointer) appw);
 	}
 	else
 	{
-		g_warning("File: %s not found!\n", (char *)elt->exec);
-		return FALSE;
+		g_child_watch_add(childpid, (GChildWatchFunc) process_exited,
+						  (gpointer) appw);
 	}
 
-	free(args);
 	return TRUE;
 }
 
@@ -295,19 +603,11 @@ static void usage()
 }
 
 /**
-* \brief Check all elements in elts if the integer autostart is set to 1 and start the
-*  corresponding program
+* \brief quits the main loop gappman waits in for its programs to exit
 */
-static void autostartprograms(gm_menu *dish)
+static void processes_stopped(guint killed, GMainLoop *loop)
 {
-	int i;
-	for(i = 0; i < dish->amount_of_elements; i++)
-	{
-		if (dish->elts[i]->autostart == 1)
-		{
-			startprogram(dish->elts[i]);
-		}
-	}
+	g_main_loop_quit(loop);
 }
 
 /**
@@ -367,6 +667,7 @@ int main(int argc, char **argv)
 	Display *Xdisplay;
 	Window Xwindow;
 	gchar* popup_key = NULL;
+	GMainLoop *stop_loop;
 
 	// Needs to be called before any another glib function
 	if (!g_thread_supported())
@@ -437,18 +738,39 @@ int main(int argc, char **argv)
 
 	gm_res_init();
 
-	/** INIT */
-	started_apps = NULL;
-
 	/** Load configuration elements */
 	gm_load_conf(config->conffile);
 	programs = gm_get_programs();
 	actions = gm_get_actions();
 	panel = gm_get_panel();
 
+	// Start the zygote before gappman builds its UI so it inherits as
+	// little as possible
+	if (gm_parseconf_get_zygote())
+	{
+		if (gm_zygote_start(gm_parseconf_get_zygote_preload()) != GM_SUCCESS)
+		{
+			g_warning("Could not start zygote, programs will be started by gappman");
+		}
+	}
+
+	// Pin gappman to the housekeeping CPUs. This includes the threads that
+	// parsed the conf.d fragments, threads created afterwards, like those
+	// of the panel applets, inherit this. The zygote was started before and
+	// runs on all CPUs.
+	if (gm_parseconf_get_housekeeping_cpus() != 0)
+	{
+		program_cpus = gm_launcher_get_cpus();
+		if (gm_launcher_set_cpus(gm_parseconf_get_housekeeping_cpus()) != GM_SUCCESS)
+		{
+			program_cpus = 0;
+		}
+	}
+
 	screen = gdk_screen_get_default();
 	config->screen_width = gdk_screen_get_width(screen);
 	config->screen_height = gdk_screen_get_height(screen);
+	appmanager_resolution_init(config->screen_width, config->screen_height);
 
 	if (config->window_width == -1)
 		config->window_width = config->screen_width;
@@ -534,13 +856,19 @@ int main(int argc, char **argv)
 	gtk_container_add(GTK_CONTAINER(mainwin), vbox);
 	gtk_widget_show(vbox);
 
+	publish_configuration();
+
 #if !defined(NO_LISTENER)
 	gappman_start_listener(mainwin);
 #else
 	g_warning("Gappman compiled without network support");
 #endif
 
-	autostartprograms(programs);
+	appmanager_supervisor_init(startprogram);
+	appmanager_prefetch_init(gm_parseconf_get_prefetch_budget());
+	appmanager_sampler_init(gm_parseconf_get_sample_interval());
+	appmanager_autostart_start(programs, gm_parseconf_get_autostart_concurrency(),
+							   startprogram);
 
 	popup_key = gm_parseconf_get_popupkey();
 	if( popup_key == NULL ) {
@@ -548,6 +876,8 @@ int main(int argc, char **argv)
 	}
   gm_keybinder_init();
   gm_keybinder_bind(popup_key, handle_key_event, mainwin);
+	appmanager_latency_init();
+	appmanager_focus_init(restore_resolution);
 
 	gtk_widget_show(mainwin);
 
@@ -556,11 +886,37 @@ int main(int argc, char **argv)
 	gdk_threads_leave();
 
 	g_message("Closing up.");
+	gm_parseconf_remove_snapshot();
 	appmanager_stop_panel(panel);
 #if !defined(NO_LISTENER)
 	gappman_close_listener();
 #endif
 	
+	appmanager_supervisor_stop();
+	appmanager_prefetch_stop();
+	appmanager_autostart_stop();
+	appmanager_focus_stop();
+	// the zygote must still be running to report its programs exited
+	stop_loop = g_main_loop_new(NULL, FALSE);
+	appmanager_stop_processes(0, (STOP_FUNC) processes_stopped, stop_loop);
+	if (stopping)
+	{
+		g_main_loop_run(stop_loop);
+	}
+	g_main_loop_unref(stop_loop);
+	// switch back to gappman's resolution before quitting
+	appmanager_resolution_flush();
+	appmanager_resolution_free();
+	gm_zygote_stop();
+	appmanager_output_free();
+	appmanager_sampler_free();
+	appmanager_latency_free();
+	appmanager_events_free();
+	appmanager_processes_free();
+	if (launchers != NULL)
+	{
+		g_hash_table_destroy(launchers);
+	}
 	g_free(config);
 	gm_menu_free(programs);
 	gm_menu_free(actions);
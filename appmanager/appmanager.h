@@ -13,22 +13,10 @@
 
 #include <gtk/gtk.h>
 #include <gm_parseconf.h>
-
-/**
-* \brief Struct that holds all relevant info about started applications
-*/
-struct process_info
-{
-	int PID;					///< Process ID of running app (child
-								// replaced through execvp)
-	int status;					///< Process status which can be either
-								// running, sleeping, waiting, stopped, or
-								// zombie
-	gm_menu_element *menu_elt;	///< Pointer to menu_element structure of 
-									// started application
-	struct process_info *prev;	///< Pointer to previous process_info
-	struct process_info *next;	///< Pointer to next process_info
-};
+#include "appmanager_processes.h"
+#include "appmanager_latency.h"
+#include "appmanager_output.h"
+#include "appmanager_sampler.h"
 
 /**
 * \brief Struct that holds all layout/window related information
@@ -44,12 +32,6 @@ struct metadata
   gint window_height;
 };
 
-/**
-* \brief Returns the started applications.
-* \return pointer to the process_info struct
-*/
-struct process_info *appmanager_get_started_apps();
-
 /**
 * \brief updates the resolution for gappman or any other program
 * \param programname string holding the name of the program to update. If NULL the default resolution for gappman is updated
@@ -58,6 +40,32 @@ struct process_info *appmanager_get_started_apps();
 */
 void appmanager_update_resolution(gchar * programname, int width, int height);
 
+/**
+* \brief called when appmanager_stop_processes finished
+* \param killed amount of programs that had to be killed
+* \param user_data data passed to appmanager_stop_processes
+*/
+typedef void (*STOP_FUNC) (guint killed, gpointer user_data);
+
+/**
+* \brief stops all programs started by gappman. All programs get SIGTERM at
+* once and share a single deadline to exit, after which the remaining
+* programs are killed. The signals are sent to the process group of each
+* program, so they reach the programs a wrapper started too. The screen is
+* switched back to gappman's resolution. Programs are not restarted by their
+* restart policy and no programs are started until the stop finished.
+* Returns right away, done is called from the main loop once all programs
+* exited. Callers that ask while the programs are being stopped get the
+* result of the running stop. The program the requester belongs to is not
+* stopped, so it can finish what it asked the stop for, e.g. shutting down.
+* \param requester process ID of the process asking to stop the programs, 0
+* if unknown
+* \param done function called when all programs exited, may be called
+* before this function returns if no programs are running
+* \param user_data passed to done
+*/
+void appmanager_stop_processes(GPid requester, STOP_FUNC done, gpointer user_data);
+
 /**
 * \brief Returns the metadata from gappman
 * \return pointer to the metadata struct
@@ -0,0 +1,421 @@
+/**
+ * \file appmanager_autostart.c
+ * \brief starts the autostart programs in dependency order
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#include <string.h>
+#include <sys/wait.h>
+#include "appmanager_autostart.h"
+
+#define AUTOSTART_READY_TIMEOUT 30000 ///< milliseconds after which a program that is not ready is considered ready
+#define AUTOSTART_POLL_INTERVAL 100 ///< milliseconds between checks of a file readiness probe
+
+/**
+* States of an autostart program
+*/
+typedef enum job_states
+{
+	JOB_WAITING,	///< waiting for the program it depends on or a free slot
+	JOB_DELAYED,	///< waiting for its delay to expire
+	JOB_STARTING,	///< started but not yet ready
+	JOB_READY,	///< ready, programs depending on it may start
+	JOB_FAILED	///< could not be started or failed its readiness probe
+} JobState;
+
+/**
+* Readiness probes
+*/
+typedef enum probe_types
+{
+	PROBE_STARTED,	///< ready as soon as the program is started
+	PROBE_EXIT,	///< ready when the program exits successfully
+	PROBE_FILE	///< ready when a file exists
+} ProbeType;
+
+/**
+* \brief holds the scheduling state of a single autostart program
+*/
+struct autostart_job
+{
+	gm_menu_element *elt;	///< menu element of the program
+	struct autostart_job *after;	///< job that must be ready before this job starts
+	JobState state;	///< current state of the job
+	ProbeType probe;	///< readiness probe of the program
+	const gchar *probe_file;	///< file that must exist for PROBE_FILE
+	guint source;	///< source id of the delay or probe timer
+	guint timeout_source;	///< source id of the readiness timeout
+	gdouble started;	///< seconds since autostart began at which the program was started
+};
+
+static GList *jobs = NULL;	///< autostart jobs in configuration file order
+static gint max_concurrency = AUTOSTART_DEFAULT_CONCURRENCY;
+static gint busy = 0;	///< amount of delayed and starting jobs
+static AUTOSTART_FUNC start_program = NULL;
+static GTimer *timer = NULL;	///< measures the time since autostart began
+static guint schedule_source = 0;	///< source id of a pending schedule
+
+static gboolean schedule(gpointer data);
+
+static void queue_schedule()
+{
+	if (schedule_source == 0)
+	{
+		schedule_source = g_idle_add(schedule, NULL);
+	}
+}
+
+static void remove_sources(struct autostart_job *job)
+{
+	if (job->source != 0)
+	{
+		g_source_remove(job->source);
+		job->source = 0;
+	}
+	if (job->timeout_source != 0)
+	{
+		g_source_remove(job->timeout_source);
+		job->timeout_source = 0;
+	}
+}
+
+/**
+* \brief marks job as finished and schedules the jobs that may start now
+* \param job job that finished
+* \param state JOB_READY or JOB_FAILED
+*/
+static void job_finished(struct autostart_job *job, JobState state)
+{
+	gdouble now;
+
+	remove_sources(job);
+	job->state = state;
+	busy--;
+
+	now = g_timer_elapsed(timer, NULL);
+	if (state == JOB_READY)
+	{
+		g_message("autostart: %s ready at %.3f s (%.3f s after start)",
+				  job->elt->name, now, now - job->started);
+	}
+	else
+	{
+		g_warning("autostart: %s failed at %.3f s", job->elt->name, now);
+	}
+
+	queue_schedule();
+}
+
+static gboolean poll_file(struct autostart_job *job)
+{
+	if (g_file_test(job->probe_file, G_FILE_TEST_EXISTS))
+	{
+		job->source = 0;
+		job_finished(job, JOB_READY);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean ready_timeout(struct autostart_job *job)
+{
+	g_warning("autostart: %s not ready after %d ms, continuing",
+			  job->elt->name, AUTOSTART_READY_TIMEOUT);
+	job->timeout_source = 0;
+	job_finished(job, JOB_READY);
+	return FALSE;
+}
+
+static void launch(struct autostart_job *job)
+{
+	job->state = JOB_STARTING;
+	job->started = g_timer_elapsed(timer, NULL);
+
+	g_message("autostart: starting %s at %.3f s", job->elt->name, job->started);
+
+	if (!start_program(job->elt))
+	{
+		job_finished(job, JOB_FAILED);
+		return;
+	}
+
+	switch (job->probe)
+	{
+	case PROBE_STARTED:
+		job_finished(job, JOB_READY);
+		return;
+	case PROBE_FILE:
+		job->source = g_timeout_add(AUTOSTART_POLL_INTERVAL,
+									(GSourceFunc) poll_file, job);
+		break;
+	case PROBE_EXIT:
+		break;
+	}
+
+	job->timeout_source = g_timeout_add(AUTOSTART_READY_TIMEOUT,
+										(GSourceFunc) ready_timeout, job);
+}
+
+static gboolean delay_expired(struct autostart_job *job)
+{
+	job->source = 0;
+	launch(job);
+	return FALSE;
+}
+
+/**
+* \brief finds the dependency cycle a waiting job waits for and returns the
+* job on that cycle that comes first in the configuration file
+* \param job waiting job
+* \return job on the cycle or NULL if job does not wait for a cycle
+*/
+static struct autostart_job *find_cycle(struct autostart_job *job)
+{
+	struct autostart_job *first;
+	struct autostart_job *iter;
+	guint steps;
+
+	// after as many steps as there are jobs, a chain of waiting jobs
+	// must have entered its cycle
+	for (steps = g_list_length(jobs); steps > 0; steps--)
+	{
+		if (job->state != JOB_WAITING || job->after == NULL)
+		{
+			return NULL;
+		}
+		job = job->after;
+	}
+	if (job->state != JOB_WAITING)
+	{
+		return NULL;
+	}
+
+	first = job;
+	for (iter = job->after; iter != job; iter = iter->after)
+	{
+		if (g_list_index(jobs, iter) < g_list_index(jobs, first))
+		{
+			first = iter;
+		}
+	}
+	return first;
+}
+
+/**
+* \brief starts all jobs whose dependency is ready, as long as there are free
+* slots. Jobs whose dependency failed are not started.
+*/
+static gboolean schedule(gpointer data)
+{
+	struct autostart_job *job;
+	struct autostart_job *blocked;
+	struct autostart_job *cycle;
+	gboolean skipped;
+	GList *l;
+
+	schedule_source = 0;
+
+	while (1)
+	{
+		blocked = NULL;
+		skipped = FALSE;
+		for (l = jobs; l != NULL && busy < max_concurrency; l = l->next)
+		{
+			job = l->data;
+			if (job->state != JOB_WAITING)
+			{
+				continue;
+			}
+
+			if (job->after != NULL && job->after->state == JOB_FAILED)
+			{
+				g_warning("autostart: not starting %s as %s failed",
+						  job->elt->name, job->after->elt->name);
+				job->state = JOB_FAILED;
+				skipped = TRUE;
+				continue;
+			}
+
+			if (job->after != NULL && job->after->state != JOB_READY)
+			{
+				if (blocked == NULL)
+				{
+					blocked = job;
+				}
+				continue;
+			}
+
+			busy++;
+			if (job->elt->autostart_delay > 0)
+			{
+				job->state = JOB_DELAYED;
+				job->source = g_timeout_add(job->elt->autostart_delay,
+											(GSourceFunc) delay_expired, job);
+			}
+			else
+			{
+				launch(job);
+			}
+		}
+
+		// jobs depending on a skipped job may come earlier in the list
+		if (skipped)
+		{
+			continue;
+		}
+
+		// If nothing is in progress but jobs are still waiting
+		// their dependencies may form a cycle
+		if (busy > 0 || blocked == NULL)
+		{
+			break;
+		}
+		cycle = find_cycle(blocked);
+		if (cycle != NULL)
+		{
+			g_warning("autostart: dependency cycle detected, starting %s",
+					  cycle->elt->name);
+			cycle->after = NULL;
+		}
+		// otherwise a dependency became ready during this pass
+	}
+
+	return FALSE;
+}
+
+static ProbeType parse_probe(gm_menu_element *elt, const gchar **file)
+{
+	const gchar *ready = elt->autostart_ready;
+
+	if (ready == NULL || strcmp(ready, "started") == 0)
+	{
+		return PROBE_STARTED;
+	}
+	else if (strcmp(ready, "exit") == 0)
+	{
+		return PROBE_EXIT;
+	}
+	else if (g_str_has_prefix(ready, "file:"))
+	{
+		*file = ready + strlen("file:");
+		return PROBE_FILE;
+	}
+
+	g_warning("autostart: unknown ready probe %s for %s", ready, elt->name);
+	return PROBE_STARTED;
+}
+
+static struct autostart_job *lookup_job_by_name(const gchar *name)
+{
+	struct autostart_job *job;
+	GList *l;
+
+	for (l = jobs; l != NULL; l = l->next)
+	{
+		job = l->data;
+		if (g_strcmp0(job->elt->name, name) == 0)
+		{
+			return job;
+		}
+	}
+	return NULL;
+}
+
+void appmanager_autostart_start(gm_menu *menu, gint concurrency, AUTOSTART_FUNC start)
+{
+	struct autostart_job *job;
+	GList *l;
+	int i;
+
+	if (menu == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < menu->amount_of_elements; i++)
+	{
+		if (menu->elts[i]->autostart == 1)
+		{
+			job = g_new0(struct autostart_job, 1);
+			job->elt = menu->elts[i];
+			job->state = JOB_WAITING;
+			job->probe = parse_probe(job->elt, &job->probe_file);
+			jobs = g_list_prepend(jobs, job);
+		}
+	}
+	jobs = g_list_reverse(jobs);
+
+	for (l = jobs; l != NULL; l = l->next)
+	{
+		job = l->data;
+		if (job->elt->autostart_after != NULL)
+		{
+			job->after = lookup_job_by_name(job->elt->autostart_after);
+			if (job->after == NULL)
+			{
+				g_warning("autostart: %s should start after %s which is not autostarted",
+						  job->elt->name, job->elt->autostart_after);
+			}
+		}
+	}
+
+	max_concurrency = concurrency > 0 ? concurrency : AUTOSTART_DEFAULT_CONCURRENCY;
+	start_program = start;
+	timer = g_timer_new();
+
+	queue_schedule();
+}
+
+void appmanager_autostart_process_exited(gm_menu_element *elt, gint status)
+{
+	struct autostart_job *job;
+	GList *l;
+
+	for (l = jobs; l != NULL; l = l->next)
+	{
+		job = l->data;
+		if (job->elt == elt && job->state == JOB_STARTING)
+		{
+			if (job->probe == PROBE_EXIT && WIFEXITED(status)
+				&& WEXITSTATUS(status) == 0)
+			{
+				job_finished(job, JOB_READY);
+			}
+			else
+			{
+				job_finished(job, JOB_FAILED);
+			}
+			return;
+		}
+	}
+}
+
+void appmanager_autostart_stop()
+{
+	GList *l;
+
+	if (schedule_source != 0)
+	{
+		g_source_remove(schedule_source);
+		schedule_source = 0;
+	}
+
+	for (l = jobs; l != NULL; l = l->next)
+	{
+		remove_sources(l->data);
+		g_free(l->data);
+	}
+	g_list_free(jobs);
+	jobs = NULL;
+	busy = 0;
+
+	if (timer != NULL)
+	{
+		g_timer_destroy(timer);
+		timer = NULL;
+	}
+}
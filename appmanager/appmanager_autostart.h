@@ -0,0 +1,57 @@
+/**
+ * \file appmanager_autostart.h
+ * \brief starts the autostart programs in dependency order
+ *
+ * Programs are started in the order of the configuration file unless the
+ * autostart element specifies the program that must be ready first:
+ *
+ *   <autostart after="NAME" delay="MILLISECONDS" ready="PROBE">1</autostart>
+ *
+ * PROBE determines when the program is ready. "started" (default) means as
+ * soon as the program was started, "exit" when the program exited
+ * successfully and "file:PATH" when PATH exists. At most a configurable
+ * amount of programs are started and not yet ready at the same time.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_AUTOSTART_H__
+#define __GAPPMAN_APPMANAGER_AUTOSTART_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+#define AUTOSTART_DEFAULT_CONCURRENCY 2 ///< default amount of programs that may be starting at the same time
+
+/**
+* \brief function used to start a program
+* \param elt menu element of the program
+* \return TRUE if the program was started, FALSE otherwise
+*/
+typedef gboolean (*AUTOSTART_FUNC) (gm_menu_element *elt);
+
+/**
+* \brief schedules the autostart programs of menu. The programs are started
+* from the main loop so gappman's menu is shown before programs are started.
+* \param menu menu holding the programs
+* \param concurrency maximum amount of programs that are started but not ready.
+*        Values smaller than 1 select AUTOSTART_DEFAULT_CONCURRENCY.
+* \param start function used to start a program
+*/
+void appmanager_autostart_start(gm_menu *menu, gint concurrency, AUTOSTART_FUNC start);
+
+/**
+* \brief must be called when a started program exits
+* \param elt menu element of the program
+* \param status exit status as returned by waitpid
+*/
+void appmanager_autostart_process_exited(gm_menu_element *elt, gint status);
+
+/**
+* \brief stops scheduling autostart programs and frees the scheduler
+*/
+void appmanager_autostart_stop();
+
+#endif
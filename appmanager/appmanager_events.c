@@ -0,0 +1,169 @@
+/**
+ * \file appmanager_events.c
+ * \brief notifies subscribers when programs start or exit and when the
+ * resolution changed
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/wait.h>
+#include "appmanager_events.h"
+
+/**
+* \brief function registered with appmanager_events_subscribe
+*/
+struct subscriber
+{
+	EVENTS_FUNC func;	///< function called for each event
+	gpointer user_data;	///< passed to func
+};
+
+static GSList *subscribers = NULL;	///< registered subscribers
+static GHashTable *start_times = NULL;	///< gm_get_monotonic_time at which each program was started indexed by process ID
+
+static void emit(const gchar *event)
+{
+	GSList *iter;
+	GSList *next;
+	struct subscriber *subscriber;
+
+	// a subscriber may remove itself while it is called
+	for (iter = subscribers; iter != NULL; iter = next)
+	{
+		next = iter->next;
+		subscriber = iter->data;
+		subscriber->func(event, subscriber->user_data);
+	}
+}
+
+/**
+* \brief returns the current time in milliseconds since the epoch
+*/
+static gint64 milliseconds()
+{
+	GTimeVal now;
+
+	g_get_current_time(&now);
+	return (gint64) now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+void appmanager_events_subscribe(EVENTS_FUNC func, gpointer user_data)
+{
+	struct subscriber *subscriber;
+
+	subscriber = g_new(struct subscriber, 1);
+	subscriber->func = func;
+	subscriber->user_data = user_data;
+	subscribers = g_slist_append(subscribers, subscriber);
+}
+
+void appmanager_events_unsubscribe(EVENTS_FUNC func, gpointer user_data)
+{
+	GSList *iter;
+	struct subscriber *subscriber;
+
+	for (iter = subscribers; iter != NULL; iter = iter->next)
+	{
+		subscriber = iter->data;
+		if (subscriber->func == func && subscriber->user_data == user_data)
+		{
+			subscribers = g_slist_delete_link(subscribers, iter);
+			g_free(subscriber);
+			return;
+		}
+	}
+}
+
+void appmanager_events_process_started(GPid pid, gm_menu_element *elt, gint64 started)
+{
+	gint64 *time;
+	gint64 wall_time;
+	gchar *event;
+
+	if (start_times == NULL)
+	{
+		start_times = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	}
+	time = g_new(gint64, 1);
+	*time = started;
+	g_hash_table_replace(start_times, GINT_TO_POINTER(pid), time);
+
+	if (subscribers == NULL)
+	{
+		return;
+	}
+
+	// subscribers get the wall clock time of the request
+	wall_time = milliseconds() - (gm_get_monotonic_time() - started) / 1000;
+	event = g_strdup_printf("started::%s::%d::%" G_GINT64_FORMAT, elt->name, (int) pid,
+							wall_time);
+	emit(event);
+	g_free(event);
+}
+
+void appmanager_events_process_exited(GPid pid, gint status)
+{
+	gint64 *started = NULL;
+	gint64 runtime = -1;
+	gint code;
+	gchar *event;
+
+	if (start_times != NULL)
+	{
+		started = g_hash_table_lookup(start_times, GINT_TO_POINTER(pid));
+	}
+
+	if (subscribers != NULL)
+	{
+		if (started != NULL)
+		{
+			// not affected by changes of the wall clock
+			runtime = (gm_get_monotonic_time() - *started) / 1000;
+		}
+		code = WIFSIGNALED(status) ? -WTERMSIG(status) : WEXITSTATUS(status);
+
+		event = g_strdup_printf("exited::%d::%d::%" G_GINT64_FORMAT, (int) pid, code,
+								runtime);
+		emit(event);
+		g_free(event);
+	}
+
+	if (started != NULL)
+	{
+		g_hash_table_remove(start_times, GINT_TO_POINTER(pid));
+	}
+}
+
+void appmanager_events_resolution_changed(gint width, gint height)
+{
+	gchar *event;
+
+	if (subscribers == NULL)
+	{
+		return;
+	}
+
+	event = g_strdup_printf("resolution::%dx%d", width, height);
+	emit(event);
+	g_free(event);
+}
+
+void appmanager_events_free()
+{
+	g_slist_foreach(subscribers, (GFunc) g_free, NULL);
+	g_slist_free(subscribers);
+	subscribers = NULL;
+
+	if (start_times != NULL)
+	{
+		g_hash_table_destroy(start_times);
+		start_times = NULL;
+	}
+}
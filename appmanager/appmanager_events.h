@@ -0,0 +1,75 @@
+/**
+ * \file appmanager_events.h
+ * \brief notifies subscribers when programs start or exit and when the
+ * resolution changed
+ *
+ * Each event is a single line:
+ * - `started::<PROGRAMNAME>::<PID>::<TIME>` where TIME is the start time in
+ *   milliseconds since the epoch
+ * - `exited::<PID>::<CODE>::<RUNTIME>` where CODE is the exit code of the
+ *   program or minus the signal that terminated it and RUNTIME is in
+ *   milliseconds
+ * - `resolution::<WIDTH>x<HEIGHT>` after a resolution switch was confirmed
+ *
+ * Events are only formatted if there are subscribers.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_EVENTS_H__
+#define __GAPPMAN_APPMANAGER_EVENTS_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+/**
+* \brief function called for each event
+* \param event event line, without newline. Only valid during the call.
+* \param user_data data passed to appmanager_events_subscribe
+*/
+typedef void (*EVENTS_FUNC) (const gchar *event, gpointer user_data);
+
+/**
+* \brief calls func for each event from now on
+* \param func function called for each event
+* \param user_data passed to func
+*/
+void appmanager_events_subscribe(EVENTS_FUNC func, gpointer user_data);
+
+/**
+* \brief stops calling func, may be called from func
+* \param func function passed to appmanager_events_subscribe
+* \param user_data data passed to appmanager_events_subscribe
+*/
+void appmanager_events_unsubscribe(EVENTS_FUNC func, gpointer user_data);
+
+/**
+* \brief must be called when a program was started
+* \param pid process ID of the started program
+* \param elt menu element of the started program
+* \param started gm_get_monotonic_time at which the user requested the program to start
+*/
+void appmanager_events_process_started(GPid pid, gm_menu_element *elt, gint64 started);
+
+/**
+* \brief must be called when a program exited
+* \param pid process ID of the program
+* \param status exit status as returned by waitpid
+*/
+void appmanager_events_process_exited(GPid pid, gint status);
+
+/**
+* \brief must be called when a resolution switch was confirmed
+* \param width screen width
+* \param height screen height
+*/
+void appmanager_events_resolution_changed(gint width, gint height);
+
+/**
+* \brief removes all subscribers and forgets the started programs
+*/
+void appmanager_events_free();
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * \file appmanager_focus.c
+ * \brief lets the screen resolution follow the active window
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+#include <gm_keybinder.h>
+#include "appmanager_focus.h"
+#include "appmanager_processes.h"
+
+static FOCUS_FUNC change_func = NULL;	///< function used to switch the resolution
+static gint active_pid = 0;	///< _NET_WM_PID of the window that became active last
+static guint hysteresis_source = 0;	///< source id of the pending resolution switch
+
+/**
+* \brief applies the resolution of the window that has been active for
+* FOCUS_HYSTERESIS milliseconds
+*/
+static gboolean apply_focus(gpointer data)
+{
+	struct process_info *proc;
+	gint width;
+	gint height;
+
+	hysteresis_source = 0;
+
+	if (active_pid == getpid())
+	{
+		change_func(-1, -1);
+		return FALSE;
+	}
+
+	proc = appmanager_processes_lookup_descendant(active_pid);
+	if (proc == NULL)
+	{
+		// the program exited in the meantime
+		return FALSE;
+	}
+
+	appmanager_processes_raise(proc);
+	appmanager_processes_get_resolution(&width, &height);
+	change_func(width, height);
+
+	return FALSE;
+}
+
+static void window_activated(gulong xwindow, gint pid, void *user_data)
+{
+	// only gappman and the programs it started determine the resolution,
+	// e.g. a notification popping up does not cancel a pending switch
+	if (pid <= 0 || (pid != getpid() && appmanager_processes_lookup_descendant(pid) == NULL))
+	{
+		return;
+	}
+
+	if (hysteresis_source != 0)
+	{
+		g_source_remove(hysteresis_source);
+	}
+	active_pid = pid;
+	hysteresis_source = g_timeout_add(FOCUS_HYSTERESIS, apply_focus, NULL);
+}
+
+void appmanager_focus_init(FOCUS_FUNC change)
+{
+	change_func = change;
+	gm_keybinder_watch_active_window(window_activated, NULL);
+}
+
+void appmanager_focus_stop()
+{
+	gm_keybinder_watch_active_window(NULL, NULL);
+	if (hysteresis_source != 0)
+	{
+		g_source_remove(hysteresis_source);
+		hysteresis_source = 0;
+	}
+}
@@ -0,0 +1,43 @@
+/**
+ * \file appmanager_focus.h
+ * \brief lets the screen resolution follow the active window
+ *
+ * When the window manager activates a window of a started program, that
+ * program becomes the top of the resolution stack and the screen switches
+ * to its resolution. Activating gappman itself switches to gappman's
+ * resolution. Windows of other programs are ignored. A window must stay
+ * active for FOCUS_HYSTERESIS milliseconds before the resolution follows,
+ * so cycling through windows or short lived popups do not switch modes.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_FOCUS_H__
+#define __GAPPMAN_APPMANAGER_FOCUS_H__
+
+#include <glib.h>
+
+#define FOCUS_HYSTERESIS 500 ///< milliseconds a window must stay active before the resolution follows it
+
+/**
+* \brief function used to switch the resolution
+* \param width screen width, -1 for gappman's resolution
+* \param height screen height, -1 for gappman's resolution
+*/
+typedef void (*FOCUS_FUNC) (gint width, gint height);
+
+/**
+* \brief starts following the active window. Requires gm_keybinder_init to
+* be called first.
+* \param change function used to switch the resolution
+*/
+void appmanager_focus_init(FOCUS_FUNC change);
+
+/**
+* \brief stops following the active window
+*/
+void appmanager_focus_stop();
+
+#endif
@@ -0,0 +1,228 @@
+/**
+ * \file appmanager_latency.c
+ * \brief measures the time between starting a program and its first window
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#include <gm_keybinder.h>
+#include "appmanager_latency.h"
+#include "appmanager_processes.h"
+
+/**
+* \brief a started program that did not map a window yet
+*/
+struct pending_launch
+{
+	gm_menu_element *menu_elt;	///< menu element of the program
+	gint64 started;	///< gm_get_monotonic_time at which the user requested the program to start
+};
+
+static GHashTable *pending = NULL;	///< struct pending_launch indexed by process ID
+static GHashTable *histograms = NULL;	///< struct latency_histogram indexed by menu element
+static gchar **snapshot = NULL;	///< histograms formatted by appmanager_latency_to_string, NULL terminated
+G_LOCK_DEFINE_STATIC(snapshot);	///< protects snapshot, which is read by the listener thread
+
+static void add_latency(gm_menu_element *elt, gdouble latency)
+{
+	struct latency_histogram *hist;
+	guint bucket;
+	gulong ms;
+
+	hist = g_hash_table_lookup(histograms, elt);
+	if (hist == NULL)
+	{
+		hist = g_new0(struct latency_histogram, 1);
+		hist->menu_elt = elt;
+		hist->min = latency;
+		g_hash_table_insert(histograms, elt, hist);
+	}
+
+	hist->count++;
+	hist->sum += latency;
+	if (latency < hist->min)
+	{
+		hist->min = latency;
+	}
+	if (latency > hist->max)
+	{
+		hist->max = latency;
+	}
+
+	ms = (gulong) latency;
+	for (bucket = 0; ms > 1 && bucket < LATENCY_BUCKETS - 1; bucket++)
+	{
+		ms >>= 1;
+	}
+	hist->buckets[bucket]++;
+}
+
+/**
+* \brief formats the histograms again for appmanager_latency_get_snapshot
+*/
+static void publish_snapshot()
+{
+	GPtrArray *list;
+	GHashTableIter iter;
+	gpointer hist;
+	gchar **old;
+
+	list = g_ptr_array_new();
+	if (histograms != NULL)
+	{
+		g_hash_table_iter_init(&iter, histograms);
+		while (g_hash_table_iter_next(&iter, NULL, &hist))
+		{
+			g_ptr_array_add(list, appmanager_latency_to_string(hist));
+		}
+	}
+	g_ptr_array_add(list, NULL);
+
+	G_LOCK(snapshot);
+	old = snapshot;
+	snapshot = (gchar **) g_ptr_array_free(list, FALSE);
+	G_UNLOCK(snapshot);
+	g_strfreev(old);
+}
+
+/**
+* \brief called by the keybinder when a window is mapped. Looks for a
+* pending launch of the process that owns the window or of one of its
+* ancestors, as programs are often started through a wrapper.
+*/
+static void window_mapped(gulong xwindow, gint pid, void *user_data)
+{
+	struct pending_launch *launch;
+	struct process_info *proc;
+	gdouble latency;
+
+	// most mapped windows do not belong to a program that is being started
+	if (g_hash_table_size(pending) == 0)
+	{
+		return;
+	}
+
+	proc = appmanager_processes_lookup_descendant(pid);
+	if (proc == NULL)
+	{
+		return;
+	}
+	pid = proc->PID;
+
+	launch = g_hash_table_lookup(pending, GINT_TO_POINTER(pid));
+	if (launch == NULL)
+	{
+		return;
+	}
+
+	latency = (gm_get_monotonic_time() - launch->started) / 1000.0;
+	g_message("%s mapped its first window after %.1f ms",
+			  launch->menu_elt->name, latency);
+
+	add_latency(launch->menu_elt, latency);
+	publish_snapshot();
+	g_hash_table_remove(pending, GINT_TO_POINTER(pid));
+}
+
+void appmanager_latency_init()
+{
+	if (pending != NULL)
+	{
+		return;
+	}
+
+	pending = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	histograms = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+	gm_keybinder_watch_windows(window_mapped, NULL);
+}
+
+void appmanager_latency_launched(GPid pid, gm_menu_element *elt, gint64 started)
+{
+	struct pending_launch *launch;
+
+	if (pending == NULL)
+	{
+		return;
+	}
+
+	launch = g_new(struct pending_launch, 1);
+	launch->menu_elt = elt;
+	launch->started = started;
+	g_hash_table_replace(pending, GINT_TO_POINTER(pid), launch);
+}
+
+void appmanager_latency_process_exited(GPid pid)
+{
+	if (pending != NULL)
+	{
+		g_hash_table_remove(pending, GINT_TO_POINTER(pid));
+	}
+}
+
+void appmanager_latency_foreach(GFunc func, gpointer user_data)
+{
+	GHashTableIter iter;
+	gpointer hist;
+
+	if (histograms == NULL)
+	{
+		return;
+	}
+
+	g_hash_table_iter_init(&iter, histograms);
+	while (g_hash_table_iter_next(&iter, NULL, &hist))
+	{
+		func(hist, user_data);
+	}
+}
+
+gchar *appmanager_latency_to_string(struct latency_histogram *hist)
+{
+	GString *str;
+	guint i;
+
+	str = g_string_new(NULL);
+	g_string_printf(str, "name::%s::count::%u::min::%.1f::mean::%.1f::max::%.1f::buckets::",
+					hist->menu_elt->name, hist->count, hist->min,
+					hist->sum / hist->count, hist->max);
+	for (i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		g_string_append_printf(str, i == 0 ? "%u" : ",%u", hist->buckets[i]);
+	}
+
+	return g_string_free(str, FALSE);
+}
+
+gchar **appmanager_latency_get_snapshot()
+{
+	gchar **copy;
+
+	G_LOCK(snapshot);
+	copy = g_strdupv(snapshot);
+	G_UNLOCK(snapshot);
+
+	return copy;
+}
+
+void appmanager_latency_free()
+{
+	if (pending == NULL)
+	{
+		return;
+	}
+
+	gm_keybinder_watch_windows(NULL, NULL);
+	g_hash_table_destroy(pending);
+	g_hash_table_destroy(histograms);
+	pending = NULL;
+	histograms = NULL;
+
+	G_LOCK(snapshot);
+	g_strfreev(snapshot);
+	snapshot = NULL;
+	G_UNLOCK(snapshot);
+}
@@ -0,0 +1,84 @@
+/**
+ * \file appmanager_latency.h
+ * \brief measures the time between starting a program and its first window
+ *
+ * A launch is pending from the moment a program is started until a window
+ * with a _NET_WM_PID of the program, or of one of its descendants, is mapped.
+ * The latencies are kept in a histogram per program.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_LATENCY_H__
+#define __GAPPMAN_APPMANAGER_LATENCY_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+#define LATENCY_BUCKETS 16 ///< bucket i holds latencies from 2^i up to 2^(i+1) milliseconds, bucket 0 also holds latencies below 1 millisecond
+
+/**
+* \brief launch-to-window latencies of a single program
+*/
+struct latency_histogram
+{
+	gm_menu_element *menu_elt;	///< menu element of the program
+	guint count;	///< amount of measured launches
+	gdouble min;	///< lowest latency in milliseconds
+	gdouble max;	///< highest latency in milliseconds
+	gdouble sum;	///< sum of all latencies in milliseconds
+	guint buckets[LATENCY_BUCKETS];	///< amount of launches per latency range
+};
+
+/**
+* \brief starts watching for windows of started programs. Requires
+* gm_keybinder_init to be called first.
+*/
+void appmanager_latency_init();
+
+/**
+* \brief records the start of a program
+* \param pid process ID of the started program
+* \param elt menu element of the started program
+* \param started gm_get_monotonic_time at which the user requested the program to start
+*/
+void appmanager_latency_launched(GPid pid, gm_menu_element *elt, gint64 started);
+
+/**
+* \brief forgets a pending launch of a program that exited before it mapped a window
+* \param pid process ID of the program
+*/
+void appmanager_latency_process_exited(GPid pid);
+
+/**
+* \brief calls func for the histogram of each program that mapped a window
+* \param func function called with the latency_histogram structure and user_data
+* \param user_data passed to func
+*/
+void appmanager_latency_foreach(GFunc func, gpointer user_data);
+
+/**
+* \brief formats a histogram as
+* `name::<NAME>::count::<N>::min::<MS>::mean::<MS>::max::<MS>::buckets::<B0>,<B1>,...`
+* \param hist histogram
+* \return newly allocated string, free with g_free
+*/
+gchar *appmanager_latency_to_string(struct latency_histogram *hist);
+
+/**
+* \brief returns the histograms as formatted by appmanager_latency_to_string.
+* The list is formatted whenever a latency is added, so it may be read from
+* any thread.
+* \return NULL terminated list or NULL if no program mapped a window yet.
+* Must be freed with g_strfreev.
+*/
+gchar **appmanager_latency_get_snapshot();
+
+/**
+* \brief stops watching windows and frees all histograms
+*/
+void appmanager_latency_free();
+
+#endif
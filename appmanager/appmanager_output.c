@@ -0,0 +1,448 @@
+/**
+ * \file appmanager_output.c
+ * \brief keeps the output of started programs in memory
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include "appmanager_output.h"
+
+#define OUTPUT_READ_SIZE 4096 ///< bytes read from a pipe at once
+#define OUTPUT_MAX_READS 16 ///< maximum amount of reads per pipe before other sources get a turn
+#define OUTPUT_MAX_PENDING (1024 * 1024) ///< bytes of output waiting to be written to the file of a program after which more output is not written
+
+/**
+* \brief captured output of a single program
+*/
+struct output_buffer
+{
+	gm_menu_element *elt;	///< menu element of the program
+	gchar *data;	///< ring buffer holding the output
+	gsize size;	///< size of data in bytes
+	gsize start;	///< position of the oldest byte in data
+	gsize length;	///< amount of bytes in data
+	gint file_fd;	///< file the output is appended to, -1 if not open. Only used by the writer.
+	gint64 file_size;	///< size of the file in bytes
+	gint64 rotate_size;	///< size in bytes at which the file is rotated
+	gboolean file_failed;	///< TRUE if the file could not be written
+	GString *pending;	///< output not handed to the writer yet, protected by files
+	GString *writing;	///< output the writer is writing to the file
+	gboolean write_queued;	///< TRUE if the writer will write pending, protected by files
+	gboolean dropping;	///< TRUE if output was dropped as the file is written too slowly, protected by files
+};
+
+/**
+* \brief pipe connected to stdout and stderr of a running program
+*/
+struct output_pipe
+{
+	struct output_buffer *buffer;	///< buffer the output is added to
+	gint fd;	///< read end of the pipe
+	guint source;	///< source id of the watch on fd
+};
+
+static GHashTable *buffers = NULL;	///< struct output_buffer indexed by menu element
+G_LOCK_DEFINE_STATIC(buffers);	///< protects buffers and their output, which are read by the listener thread
+static GList *pipes = NULL;	///< open pipes
+static GThreadPool *writer = NULL;	///< writes the output files, so the main loop does not wait for the disk
+G_LOCK_DEFINE_STATIC(files);	///< protects the output waiting to be written to the files
+
+static void close_file(struct output_buffer *buffer)
+{
+	if (buffer->file_fd != -1)
+	{
+		close(buffer->file_fd);
+		buffer->file_fd = -1;
+	}
+}
+
+static void free_buffer(struct output_buffer *buffer)
+{
+	close_file(buffer);
+	if (buffer->pending != NULL)
+	{
+		g_string_free(buffer->pending, TRUE);
+		g_string_free(buffer->writing, TRUE);
+	}
+	g_free(buffer->data);
+	g_free(buffer);
+}
+
+static void write_pending(struct output_buffer *buffer, gpointer user_data);
+
+static struct output_buffer *lookup_buffer(gm_menu_element *elt)
+{
+	struct output_buffer *buffer;
+	gint size;
+	gint rotate_size;
+
+	if (buffers == NULL)
+	{
+		G_LOCK(buffers);
+		buffers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+										(GDestroyNotify) free_buffer);
+		G_UNLOCK(buffers);
+	}
+
+	buffer = g_hash_table_lookup(buffers, elt);
+	if (buffer == NULL)
+	{
+		size = elt->capture_size > 0 ? elt->capture_size : OUTPUT_DEFAULT_SIZE;
+		rotate_size = elt->capture_rotate_size > 0 ?
+			elt->capture_rotate_size : OUTPUT_DEFAULT_ROTATE_SIZE;
+
+		buffer = g_new0(struct output_buffer, 1);
+		buffer->elt = elt;
+		buffer->size = (gsize) size * 1024;
+		buffer->data = g_malloc(buffer->size);
+		buffer->file_fd = -1;
+		buffer->rotate_size = (gint64) rotate_size * 1024;
+		if (elt->capture_file != NULL)
+		{
+			buffer->pending = g_string_sized_new(OUTPUT_READ_SIZE);
+			buffer->writing = g_string_sized_new(OUTPUT_READ_SIZE);
+			if (writer == NULL && g_thread_supported())
+			{
+				// a single thread, so each file is written in order
+				writer = g_thread_pool_new((GFunc) write_pending, NULL, 1, FALSE, NULL);
+			}
+		}
+		G_LOCK(buffers);
+		g_hash_table_insert(buffers, elt, buffer);
+		G_UNLOCK(buffers);
+	}
+	return buffer;
+}
+
+/**
+* \brief adds output to the ring buffer, dropping the oldest output if the
+* buffer is full
+*/
+static void append_output(struct output_buffer *buffer, const gchar *data, gsize length)
+{
+	gsize end;
+	gsize part;
+
+	if (length >= buffer->size)
+	{
+		memcpy(buffer->data, data + length - buffer->size, buffer->size);
+		buffer->start = 0;
+		buffer->length = buffer->size;
+		return;
+	}
+
+	end = (buffer->start + buffer->length) % buffer->size;
+	part = MIN(length, buffer->size - end);
+	memcpy(buffer->data + end, data, part);
+	memcpy(buffer->data, data + part, length - part);
+
+	buffer->length += length;
+	if (buffer->length > buffer->size)
+	{
+		buffer->start = (buffer->start + buffer->length - buffer->size) % buffer->size;
+		buffer->length = buffer->size;
+	}
+}
+
+/**
+* \brief moves the output file to FILE.1, replacing the previous one. The
+* file is opened again by the next write.
+*/
+static void rotate_file(struct output_buffer *buffer)
+{
+	gchar *rotated;
+
+	close_file(buffer);
+	rotated = g_strconcat(buffer->elt->capture_file, ".1", NULL);
+	if (g_rename(buffer->elt->capture_file, rotated) == -1)
+	{
+		g_warning("output: could not rotate %s: %s", buffer->elt->capture_file,
+				  g_strerror(errno));
+	}
+	g_free(rotated);
+	buffer->file_size = 0;
+}
+
+static void write_file(struct output_buffer *buffer, const gchar *data, gsize length)
+{
+	struct stat info;
+	ssize_t written;
+
+	if (buffer->elt->capture_file == NULL || buffer->file_failed)
+	{
+		return;
+	}
+
+	if (buffer->file_fd == -1)
+	{
+		buffer->file_fd = open(buffer->elt->capture_file,
+							   O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (buffer->file_fd == -1)
+		{
+			g_warning("output: could not open %s: %s", buffer->elt->capture_file,
+					  g_strerror(errno));
+			buffer->file_failed = TRUE;
+			return;
+		}
+		buffer->file_size = fstat(buffer->file_fd, &info) == 0 ? info.st_size : 0;
+	}
+
+	while (length > 0)
+	{
+		written = write(buffer->file_fd, data, length);
+		if (written == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			g_warning("output: could not write %s: %s", buffer->elt->capture_file,
+					  g_strerror(errno));
+			close_file(buffer);
+			buffer->file_failed = TRUE;
+			return;
+		}
+		data += written;
+		length -= written;
+		buffer->file_size += written;
+	}
+
+	if (buffer->file_size >= buffer->rotate_size)
+	{
+		rotate_file(buffer);
+	}
+}
+
+/**
+* \brief writes the output collected since the previous call to the file,
+* called by the writer thread
+*/
+static void write_pending(struct output_buffer *buffer, gpointer user_data)
+{
+	GString *data;
+
+	G_LOCK(files);
+	data = buffer->pending;
+	buffer->pending = buffer->writing;
+	buffer->writing = data;
+	buffer->write_queued = FALSE;
+	buffer->dropping = FALSE;
+	G_UNLOCK(files);
+
+	write_file(buffer, data->str, data->len);
+	g_string_truncate(data, 0);
+}
+
+/**
+* \brief hands output to the writer thread. Output that arrives while the
+* writer is busy is collected and written at once.
+*/
+static void queue_write(struct output_buffer *buffer, const gchar *data, gsize length)
+{
+	gboolean push = FALSE;
+
+	if (buffer->pending == NULL)
+	{
+		return;
+	}
+
+	if (writer == NULL)
+	{
+		write_file(buffer, data, length);
+		return;
+	}
+
+	G_LOCK(files);
+	if (buffer->pending->len + length <= OUTPUT_MAX_PENDING)
+	{
+		g_string_append_len(buffer->pending, data, length);
+		push = !buffer->write_queued;
+		buffer->write_queued = TRUE;
+	}
+	else if (!buffer->dropping)
+	{
+		g_warning("output: %s is written too slowly, dropping output",
+				  buffer->elt->capture_file);
+		buffer->dropping = TRUE;
+	}
+	G_UNLOCK(files);
+
+	if (push)
+	{
+		g_thread_pool_push(writer, buffer, NULL);
+	}
+}
+
+static void close_pipe(struct output_pipe *output)
+{
+	pipes = g_list_remove(pipes, output);
+	close(output->fd);
+	g_free(output);
+}
+
+static gboolean read_output(GIOChannel *source, GIOCondition condition,
+							struct output_pipe *output)
+{
+	gchar data[OUTPUT_READ_SIZE];
+	ssize_t length;
+	gint i;
+
+	for (i = 0; i < OUTPUT_MAX_READS; i++)
+	{
+		length = read(output->fd, data, sizeof(data));
+		if (length > 0)
+		{
+			G_LOCK(buffers);
+			append_output(output->buffer, data, length);
+			G_UNLOCK(buffers);
+			queue_write(output->buffer, data, length);
+		}
+		else if (length == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (length == -1 && errno == EAGAIN)
+		{
+			return TRUE;
+		}
+		else
+		{
+			// the program and all its children closed their output
+			close_pipe(output);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+gint appmanager_output_open(gm_menu_element *elt)
+{
+	struct output_pipe *output;
+	GIOChannel *channel;
+	int fds[2];
+
+	if (elt->capture != 1)
+	{
+		return -1;
+	}
+
+	if (pipe(fds) == -1)
+	{
+		g_warning("output: could not create pipe for %s: %s", elt->name,
+				  g_strerror(errno));
+		return -1;
+	}
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+	output = g_new0(struct output_pipe, 1);
+	output->buffer = lookup_buffer(elt);
+	output->fd = fds[0];
+
+	channel = g_io_channel_unix_new(output->fd);
+	output->source = g_io_add_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+									(GIOFunc) read_output, output);
+	g_io_channel_unref(channel);
+	pipes = g_list_prepend(pipes, output);
+
+	return fds[1];
+}
+
+gchar *appmanager_output_tail(const gchar *name, gsize max)
+{
+	struct output_buffer *buffer = NULL;
+	GHashTableIter iter;
+	const gchar *end;
+	gchar *tail;
+	gchar *pos;
+	gsize length;
+	gsize first;
+	gsize part;
+
+	G_LOCK(buffers);
+	if (buffers == NULL)
+	{
+		G_UNLOCK(buffers);
+		return NULL;
+	}
+
+	g_hash_table_iter_init(&iter, buffers);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &buffer))
+	{
+		if (g_strcmp0((const gchar *) buffer->elt->name, name) == 0)
+		{
+			break;
+		}
+		buffer = NULL;
+	}
+	if (buffer == NULL)
+	{
+		G_UNLOCK(buffers);
+		return NULL;
+	}
+
+	length = buffer->length;
+	if (max > 0 && max < length)
+	{
+		length = max;
+	}
+
+	tail = g_malloc(length + 1);
+	first = (buffer->start + buffer->length - length) % buffer->size;
+	part = MIN(length, buffer->size - first);
+	memcpy(tail, buffer->data + first, part);
+	memcpy(tail + part, buffer->data, length - part);
+	tail[length] = '\0';
+	G_UNLOCK(buffers);
+
+	pos = tail;
+	while (!g_utf8_validate(pos, length - (pos - tail), &end))
+	{
+		pos = (gchar *) end;
+		*pos++ = '?';
+	}
+
+	return tail;
+}
+
+void appmanager_output_free()
+{
+	struct output_pipe *output;
+
+	while (pipes != NULL)
+	{
+		output = pipes->data;
+		g_source_remove(output->source);
+		close_pipe(output);
+	}
+
+	// write the output that is still pending
+	if (writer != NULL)
+	{
+		g_thread_pool_free(writer, FALSE, TRUE);
+		writer = NULL;
+	}
+
+	G_LOCK(buffers);
+	if (buffers != NULL)
+	{
+		g_hash_table_destroy(buffers);
+		buffers = NULL;
+	}
+	G_UNLOCK(buffers);
+}
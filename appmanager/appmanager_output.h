@@ -0,0 +1,61 @@
+/**
+ * \file appmanager_output.h
+ * \brief keeps the output of started programs in memory
+ *
+ * Programs with <capture>1</capture> in the configuration file have their
+ * stdout and stderr connected to a pipe that is read on the main loop. The
+ * output is kept in a ring buffer of a fixed size per program. When the
+ * buffer is full the oldest output is dropped. The output is optionally
+ * appended to a file that is rotated when it grows too large:
+ *
+ *   <capture size="KILOBYTES" file="PATH" rotatesize="KILOBYTES">1</capture>
+ *
+ * The file is written by a worker thread, which writes all output that
+ * arrived while it was busy at once.
+ *
+ * The ring buffer of a program is kept when the program exits, so the
+ * output of a crashed program can still be retrieved.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_OUTPUT_H__
+#define __GAPPMAN_APPMANAGER_OUTPUT_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+#define OUTPUT_DEFAULT_SIZE 64 ///< default kilobytes of output kept in memory per program
+#define OUTPUT_DEFAULT_ROTATE_SIZE 1024 ///< default kilobytes after which the output file is rotated
+
+/**
+* \brief creates a pipe for the output of a program that is about to be
+* started
+* \param elt menu element of the program
+* \return write end of the pipe that should become stdout and stderr of the
+* program, or -1 if the output of elt is not captured. The caller must close
+* it after the program was started.
+*/
+gint appmanager_output_open(gm_menu_element *elt);
+
+/**
+* \brief returns the captured output of a program. Invalid UTF-8 sequences,
+* e.g. a character cut in half when older output was dropped, are replaced
+* by '?'.
+* \param name name of the program
+* \param max maximum amount of bytes returned, 0 for all output kept in memory
+* May be called from any thread.
+* \return the most recent output of the program, NULL if the output of the
+* program is not captured. Must be freed with g_free.
+*/
+gchar *appmanager_output_tail(const gchar *name, gsize max);
+
+/**
+* \brief stops reading the output of all programs and frees all captured
+* output
+*/
+void appmanager_output_free();
+
+#endif
@@ -0,0 +1,405 @@
+/**
+ * \file appmanager_prefetch.c
+ * \brief prewarms the page cache with the files of frequently started programs
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <glib/gstdio.h>
+#include <gm_parseconf.h>
+#include "appmanager_prefetch.h"
+#include "appmanager_processes.h"
+
+#define PREFETCH_RECORD_DELAY 10000 ///< milliseconds after the start of a program at which its mapped files are recorded
+#define PREFETCH_IDLE_DELAY 5000 ///< milliseconds without program starts after which the menu is considered idle
+#define PREFETCH_MAX_FILES 512 ///< maximum amount of files recorded per program
+
+#define IOPRIO_WHO_PROCESS 1 ///< ioprio_set applies to a single thread
+#define IOPRIO_CLASS_IDLE 3 ///< only use the disk when nobody else does
+#define IOPRIO_CLASS_SHIFT 13 ///< position of the class in an IO priority
+
+/**
+* \brief a started program whose mapped files still need to be recorded
+*/
+struct pending_record
+{
+	GPid pid;	///< process ID of the program
+	gm_menu_element *elt;	///< menu element of the program
+	guint source;	///< source id of the record timer
+};
+
+/**
+* \brief files of a single program that should be prefetched
+*/
+struct prefetch_program
+{
+	gint launches;	///< amount of times the program was started
+	gchar **files;	///< NULL terminated list of files
+};
+
+static GKeyFile *history = NULL;	///< launch history, a group per program
+static gchar *history_file = NULL;	///< location of the launch history on disk
+static gboolean history_changed = FALSE;	///< TRUE if history was not saved yet
+static gboolean prefetched = FALSE;	///< TRUE if the current history was prefetched
+static gint64 budget_bytes = 0;	///< maximum amount of bytes to prefetch
+static GList *records = NULL;	///< pending records
+static guint idle_source = 0;	///< source id of the idle timer
+static GThread *thread = NULL;	///< thread doing the prefetching
+static volatile gint cancelled = FALSE;	///< set to stop the prefetch thread
+static volatile gint running = FALSE;	///< TRUE while the prefetch thread runs
+
+static void save_history()
+{
+	GError *error = NULL;
+	gchar *dirname;
+	gchar *data;
+	gsize length;
+
+	if (!history_changed)
+	{
+		return;
+	}
+
+	dirname = g_path_get_dirname(history_file);
+	g_mkdir_with_parents(dirname, 0755);
+	g_free(dirname);
+
+	data = g_key_file_to_data(history, &length, NULL);
+	if (!g_file_set_contents(history_file, data, length, &error))
+	{
+		g_warning("prefetch: could not save %s: %s", history_file, error->message);
+		g_error_free(error);
+	}
+	g_free(data);
+	history_changed = FALSE;
+}
+
+/**
+* \brief reads the files that are mapped by pid
+* \return NULL terminated list of files or NULL if pid does not exist
+*/
+static gchar **read_mapped_files(GPid pid)
+{
+	GHashTable *seen;
+	GPtrArray *files;
+	gchar *filename;
+	gchar *contents = NULL;
+	gchar **lines;
+	gchar *path;
+	gulong inode;
+	gint i;
+
+	filename = g_strdup_printf("/proc/%d/maps", pid);
+	if (!g_file_get_contents(filename, &contents, NULL, NULL))
+	{
+		g_free(filename);
+		return NULL;
+	}
+	g_free(filename);
+
+	seen = g_hash_table_new(g_str_hash, g_str_equal);
+	files = g_ptr_array_new();
+	lines = g_strsplit(contents, "\n", 0);
+	for (i = 0; lines[i] != NULL && files->len < PREFETCH_MAX_FILES; i++)
+	{
+		// address perms offset dev inode pathname
+		if (sscanf(lines[i], "%*s %*s %*s %*s %lu", &inode) != 1 || inode == 0)
+		{
+			continue;
+		}
+
+		path = strchr(lines[i], '/');
+		if (path == NULL || g_str_has_suffix(path, " (deleted)")
+			|| g_hash_table_lookup(seen, path) != NULL)
+		{
+			continue;
+		}
+
+		g_hash_table_insert(seen, path, path);
+		g_ptr_array_add(files, g_strdup(path));
+	}
+	g_ptr_array_add(files, NULL);
+
+	g_strfreev(lines);
+	g_free(contents);
+	g_hash_table_destroy(seen);
+
+	return (gchar **) g_ptr_array_free(files, FALSE);
+}
+
+static gboolean record_files(struct pending_record *record)
+{
+	gchar **files;
+
+	records = g_list_remove(records, record);
+
+	// the process ID may have been reused if the program already exited
+	if (appmanager_processes_lookup_pid(record->pid) != NULL)
+	{
+		files = read_mapped_files(record->pid);
+		if (files != NULL && files[0] != NULL)
+		{
+			g_key_file_set_string_list(history, record->elt->name, "files",
+									   (const gchar * const *) files,
+									   g_strv_length(files));
+			history_changed = TRUE;
+			prefetched = FALSE;
+		}
+		g_strfreev(files);
+	}
+
+	save_history();
+	g_free(record);
+	return FALSE;
+}
+
+static gint compare_launches(struct prefetch_program *a, struct prefetch_program *b)
+{
+	return b->launches - a->launches;
+}
+
+/**
+* \brief asks the kernel to read the files of the programs into the page
+* cache, most frequently started programs first, until the budget is used.
+*/
+static gpointer prefetch(GList *programs)
+{
+	struct prefetch_program *program;
+	struct stat info;
+	gint64 remaining = budget_bytes;
+	gint64 prefetched_bytes = 0;
+	GList *l;
+	gint fd;
+	gint i;
+
+#ifdef SYS_ioprio_set
+	// 0 selects the calling thread
+	syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+			IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+#endif
+
+	for (l = programs; l != NULL && remaining > 0; l = l->next)
+	{
+		program = l->data;
+		for (i = 0; program->files[i] != NULL && remaining > 0; i++)
+		{
+			if (g_atomic_int_get(&cancelled))
+			{
+				break;
+			}
+
+			fd = open(program->files[i], O_RDONLY | O_CLOEXEC);
+			if (fd == -1)
+			{
+				continue;
+			}
+
+			if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)
+				&& info.st_size <= remaining)
+			{
+				// the reads are submitted by this thread, so they
+				// get its idle IO priority
+				posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+				remaining -= info.st_size;
+				prefetched_bytes += info.st_size;
+			}
+			close(fd);
+		}
+	}
+
+	for (l = programs; l != NULL; l = l->next)
+	{
+		program = l->data;
+		g_strfreev(program->files);
+		g_free(program);
+	}
+	g_list_free(programs);
+
+	g_message("prefetch: prefetched %" G_GINT64_FORMAT " kB", prefetched_bytes / 1024);
+	g_atomic_int_set(&running, FALSE);
+	return NULL;
+}
+
+static void schedule_prefetch();
+
+/**
+* \brief called when the menu is idle. Starts the prefetch thread for the
+* programs that are not running.
+*/
+static gboolean menu_idle(gpointer data)
+{
+	struct prefetch_program *program;
+	GList *programs = NULL;
+	gchar **groups;
+	gm_menu_element *elt;
+	gint i;
+
+	idle_source = 0;
+
+	if (thread != NULL)
+	{
+		if (g_atomic_int_get(&running))
+		{
+			// try again when the current pass finished
+			schedule_prefetch();
+			return FALSE;
+		}
+		g_thread_join(thread);
+		thread = NULL;
+	}
+
+	if (prefetched || budget_bytes == 0)
+	{
+		return FALSE;
+	}
+	prefetched = TRUE;
+
+	groups = g_key_file_get_groups(history, NULL);
+	for (i = 0; groups[i] != NULL; i++)
+	{
+		// files of running programs are in the page cache already
+		elt = gm_menu_search_elt_by_name(groups[i], gm_get_programs());
+		if (elt != NULL && appmanager_processes_lookup_elt(elt) != NULL)
+		{
+			continue;
+		}
+
+		program = g_new(struct prefetch_program, 1);
+		program->launches = g_key_file_get_integer(history, groups[i], "launches", NULL);
+		program->files = g_key_file_get_string_list(history, groups[i], "files", NULL, NULL);
+		if (program->files == NULL)
+		{
+			g_free(program);
+			continue;
+		}
+		programs = g_list_insert_sorted(programs, program, (GCompareFunc) compare_launches);
+	}
+	g_strfreev(groups);
+
+	if (programs != NULL)
+	{
+		g_atomic_int_set(&running, TRUE);
+		thread = g_thread_create((GThreadFunc) prefetch, programs, TRUE, NULL);
+		if (thread == NULL)
+		{
+			g_warning("prefetch: failed to create thread");
+			g_atomic_int_set(&running, FALSE);
+		}
+	}
+
+	return FALSE;
+}
+
+static void schedule_prefetch()
+{
+	if (idle_source != 0)
+	{
+		g_source_remove(idle_source);
+	}
+	idle_source = g_timeout_add(PREFETCH_IDLE_DELAY, menu_idle, NULL);
+}
+
+void appmanager_prefetch_init(gint budget)
+{
+	const gchar *cache_location;
+	gchar *filename;
+
+	if (history != NULL)
+	{
+		return;
+	}
+
+	budget_bytes = (gint64) (budget < 0 ? PREFETCH_DEFAULT_BUDGET : budget) * 1024 * 1024;
+
+	cache_location = gm_parseconf_get_cache_location();
+	filename = g_strdup_printf("%s-prefetch", gm_parseconf_get_programname());
+	if (cache_location != NULL)
+	{
+		history_file = g_build_filename(cache_location, filename, NULL);
+	}
+	else
+	{
+		history_file = g_build_filename(g_get_user_cache_dir(), filename, NULL);
+	}
+	g_free(filename);
+
+	history = g_key_file_new();
+	g_key_file_load_from_file(history, history_file, G_KEY_FILE_NONE, NULL);
+
+	schedule_prefetch();
+}
+
+void appmanager_prefetch_launched(GPid pid, gm_menu_element *elt)
+{
+	struct pending_record *record;
+	gint launches;
+
+	if (history == NULL)
+	{
+		return;
+	}
+
+	launches = g_key_file_get_integer(history, elt->name, "launches", NULL);
+	g_key_file_set_integer(history, elt->name, "launches", launches + 1);
+	history_changed = TRUE;
+
+	record = g_new(struct pending_record, 1);
+	record->pid = pid;
+	record->elt = elt;
+	record->source = g_timeout_add(PREFETCH_RECORD_DELAY, (GSourceFunc) record_files, record);
+	records = g_list_prepend(records, record);
+
+	schedule_prefetch();
+}
+
+void appmanager_prefetch_stop()
+{
+	struct pending_record *record;
+	GList *l;
+
+	if (history == NULL)
+	{
+		return;
+	}
+
+	if (idle_source != 0)
+	{
+		g_source_remove(idle_source);
+		idle_source = 0;
+	}
+
+	if (thread != NULL)
+	{
+		g_atomic_int_set(&cancelled, TRUE);
+		g_thread_join(thread);
+		thread = NULL;
+	}
+
+	for (l = records; l != NULL; l = l->next)
+	{
+		record = l->data;
+		g_source_remove(record->source);
+		g_free(record);
+	}
+	g_list_free(records);
+	records = NULL;
+
+	save_history();
+	g_key_file_free(history);
+	history = NULL;
+	g_free(history_file);
+	history_file = NULL;
+}
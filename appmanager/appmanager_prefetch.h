@@ -0,0 +1,46 @@
+/**
+ * \file appmanager_prefetch.h
+ * \brief prewarms the page cache with the files of frequently started programs
+ *
+ * Shortly after a program is started the files it mapped are read from
+ * /proc/PID/maps and stored, together with the amount of times the program
+ * was started, in a history file in the cache location. When gappman's menu
+ * has been idle for a while, e.g. right after gappman started, a thread with
+ * idle IO priority asks the kernel to read the files of the most frequently
+ * started programs into the page cache until the IO budget is used up.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_PREFETCH_H__
+#define __GAPPMAN_APPMANAGER_PREFETCH_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+#define PREFETCH_DEFAULT_BUDGET 128 ///< default amount of megabytes prefetched after the menu becomes idle
+
+/**
+* \brief loads the launch history and schedules the first prefetch
+* \param budget maximum amount of megabytes to prefetch after the menu became
+*        idle. Negative values select PREFETCH_DEFAULT_BUDGET, 0 disables
+*        prefetching but still records the history.
+*/
+void appmanager_prefetch_init(gint budget);
+
+/**
+* \brief must be called when a program was started. Schedules recording the
+* files the program maps and postpones prefetching until the menu is idle again.
+* \param pid process ID of the program
+* \param elt menu element of the program
+*/
+void appmanager_prefetch_launched(GPid pid, gm_menu_element *elt);
+
+/**
+* \brief stops prefetching, saves the launch history and frees the prefetcher
+*/
+void appmanager_prefetch_stop();
+
+#endif
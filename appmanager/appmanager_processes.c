@@ -0,0 +1,220 @@
+/**
+ * \file appmanager_processes.c
+ * \brief table of the programs started by gappman
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#include <stdio.h>
+#include <string.h>
+#include "appmanager_processes.h"
+
+static GQueue processes = G_QUEUE_INIT;	///< processes in the order they were started
+static GHashTable *by_pid = NULL;	///< processes indexed by PID
+static GHashTable *by_elt = NULL;	///< most recently started process indexed by menu element
+static volatile gint serial = 0;	///< incremented whenever processes changes, read by the listener thread
+
+static void init_table()
+{
+	if (by_pid == NULL)
+	{
+		by_pid = g_hash_table_new(g_direct_hash, g_direct_equal);
+		by_elt = g_hash_table_new(g_direct_hash, g_direct_equal);
+	}
+}
+
+struct process_info *appmanager_processes_add(GPid pid, gm_menu_element *elt)
+{
+	struct process_info *proc;
+
+	init_table();
+
+	proc = g_new0(struct process_info, 1);
+	proc->PID = pid;
+	proc->menu_elt = elt;
+	if (elt->app_width > 0 && elt->app_height > 0)
+	{
+		proc->width = elt->app_width;
+		proc->height = elt->app_height;
+	}
+	else
+	{
+		appmanager_processes_get_resolution(&proc->width, &proc->height);
+	}
+
+	g_queue_push_tail(&processes, proc);
+	proc->link = g_queue_peek_tail_link(&processes);
+	g_hash_table_insert(by_pid, GINT_TO_POINTER(pid), proc);
+	g_hash_table_insert(by_elt, elt, proc);
+	g_atomic_int_inc(&serial);
+
+	return proc;
+}
+
+gboolean appmanager_processes_remove(struct process_info *proc, gint *width, gint *height)
+{
+	struct process_info *tmp;
+	gboolean was_last;
+	GList *link;
+
+	was_last = proc->link == g_queue_peek_tail_link(&processes);
+
+	g_hash_table_remove(by_pid, GINT_TO_POINTER(proc->PID));
+
+	// another instance of the same element may still be running
+	if (g_hash_table_lookup(by_elt, proc->menu_elt) == proc)
+	{
+		g_hash_table_remove(by_elt, proc->menu_elt);
+		for (link = proc->link->prev; link != NULL; link = link->prev)
+		{
+			tmp = link->data;
+			if (tmp->menu_elt == proc->menu_elt)
+			{
+				g_hash_table_insert(by_elt, tmp->menu_elt, tmp);
+				break;
+			}
+		}
+	}
+
+	g_queue_delete_link(&processes, proc->link);
+	g_atomic_int_inc(&serial);
+
+	// only the most recently started process determines the resolution
+	appmanager_processes_get_resolution(width, height);
+	if (was_last && (*width != proc->width || *height != proc->height))
+	{
+		g_free(proc);
+		return TRUE;
+	}
+
+	g_free(proc);
+	return FALSE;
+}
+
+struct process_info *appmanager_processes_lookup_pid(GPid pid)
+{
+	if (by_pid == NULL)
+	{
+		return NULL;
+	}
+	return g_hash_table_lookup(by_pid, GINT_TO_POINTER(pid));
+}
+
+struct process_info *appmanager_processes_lookup_elt(gm_menu_element *elt)
+{
+	if (by_elt == NULL)
+	{
+		return NULL;
+	}
+	return g_hash_table_lookup(by_elt, elt);
+}
+
+struct process_info *appmanager_processes_lookup_descendant(GPid pid)
+{
+	struct process_info *proc;
+	gint i;
+
+	for (i = 0; i < PROCESSES_MAX_ANCESTORS && pid > 1; i++)
+	{
+		proc = appmanager_processes_lookup_pid(pid);
+		if (proc != NULL)
+		{
+			return proc;
+		}
+		pid = appmanager_processes_get_parent_pid(pid);
+	}
+	return NULL;
+}
+
+void appmanager_processes_raise(struct process_info *proc)
+{
+	g_queue_unlink(&processes, proc->link);
+	g_queue_push_tail_link(&processes, proc->link);
+	g_hash_table_insert(by_elt, proc->menu_elt, proc);
+	g_atomic_int_inc(&serial);
+}
+
+GPid appmanager_processes_get_parent_pid(GPid pid)
+{
+	gchar *filename;
+	gchar *contents = NULL;
+	gchar *pos;
+	gint ppid = 0;
+
+	filename = g_strdup_printf("/proc/%d/stat", pid);
+	if (g_file_get_contents(filename, &contents, NULL, NULL))
+	{
+		// the program name between parentheses may contain spaces
+		pos = strrchr(contents, ')');
+		if (pos == NULL || sscanf(pos + 1, " %*c %d", &ppid) != 1)
+		{
+			ppid = 0;
+		}
+	}
+	g_free(contents);
+	g_free(filename);
+
+	return ppid;
+}
+
+void appmanager_processes_get_resolution(gint *width, gint *height)
+{
+	struct process_info *proc;
+
+	proc = g_queue_peek_tail(&processes);
+	if (proc != NULL)
+	{
+		*width = proc->width;
+		*height = proc->height;
+	}
+	else
+	{
+		*width = -1;
+		*height = -1;
+	}
+}
+
+void appmanager_processes_foreach(GFunc func, gpointer user_data)
+{
+	GList *link;
+	GList *prev;
+
+	for (link = g_queue_peek_tail_link(&processes); link != NULL; link = prev)
+	{
+		// func may remove the process
+		prev = link->prev;
+		func(link->data, user_data);
+	}
+}
+
+guint appmanager_processes_get_serial()
+{
+	return (guint) g_atomic_int_get(&serial);
+}
+
+guint appmanager_processes_get_amount()
+{
+	return g_queue_get_length(&processes);
+}
+
+void appmanager_processes_free()
+{
+	struct process_info *proc;
+
+	while ((proc = g_queue_pop_head(&processes)) != NULL)
+	{
+		g_free(proc);
+	}
+	g_atomic_int_inc(&serial);
+
+	if (by_pid != NULL)
+	{
+		g_hash_table_destroy(by_pid);
+		g_hash_table_destroy(by_elt);
+		by_pid = NULL;
+		by_elt = NULL;
+	}
+}
@@ -0,0 +1,132 @@
+/**
+ * \file appmanager_processes.h
+ * \brief table of the programs started by gappman
+ *
+ * Processes are indexed by PID and by menu element. The table keeps the
+ * processes in the order they were started or, later, activated. This
+ * order is also the resolution stack: the most recently started or
+ * activated process determines the screen resolution.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_PROCESSES_H__
+#define __GAPPMAN_APPMANAGER_PROCESSES_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+#define PROCESSES_MAX_ANCESTORS 8 ///< amount of parent processes checked when looking up the program a process belongs to
+
+/**
+* \brief Struct that holds all relevant info about started applications
+*/
+struct process_info
+{
+	int PID;					///< Process ID of running app (child
+								// replaced through execvp)
+	int status;					///< Exit status of the process as
+								// returned by waitpid. Only valid after
+								// the process exited.
+	gm_menu_element *menu_elt;	///< Pointer to menu_element structure of 
+									// started application
+	gint width;					///< screen width the application runs at,
+								// -1 for gappman's resolution
+	gint height;				///< screen height the application runs at,
+								// -1 for gappman's resolution
+	GList *link;				///< position of this process in the
+								// process table
+};
+
+/**
+* \brief adds a started process to the table. The process runs at the
+* resolution of elt or, if elt has no resolution, at the resolution of the
+* most recently started process.
+* \param pid process ID of the started process
+* \param elt menu element of the started process
+* \return the new process_info structure
+*/
+struct process_info *appmanager_processes_add(GPid pid, gm_menu_element *elt);
+
+/**
+* \brief removes a process from the table and frees it
+* \param proc process that should be removed
+* \param width will hold the screen width that should be restored
+* \param height will hold the screen height that should be restored
+* \return TRUE if the resolution should be changed to width x height. A width
+* and height of -1 mean gappman's resolution.
+*/
+gboolean appmanager_processes_remove(struct process_info *proc, gint *width, gint *height);
+
+/**
+* \brief looks up a process by its process ID
+* \param pid process ID
+* \return process_info structure or NULL if no process with pid was started by gappman
+*/
+struct process_info *appmanager_processes_lookup_pid(GPid pid);
+
+/**
+* \brief looks up the most recently started process of a menu element
+* \param elt menu element
+* \return process_info structure or NULL if elt has no running process
+*/
+struct process_info *appmanager_processes_lookup_elt(gm_menu_element *elt);
+
+/**
+* \brief looks up the program a process belongs to. Programs started through a
+* wrapper may run their windows from a descendant process.
+* \param pid process ID of the program or of one of its descendants
+* \return process_info structure or NULL if pid was not started by gappman
+*/
+struct process_info *appmanager_processes_lookup_descendant(GPid pid);
+
+/**
+* \brief makes proc the most recently started process, so it determines the
+* resolution, e.g. when its window is activated again
+* \param proc process
+*/
+void appmanager_processes_raise(struct process_info *proc);
+
+/**
+* \brief returns the parent of a process, which need not be in the table
+* \param pid process ID
+* \return parent process ID or 0 if pid does not exist
+*/
+GPid appmanager_processes_get_parent_pid(GPid pid);
+
+/**
+* \brief returns the resolution of the most recently started process
+* \param width will hold the screen width or -1 for gappman's resolution
+* \param height will hold the screen height or -1 for gappman's resolution
+*/
+void appmanager_processes_get_resolution(gint *width, gint *height);
+
+/**
+* \brief calls func for each process, starting with the most recently started process
+* \param func function called with the process_info structure and user_data
+* \param user_data passed to func
+*/
+void appmanager_processes_foreach(GFunc func, gpointer user_data);
+
+/**
+* \brief returns a number that changes whenever a process is added, removed
+* or raised, so data derived from the table can be cached. May be called
+* from any thread.
+* \return serial number of the table
+*/
+guint appmanager_processes_get_serial();
+
+/**
+* \brief returns the amount of processes in the table
+* \return amount of processes
+*/
+guint appmanager_processes_get_amount();
+
+/**
+* \brief removes all processes from the table and frees the table
+*/
+void appmanager_processes_free();
+
+#endif
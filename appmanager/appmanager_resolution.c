@@ -0,0 +1,207 @@
+/**
+ * \file appmanager_resolution.c
+ * \brief queues screen resolution switches
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gm_changeresolution.h>
+#include <gm_generic.h>
+#include "appmanager_resolution.h"
+#include "appmanager_events.h"
+
+static gint current_width = -1;	///< screen width the screen runs at or is switching to
+static gint current_height = -1;	///< screen height the screen runs at or is switching to
+static gint target_width = -1;	///< most recently requested screen width
+static gint target_height = -1;	///< most recently requested screen height
+static gboolean switching = FALSE;	///< TRUE until the X server reported the last switch
+static guint settle_source = 0;	///< source id of the delayed switch
+static guint confirm_source = 0;	///< source id of the confirmation timeout
+static GTimer *timer = NULL;	///< measures the duration of a switch
+static gdouble last_duration = -1;	///< milliseconds the last completed switch took
+
+static gboolean switch_resolution(gpointer data);
+
+static void schedule_switch(guint delay)
+{
+	if (settle_source == 0)
+	{
+		settle_source = g_timeout_add(delay, switch_resolution, NULL);
+	}
+}
+
+/**
+* \brief ends the current switch and starts the next one if another
+* resolution was requested in the meantime
+*/
+static void finish_switch()
+{
+	switching = FALSE;
+	if (confirm_source != 0)
+	{
+		g_source_remove(confirm_source);
+		confirm_source = 0;
+	}
+
+	if (target_width != current_width || target_height != current_height)
+	{
+		// the requests were collected while switching
+		schedule_switch(0);
+	}
+}
+
+static void screen_changed(void *user_data)
+{
+	XRRScreenSize size;
+
+	// the resolution may also have been changed by another program
+	if (gm_res_get_current_size(&size) == GM_SUCCESS)
+	{
+		current_width = size.width;
+		current_height = size.height;
+	}
+
+	if (!switching)
+	{
+		return;
+	}
+
+	last_duration = g_timer_elapsed(timer, NULL) * 1000;
+	g_message("Switched resolution to %dx%d in %.1f ms", current_width,
+			  current_height, last_duration);
+	appmanager_events_resolution_changed(current_width, current_height);
+	finish_switch();
+}
+
+static gboolean confirm_timeout(gpointer data)
+{
+	g_warning("Switch to %dx%d was not confirmed within %d ms", current_width,
+			  current_height, RESOLUTION_CONFIRM_TIMEOUT);
+	confirm_source = 0;
+	finish_switch();
+	return FALSE;
+}
+
+/**
+* \brief switches to the most recently requested resolution
+*/
+static gboolean switch_resolution(gpointer data)
+{
+	XRRScreenSize size;
+	gint width = target_width;
+	gint height = target_height;
+
+	settle_source = 0;
+
+	if (switching || (width == current_width && height == current_height))
+	{
+		return FALSE;
+	}
+
+	// the resolution may have been changed by another program
+	if (gm_res_get_current_size(&size) == GM_SUCCESS
+		&& size.width == width && size.height == height)
+	{
+		current_width = width;
+		current_height = height;
+		return FALSE;
+	}
+
+	g_timer_start(timer);
+	if (gm_res_changeresolution(width, height) != GM_SUCCESS)
+	{
+		g_warning("Could not switch resolution to %dx%d", width, height);
+		// do not try again until another resolution is requested
+		target_width = current_width;
+		target_height = current_height;
+		return FALSE;
+	}
+
+	current_width = width;
+	current_height = height;
+	switching = TRUE;
+	confirm_source = g_timeout_add(RESOLUTION_CONFIRM_TIMEOUT, confirm_timeout, NULL);
+
+	return FALSE;
+}
+
+void appmanager_resolution_init(gint width, gint height)
+{
+	current_width = target_width = width;
+	current_height = target_height = height;
+	timer = g_timer_new();
+	gm_res_set_changed_callback(screen_changed, NULL);
+}
+
+void appmanager_resolution_request(gint width, gint height)
+{
+	if (timer == NULL)
+	{
+		return;
+	}
+
+	target_width = width;
+	target_height = height;
+
+	if (!switching)
+	{
+		schedule_switch(RESOLUTION_SETTLE_DELAY);
+	}
+}
+
+void appmanager_resolution_flush()
+{
+	if (timer == NULL)
+	{
+		return;
+	}
+
+	if (settle_source != 0)
+	{
+		g_source_remove(settle_source);
+		settle_source = 0;
+	}
+	if (confirm_source != 0)
+	{
+		g_source_remove(confirm_source);
+		confirm_source = 0;
+	}
+	switching = FALSE;
+
+	switch_resolution(NULL);
+}
+
+gdouble appmanager_resolution_get_last_duration()
+{
+	return last_duration;
+}
+
+void appmanager_resolution_free()
+{
+	if (timer == NULL)
+	{
+		return;
+	}
+
+	gm_res_set_changed_callback(NULL, NULL);
+	if (settle_source != 0)
+	{
+		g_source_remove(settle_source);
+		settle_source = 0;
+	}
+	if (confirm_source != 0)
+	{
+		g_source_remove(confirm_source);
+		confirm_source = 0;
+	}
+	switching = FALSE;
+	g_timer_destroy(timer);
+	timer = NULL;
+}
@@ -0,0 +1,60 @@
+/**
+ * \file appmanager_resolution.h
+ * \brief queues screen resolution switches
+ *
+ * Requests to switch the resolution are not executed immediately. They are
+ * collected for RESOLUTION_SETTLE_DELAY milliseconds and only the last
+ * requested resolution is applied, so starting and stopping programs in
+ * quick succession causes at most one switch. A switch is complete when the
+ * X server reports the new configuration. Requests made while a switch is
+ * in progress are applied after it completed. Switches that must happen
+ * before something else, e.g. before a program starts, are executed right
+ * away using appmanager_resolution_flush.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_RESOLUTION_H__
+#define __GAPPMAN_APPMANAGER_RESOLUTION_H__
+
+#include <glib.h>
+
+#define RESOLUTION_SETTLE_DELAY 150 ///< milliseconds requests are collected before the resolution is switched
+#define RESOLUTION_CONFIRM_TIMEOUT 3000 ///< milliseconds to wait for the X server to report a switch
+
+/**
+* \brief starts the queue. Requires gm_res_init to be called first.
+* \param width current screen width
+* \param height current screen height
+*/
+void appmanager_resolution_init(gint width, gint height);
+
+/**
+* \brief requests a switch to width x height. Earlier requests that were not
+* executed yet are discarded.
+* \param width screen width
+* \param height screen height
+*/
+void appmanager_resolution_request(gint width, gint height);
+
+/**
+* \brief executes the last request immediately instead of waiting for the
+* main loop, e.g. before a program starts or when gappman quits
+*/
+void appmanager_resolution_flush();
+
+/**
+* \brief returns how long the last completed switch took
+* \return milliseconds between the request to the X server and its
+* confirmation, or -1 if no switch completed yet
+*/
+gdouble appmanager_resolution_get_last_duration();
+
+/**
+* \brief stops the queue, requests that were not executed yet are discarded
+*/
+void appmanager_resolution_free();
+
+#endif
@@ -0,0 +1,576 @@
+/**
+ * \file appmanager_sampler.c
+ * \brief samples the CPU, memory and IO usage of started programs
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "appmanager_sampler.h"
+
+#define SAMPLER_MAX_DEPTH 32 ///< maximum amount of parents checked when looking for the program a process descends from
+
+/**
+* \brief a single process of a program
+*/
+struct sampled_task
+{
+	GPid pid;	///< process ID
+	struct resource_history *history;	///< history of the program the process belongs to
+	gint stat_fd;	///< /proc/PID/stat
+	gint statm_fd;	///< /proc/PID/statm
+	gint io_fd;	///< /proc/PID/io, -1 if it can not be read
+	guint64 ticks;	///< user and system time in clock ticks at the last sample
+	guint64 read_bytes;	///< bytes read from storage at the last sample
+	guint64 write_bytes;	///< bytes written to storage at the last sample
+};
+
+static GHashTable *histories = NULL;	///< struct resource_history indexed by process ID of the program
+G_LOCK_DEFINE_STATIC(histories);	///< held while histories or their samples change, appmanager_sampler_get_snapshot formats them in the listener thread
+static GHashTable *owners = NULL;	///< struct resource_history indexed by process ID of every sampled process
+static GSList *unscanned = NULL;	///< process IDs of programs started since the last sample
+static guint sample_source = 0;	///< source id of the sample timer
+static GTimer *timer = NULL;	///< measures the time between samples
+static glong clock_ticks = 100;	///< clock ticks per second
+static glong page_size = 4096;	///< size of a memory page in bytes
+static guint samples_until_scan = 0;	///< samples left until new descendants are looked up
+
+/**
+* \brief reads a file in /proc from the start into buffer
+* \return TRUE if the file could be read. Reads fail as soon as the process
+* the file belongs to exited.
+*/
+static gboolean read_proc_file(gint fd, gchar *buffer, gsize size)
+{
+	ssize_t length;
+
+	if (fd == -1)
+	{
+		return FALSE;
+	}
+
+	length = pread(fd, buffer, size - 1, 0);
+	if (length <= 0)
+	{
+		return FALSE;
+	}
+	buffer[length] = '\0';
+	return TRUE;
+}
+
+/**
+* \brief reads the current usage of a process
+* \return FALSE if the process exited
+*/
+static gboolean read_task(struct sampled_task *task, guint64 *ticks, guint64 *rss,
+						  guint64 *read_bytes, guint64 *write_bytes)
+{
+	gchar buffer[1024];
+	gchar *pos;
+	unsigned long utime;
+	unsigned long stime;
+	unsigned long pages;
+	unsigned long long bytes;
+
+	if (!read_proc_file(task->stat_fd, buffer, sizeof(buffer)))
+	{
+		return FALSE;
+	}
+
+	// the program name may contain spaces and parentheses
+	pos = strrchr(buffer, ')');
+	if (pos == NULL || sscanf(pos + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+							  &utime, &stime) != 2)
+	{
+		return FALSE;
+	}
+	*ticks = (guint64) utime + stime;
+
+	*rss = 0;
+	if (read_proc_file(task->statm_fd, buffer, sizeof(buffer))
+		&& sscanf(buffer, "%*u %lu", &pages) == 1)
+	{
+		*rss = (guint64) pages * page_size;
+	}
+
+	*read_bytes = task->read_bytes;
+	*write_bytes = task->write_bytes;
+	if (read_proc_file(task->io_fd, buffer, sizeof(buffer)))
+	{
+		pos = strstr(buffer, "\nread_bytes:");
+		if (pos != NULL && sscanf(pos, "\nread_bytes: %llu", &bytes) == 1)
+		{
+			*read_bytes = bytes;
+		}
+		pos = strstr(buffer, "\nwrite_bytes:");
+		if (pos != NULL && sscanf(pos, "\nwrite_bytes: %llu", &bytes) == 1)
+		{
+			*write_bytes = bytes;
+		}
+	}
+
+	return TRUE;
+}
+
+static gint open_proc_file(GPid pid, const gchar *name)
+{
+	gchar filename[64];
+
+	g_snprintf(filename, sizeof(filename), "/proc/%d/%s", pid, name);
+	return open(filename, O_RDONLY | O_CLOEXEC);
+}
+
+static void free_task(struct sampled_task *task)
+{
+	if (g_hash_table_lookup(owners, GINT_TO_POINTER(task->pid)) == task->history)
+	{
+		g_hash_table_remove(owners, GINT_TO_POINTER(task->pid));
+	}
+	close(task->stat_fd);
+	if (task->statm_fd != -1)
+	{
+		close(task->statm_fd);
+	}
+	if (task->io_fd != -1)
+	{
+		close(task->io_fd);
+	}
+	g_free(task);
+}
+
+/**
+* \brief starts sampling a process of a program. Usage before this call is
+* not counted.
+*/
+static void add_task(struct resource_history *history, GPid pid)
+{
+	struct sampled_task *task;
+	guint64 rss;
+
+	if (g_hash_table_lookup(owners, GINT_TO_POINTER(pid)) != NULL)
+	{
+		return;
+	}
+
+	task = g_new0(struct sampled_task, 1);
+	task->pid = pid;
+	task->history = history;
+	task->stat_fd = open_proc_file(pid, "stat");
+	if (task->stat_fd == -1)
+	{
+		g_free(task);
+		return;
+	}
+	task->statm_fd = open_proc_file(pid, "statm");
+	task->io_fd = open_proc_file(pid, "io");
+
+	if (!read_task(task, &task->ticks, &rss, &task->read_bytes, &task->write_bytes))
+	{
+		free_task(task);
+		return;
+	}
+
+	g_hash_table_insert(history->tasks, GINT_TO_POINTER(pid), task);
+	g_hash_table_insert(owners, GINT_TO_POINTER(pid), history);
+}
+
+static void free_history(struct resource_history *history)
+{
+	g_hash_table_destroy(history->tasks);
+	g_free(history);
+}
+
+static struct resource_history *lookup_history_of_task(GPid pid)
+{
+	return g_hash_table_lookup(owners, GINT_TO_POINTER(pid));
+}
+
+/**
+* \brief adds the descendants of a process to the history of its program,
+* using the children lists of its threads. Kernels without these lists leave
+* the descendants to scan_descendants.
+* \param history history of the program
+* \param pid process ID of a sampled process
+* \param depth amount of parents between pid and the program
+*/
+static void scan_children(struct resource_history *history, GPid pid, gint depth)
+{
+	struct dirent *entry;
+	gchar filename[64];
+	gchar *contents;
+	gchar *pos;
+	gchar *end;
+	DIR *dir;
+	GPid child;
+
+	if (depth >= SAMPLER_MAX_DEPTH)
+	{
+		return;
+	}
+
+	g_snprintf(filename, sizeof(filename), "/proc/%d/task", pid);
+	dir = opendir(filename);
+	if (dir == NULL)
+	{
+		return;
+	}
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (atoi(entry->d_name) <= 0)
+		{
+			continue;
+		}
+
+		g_snprintf(filename, sizeof(filename), "/proc/%d/task/%s/children",
+				   pid, entry->d_name);
+		if (!g_file_get_contents(filename, &contents, NULL, NULL))
+		{
+			continue;
+		}
+		for (pos = contents; *pos != '\0'; pos = end)
+		{
+			child = strtol(pos, &end, 10);
+			if (end == pos)
+			{
+				break;
+			}
+			if (child > 0 && lookup_history_of_task(child) == NULL)
+			{
+				add_task(history, child);
+				scan_children(history, child, depth + 1);
+			}
+		}
+		g_free(contents);
+	}
+	closedir(dir);
+}
+
+/**
+* \brief looks up processes that descend from a sampled process but are not
+* sampled yet
+*/
+static void scan_descendants()
+{
+	struct resource_history *history;
+	GHashTable *parents;
+	GHashTableIter iter;
+	struct dirent *entry;
+	gchar filename[64];
+	gchar *contents;
+	gchar *pos;
+	gpointer key;
+	gpointer value;
+	DIR *dir;
+	GPid pid;
+	GPid parent;
+	gint depth;
+
+	dir = opendir("/proc");
+	if (dir == NULL)
+	{
+		return;
+	}
+
+	parents = g_hash_table_new(g_direct_hash, g_direct_equal);
+	while ((entry = readdir(dir)) != NULL)
+	{
+		pid = atoi(entry->d_name);
+		if (pid <= 0)
+		{
+			continue;
+		}
+
+		g_snprintf(filename, sizeof(filename), "/proc/%d/stat", pid);
+		if (!g_file_get_contents(filename, &contents, NULL, NULL))
+		{
+			continue;
+		}
+		pos = strrchr(contents, ')');
+		if (pos != NULL && sscanf(pos + 2, "%*c %d", &parent) == 1)
+		{
+			g_hash_table_insert(parents, GINT_TO_POINTER(pid), GINT_TO_POINTER(parent));
+		}
+		g_free(contents);
+	}
+	closedir(dir);
+
+	g_hash_table_iter_init(&iter, parents);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		if (lookup_history_of_task(GPOINTER_TO_INT(key)) != NULL)
+		{
+			continue;
+		}
+
+		parent = GPOINTER_TO_INT(value);
+		for (depth = 0; depth < SAMPLER_MAX_DEPTH && parent > 1; depth++)
+		{
+			history = lookup_history_of_task(parent);
+			if (history != NULL)
+			{
+				add_task(history, GPOINTER_TO_INT(key));
+				break;
+			}
+			parent = GPOINTER_TO_INT(g_hash_table_lookup(parents, GINT_TO_POINTER(parent)));
+		}
+	}
+
+	g_hash_table_destroy(parents);
+}
+
+/**
+* \brief adds a sample to the history of a program
+* \param history history of the program
+* \param now seconds since the epoch
+* \param elapsed seconds since the previous sample
+*/
+static void sample_history(struct resource_history *history, glong now, gdouble elapsed)
+{
+	struct resource_sample *sample;
+	struct sampled_task *task;
+	GHashTableIter iter;
+	guint64 ticks = 0;
+	guint64 rss = 0;
+	guint64 read_bytes = 0;
+	guint64 write_bytes = 0;
+	guint64 task_ticks;
+	guint64 task_rss;
+	guint64 task_read;
+	guint64 task_write;
+
+	g_hash_table_iter_init(&iter, history->tasks);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &task))
+	{
+		if (!read_task(task, &task_ticks, &task_rss, &task_read, &task_write))
+		{
+			g_hash_table_iter_remove(&iter);
+			continue;
+		}
+
+		ticks += task_ticks - task->ticks;
+		rss += task_rss;
+		read_bytes += task_read - task->read_bytes;
+		write_bytes += task_write - task->write_bytes;
+
+		task->ticks = task_ticks;
+		task->read_bytes = task_read;
+		task->write_bytes = task_write;
+	}
+
+	// only the update of the ring buffer is visible to the listener thread
+	G_LOCK(histories);
+	sample = &history->samples[history->next];
+	sample->time = now;
+	sample->cpu = elapsed > 0 ? (guint) (ticks * 1000 / (clock_ticks * elapsed)) : 0;
+	sample->rss = rss;
+	sample->read_bytes = read_bytes;
+	sample->write_bytes = write_bytes;
+
+	history->next = (history->next + 1) % SAMPLER_HISTORY;
+	if (history->count < SAMPLER_HISTORY)
+	{
+		history->count++;
+	}
+	G_UNLOCK(histories);
+}
+
+static gboolean sample(gpointer data)
+{
+	struct resource_history *history;
+	GHashTableIter iter;
+	gdouble elapsed;
+	glong now;
+	GSList *l;
+
+	// programs started through a wrapper create their processes right
+	// away, look these up without walking all of /proc
+	for (l = unscanned; l != NULL; l = l->next)
+	{
+		history = g_hash_table_lookup(histories, l->data);
+		if (history != NULL)
+		{
+			scan_children(history, history->pid, 0);
+		}
+	}
+	g_slist_free(unscanned);
+	unscanned = NULL;
+
+	if (samples_until_scan == 0)
+	{
+		scan_descendants();
+		samples_until_scan = SAMPLER_SCAN_EVERY;
+	}
+	samples_until_scan--;
+
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_start(timer);
+	now = time(NULL);
+
+	g_hash_table_iter_init(&iter, histories);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &history))
+	{
+		sample_history(history, now, elapsed);
+	}
+
+	return TRUE;
+}
+
+void appmanager_sampler_init(gint interval)
+{
+	if (histories != NULL || interval == 0)
+	{
+		return;
+	}
+
+	if (interval < 0)
+	{
+		interval = SAMPLER_DEFAULT_INTERVAL;
+	}
+
+	clock_ticks = sysconf(_SC_CLK_TCK);
+	page_size = sysconf(_SC_PAGESIZE);
+
+	G_LOCK(histories);
+	histories = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+									  (GDestroyNotify) free_history);
+	G_UNLOCK(histories);
+	owners = g_hash_table_new(g_direct_hash, g_direct_equal);
+	timer = g_timer_new();
+	sample_source = g_timeout_add(interval, sample, NULL);
+}
+
+void appmanager_sampler_process_started(GPid pid, gm_menu_element *elt)
+{
+	struct resource_history *history;
+
+	if (histories == NULL)
+	{
+		return;
+	}
+
+	history = g_new0(struct resource_history, 1);
+	history->pid = pid;
+	history->menu_elt = elt;
+	history->tasks = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+										   (GDestroyNotify) free_task);
+	add_task(history, pid);
+	G_LOCK(histories);
+	g_hash_table_replace(histories, GINT_TO_POINTER(pid), history);
+	G_UNLOCK(histories);
+
+	// the program has no children yet, they are looked up at the next sample
+	unscanned = g_slist_prepend(unscanned, GINT_TO_POINTER(pid));
+}
+
+void appmanager_sampler_process_exited(GPid pid)
+{
+	if (histories == NULL)
+	{
+		return;
+	}
+
+	G_LOCK(histories);
+	g_hash_table_remove(histories, GINT_TO_POINTER(pid));
+	G_UNLOCK(histories);
+}
+
+void appmanager_sampler_foreach(GFunc func, gpointer user_data)
+{
+	GHashTableIter iter;
+	gpointer history;
+
+	if (histories == NULL)
+	{
+		return;
+	}
+
+	g_hash_table_iter_init(&iter, histories);
+	while (g_hash_table_iter_next(&iter, NULL, &history))
+	{
+		func(history, user_data);
+	}
+}
+
+gchar *appmanager_sampler_to_string(struct resource_history *history)
+{
+	struct resource_sample *sample;
+	GString *str;
+	guint first;
+	guint i;
+
+	str = g_string_new(NULL);
+	g_string_append_printf(str, "name::%s::pid::%d::samples::",
+						   history->menu_elt->name, history->pid);
+
+	first = (history->next + SAMPLER_HISTORY - history->count) % SAMPLER_HISTORY;
+	for (i = 0; i < history->count; i++)
+	{
+		sample = &history->samples[(first + i) % SAMPLER_HISTORY];
+		g_string_append_printf(str, "%s%ld,%u,%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT
+							   ",%" G_GUINT64_FORMAT, i > 0 ? ";" : "",
+							   sample->time, sample->cpu, sample->rss,
+							   sample->read_bytes, sample->write_bytes);
+	}
+
+	return g_string_free(str, FALSE);
+}
+
+gchar **appmanager_sampler_get_snapshot()
+{
+	GPtrArray *list;
+	GHashTableIter iter;
+	gpointer history;
+
+	G_LOCK(histories);
+	if (histories == NULL)
+	{
+		G_UNLOCK(histories);
+		return NULL;
+	}
+
+	list = g_ptr_array_sized_new(g_hash_table_size(histories) + 1);
+	g_hash_table_iter_init(&iter, histories);
+	while (g_hash_table_iter_next(&iter, NULL, &history))
+	{
+		g_ptr_array_add(list, appmanager_sampler_to_string(history));
+	}
+	G_UNLOCK(histories);
+	g_ptr_array_add(list, NULL);
+
+	return (gchar **) g_ptr_array_free(list, FALSE);
+}
+
+void appmanager_sampler_free()
+{
+	if (histories == NULL)
+	{
+		return;
+	}
+
+	g_source_remove(sample_source);
+	sample_source = 0;
+	G_LOCK(histories);
+	g_hash_table_destroy(histories);
+	histories = NULL;
+	G_UNLOCK(histories);
+	g_hash_table_destroy(owners);
+	owners = NULL;
+	g_slist_free(unscanned);
+	unscanned = NULL;
+	g_timer_destroy(timer);
+	timer = NULL;
+}
@@ -0,0 +1,104 @@
+/**
+ * \file appmanager_sampler.h
+ * \brief samples the CPU, memory and IO usage of started programs
+ *
+ * Every sample interval the usage of each started program and all its
+ * descendants is read from /proc/PID/stat, /proc/PID/statm and /proc/PID/io
+ * and added to a time series of the last SAMPLER_HISTORY samples. The files
+ * are opened once per process and read with pread, so taking a sample does
+ * not allocate memory. The descendants of a program that was just started
+ * are looked up at the next sample from the children lists of its
+ * processes. Descendants created later are looked up in /proc every
+ * SAMPLER_SCAN_EVERY samples.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_SAMPLER_H__
+#define __GAPPMAN_APPMANAGER_SAMPLER_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+#define SAMPLER_DEFAULT_INTERVAL 5000 ///< default milliseconds between samples
+#define SAMPLER_HISTORY 120 ///< amount of samples kept per program
+#define SAMPLER_SCAN_EVERY 6 ///< amount of samples after which new descendants are looked up
+
+/**
+* \brief resource usage of a program and its descendants during one sample interval
+*/
+struct resource_sample
+{
+	glong time;	///< seconds since the epoch at which the sample was taken
+	guint cpu;	///< CPU usage in tenths of a percent of a single CPU
+	guint64 rss;	///< resident memory in bytes at the time of the sample
+	guint64 read_bytes;	///< bytes read from storage during the interval
+	guint64 write_bytes;	///< bytes written to storage during the interval
+};
+
+/**
+* \brief time series of a started program
+*/
+struct resource_history
+{
+	GPid pid;	///< process ID of the program
+	gm_menu_element *menu_elt;	///< menu element of the program
+	struct resource_sample samples[SAMPLER_HISTORY];	///< ring buffer of samples
+	guint next;	///< position of the next sample in samples
+	guint count;	///< amount of valid samples
+	GHashTable *tasks;	///< processes of the program indexed by process ID
+};
+
+/**
+* \brief starts sampling
+* \param interval milliseconds between samples, 0 disables sampling and -1
+* selects SAMPLER_DEFAULT_INTERVAL
+*/
+void appmanager_sampler_init(gint interval);
+
+/**
+* \brief must be called when a program was started
+* \param pid process ID of the program
+* \param elt menu element of the program
+*/
+void appmanager_sampler_process_started(GPid pid, gm_menu_element *elt);
+
+/**
+* \brief must be called when a program exited. Its history is discarded.
+* \param pid process ID of the program
+*/
+void appmanager_sampler_process_exited(GPid pid);
+
+/**
+* \brief calls func for the history of each sampled program
+* \param func function called with the resource_history structure and user_data
+* \param user_data passed to func
+*/
+void appmanager_sampler_foreach(GFunc func, gpointer user_data);
+
+/**
+* \brief formats the history of a program, oldest sample first
+* \param history history of a program
+* \return `name::<PROGRAMNAME>::pid::<PID>::samples::<TIME>,<CPU>,<RSS>,<READ>,<WRITE>[;<TIME>,...]`.
+* Must be freed with g_free.
+*/
+gchar *appmanager_sampler_to_string(struct resource_history *history);
+
+/**
+* \brief returns the histories as formatted by appmanager_sampler_to_string.
+* The histories are formatted on each call, under a lock the sampler only
+* holds while it adds a sample or a program, so this may be called from any
+* thread.
+* \return NULL terminated list or NULL if sampling is disabled. Must be freed
+* with g_strfreev.
+*/
+gchar **appmanager_sampler_get_snapshot();
+
+/**
+* \brief stops sampling and frees all histories
+*/
+void appmanager_sampler_free();
+
+#endif
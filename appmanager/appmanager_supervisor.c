@@ -0,0 +1,237 @@
+/**
+ * \file appmanager_supervisor.c
+ * \brief restarts programs that exited according to their restart policy
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#include <string.h>
+#include <sys/wait.h>
+#include "appmanager_supervisor.h"
+
+/**
+* Restart policies
+*/
+typedef enum restart_policies
+{
+	RESTART_NEVER,	///< never restart the program
+	RESTART_ALWAYS,	///< restart the program whenever it exits
+	RESTART_ON_FAILURE	///< restart the program if it did not exit successfully
+} RestartPolicy;
+
+/**
+* \brief holds the restart state of a single program
+*/
+struct supervised_program
+{
+	gm_menu_element *elt;	///< menu element of the program
+	GTimer *running;	///< measures how long the program has been running
+	gint backoff;	///< milliseconds to wait before the next restart
+	gint restarts;	///< amount of restarts since the program last ran longer than the interval
+	gint status;	///< exit status of the last run as returned by waitpid
+	guint source;	///< source id of a pending restart
+};
+
+static GHashTable *programs = NULL;	///< struct supervised_program indexed by menu element
+static SUPERVISOR_FUNC start_program = NULL;
+
+static RestartPolicy parse_policy(gm_menu_element *elt)
+{
+	if (elt->restart == NULL || strcmp(elt->restart, "never") == 0)
+	{
+		return RESTART_NEVER;
+	}
+	else if (strcmp(elt->restart, "always") == 0)
+	{
+		return RESTART_ALWAYS;
+	}
+	else if (strcmp(elt->restart, "on-failure") == 0)
+	{
+		return RESTART_ON_FAILURE;
+	}
+
+	g_warning("supervisor: unknown restart policy %s for %s", elt->restart, elt->name);
+	return RESTART_NEVER;
+}
+
+static gint get_setting(gint value, gint default_value)
+{
+	return value >= 0 ? value : default_value;
+}
+
+static void free_program(struct supervised_program *program)
+{
+	if (program->source != 0)
+	{
+		g_source_remove(program->source);
+	}
+	g_timer_destroy(program->running);
+	g_free(program);
+}
+
+static struct supervised_program *lookup_program(gm_menu_element *elt)
+{
+	struct supervised_program *program;
+
+	program = g_hash_table_lookup(programs, elt);
+	if (program == NULL)
+	{
+		program = g_new0(struct supervised_program, 1);
+		program->elt = elt;
+		program->running = g_timer_new();
+		program->backoff = get_setting(elt->restart_backoff, SUPERVISOR_DEFAULT_BACKOFF);
+		g_hash_table_insert(programs, elt, program);
+	}
+	return program;
+}
+
+static void log_exit_status(struct supervised_program *program)
+{
+	if (WIFEXITED(program->status))
+	{
+		g_message("supervisor: %s exited with status %d after %.1f s",
+				  program->elt->name, WEXITSTATUS(program->status),
+				  g_timer_elapsed(program->running, NULL));
+	}
+	else if (WIFSIGNALED(program->status))
+	{
+		g_message("supervisor: %s was killed by signal %d (%s) after %.1f s",
+				  program->elt->name, WTERMSIG(program->status),
+				  g_strsignal(WTERMSIG(program->status)),
+				  g_timer_elapsed(program->running, NULL));
+	}
+}
+
+static gboolean schedule_restart(struct supervised_program *program);
+
+static gboolean restart_program(struct supervised_program *program)
+{
+	program->source = 0;
+
+	g_message("supervisor: restarting %s", program->elt->name);
+	if (!start_program(program->elt))
+	{
+		// try again later, this counts as another restart
+		schedule_restart(program);
+	}
+	return FALSE;
+}
+
+/**
+* \brief schedules the next restart of a program, unless the program
+* exceeded its restart limit
+* \return TRUE if a restart was scheduled
+*/
+static gboolean schedule_restart(struct supervised_program *program)
+{
+	gm_menu_element *elt = program->elt;
+	gint limit;
+	gint delay;
+
+	limit = get_setting(elt->restart_limit, SUPERVISOR_DEFAULT_LIMIT);
+	if (program->restarts >= limit)
+	{
+		g_warning("supervisor: %s restarted %d times within %d s, giving up",
+				  elt->name, program->restarts,
+				  get_setting(elt->restart_interval, SUPERVISOR_DEFAULT_INTERVAL));
+		return FALSE;
+	}
+
+	delay = program->backoff;
+	program->backoff = MIN(delay * 2, get_setting(elt->restart_max_backoff,
+												 SUPERVISOR_DEFAULT_MAX_BACKOFF));
+	program->backoff = MAX(program->backoff, 1);
+	program->restarts++;
+
+	program->source = g_timeout_add(delay, (GSourceFunc) restart_program, program);
+
+	return TRUE;
+}
+
+void appmanager_supervisor_init(SUPERVISOR_FUNC start)
+{
+	if (programs == NULL)
+	{
+		programs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+										 (GDestroyNotify) free_program);
+	}
+	start_program = start;
+}
+
+void appmanager_supervisor_process_started(gm_menu_element *elt)
+{
+	struct supervised_program *program;
+
+	if (programs == NULL || parse_policy(elt) == RESTART_NEVER)
+	{
+		return;
+	}
+
+	program = lookup_program(elt);
+	g_timer_start(program->running);
+}
+
+gboolean appmanager_supervisor_process_exited(gm_menu_element *elt, gint status)
+{
+	struct supervised_program *program;
+	RestartPolicy policy;
+	gboolean failed;
+
+	if (programs == NULL)
+	{
+		return FALSE;
+	}
+
+	policy = parse_policy(elt);
+	if (policy == RESTART_NEVER)
+	{
+		return FALSE;
+	}
+
+	program = lookup_program(elt);
+	program->status = status;
+	log_exit_status(program);
+
+	if (program->source != 0)
+	{
+		// another instance of the program is already being restarted
+		return FALSE;
+	}
+
+	// a program that ran long enough is no longer crash looping
+	if (g_timer_elapsed(program->running, NULL)
+		>= get_setting(elt->restart_interval, SUPERVISOR_DEFAULT_INTERVAL))
+	{
+		program->restarts = 0;
+		program->backoff = get_setting(elt->restart_backoff, SUPERVISOR_DEFAULT_BACKOFF);
+	}
+
+	failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	if (policy == RESTART_ON_FAILURE && !failed)
+	{
+		return FALSE;
+	}
+
+	return schedule_restart(program);
+}
+
+void appmanager_supervisor_reset()
+{
+	if (programs != NULL)
+	{
+		g_hash_table_remove_all(programs);
+	}
+}
+
+void appmanager_supervisor_stop()
+{
+	if (programs != NULL)
+	{
+		g_hash_table_destroy(programs);
+		programs = NULL;
+	}
+	start_program = NULL;
+}
@@ -0,0 +1,71 @@
+/**
+ * \file appmanager_supervisor.h
+ * \brief restarts programs that exited according to their restart policy
+ *
+ * The restart policy of a program is set in the configuration file:
+ *
+ *   <restart backoff="MILLISECONDS" maxbackoff="MILLISECONDS" limit="N" interval="SECONDS">POLICY</restart>
+ *
+ * POLICY is "never" (default), "always" or "on-failure". A program is
+ * restarted backoff milliseconds after it exited. The delay doubles with
+ * every restart up to maxbackoff. If a program is restarted more than limit
+ * times within interval seconds it is considered to be crash looping and is
+ * no longer restarted. A program that ran for longer than interval seconds
+ * starts over with the initial delay.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_APPMANAGER_SUPERVISOR_H__
+#define __GAPPMAN_APPMANAGER_SUPERVISOR_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+#define SUPERVISOR_DEFAULT_BACKOFF 100 ///< default milliseconds to wait before the first restart
+#define SUPERVISOR_DEFAULT_MAX_BACKOFF 30000 ///< default maximum milliseconds to wait before a restart
+#define SUPERVISOR_DEFAULT_LIMIT 5 ///< default maximum amount of restarts within the interval
+#define SUPERVISOR_DEFAULT_INTERVAL 60 ///< default interval in seconds
+
+/**
+* \brief function used to restart a program
+* \param elt menu element of the program
+* \return TRUE if the program was started, FALSE otherwise
+*/
+typedef gboolean (*SUPERVISOR_FUNC) (gm_menu_element *elt);
+
+/**
+* \brief initializes the supervisor
+* \param start function used to restart a program
+*/
+void appmanager_supervisor_init(SUPERVISOR_FUNC start);
+
+/**
+* \brief must be called when a program was started
+* \param elt menu element of the program
+*/
+void appmanager_supervisor_process_started(gm_menu_element *elt);
+
+/**
+* \brief must be called when a started program exits. Schedules a restart
+* if the restart policy of the program requires it.
+* \param elt menu element of the program
+* \param status exit status as returned by waitpid
+* \return TRUE if the program will be restarted, FALSE otherwise
+*/
+gboolean appmanager_supervisor_process_exited(gm_menu_element *elt, gint status);
+
+/**
+* \brief cancels all pending restarts and forgets the restart history of
+* all programs. The supervisor stays initialized.
+*/
+void appmanager_supervisor_reset();
+
+/**
+* \brief cancels all pending restarts and frees the supervisor
+*/
+void appmanager_supervisor_stop();
+
+#endif
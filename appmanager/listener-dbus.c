@@ -25,6 +25,7 @@ G_DEFINE_TYPE(GmAppmanager, gm_appmanager, G_TYPE_OBJECT);	///< will create
 															// gm_appmanager_parent_class
 
 static const gchar *confpath = "";
+static DBusGProxy *bus_proxy = NULL;	///< proxy for the bus daemon
 
 gboolean send_confpath(GmAppmanager * obj, gchar ** path,
 							  GError ** error)
@@ -52,51 +53,121 @@ gboolean send_fontsize(GmAppmanager * obj, gint * fontsize,
 	return TRUE;
 }
 
+static void add_process(struct process_info *proc, GPtrArray *proceslist)
+{
+	g_ptr_array_add(proceslist, g_strdup_printf("name::%s::pid::%d",
+											   proc->menu_elt->name,
+											   proc->PID));
+}
+
 gboolean send_proceslist(GmAppmanager * obj, gchar *** proceslist,
 								GError ** error)
 {
-	struct process_info *started_apps;
-	gchar *msg = NULL;
-	int number_of_appws = 0;
-	int i;
+	GPtrArray *list;
 
 	*proceslist = NULL;
 
-	// gdk_thread lock??
+	if (appmanager_processes_get_amount() == 0)
+	{
+		return TRUE;
+	}
+
+	list = g_ptr_array_sized_new(appmanager_processes_get_amount() + 1);
+	appmanager_processes_foreach((GFunc) add_process, list);
+	g_ptr_array_add(list, NULL);
+	*proceslist = (gchar **) g_ptr_array_free(list, FALSE);
+
+	return TRUE;
+}
+
+static void add_latency(struct latency_histogram *hist, GPtrArray *latencies)
+{
+	g_ptr_array_add(latencies, appmanager_latency_to_string(hist));
+}
+
+gboolean send_latency(GmAppmanager * obj, gchar *** latencies,
+							 GError ** error)
+{
+	GPtrArray *list;
+
+	list = g_ptr_array_new();
+	appmanager_latency_foreach((GFunc) add_latency, list);
+	g_ptr_array_add(list, NULL);
+	*latencies = (gchar **) g_ptr_array_free(list, FALSE);
+
+	return TRUE;
+}
+
+static void add_resources(struct resource_history *history, GPtrArray *histories)
+{
+	g_ptr_array_add(histories, appmanager_sampler_to_string(history));
+}
+
+gboolean send_resources(GmAppmanager * obj, gchar *** histories,
+							   GError ** error)
+{
+	GPtrArray *list;
+
+	list = g_ptr_array_new();
+	appmanager_sampler_foreach((GFunc) add_resources, list);
+	g_ptr_array_add(list, NULL);
+	*histories = (gchar **) g_ptr_array_free(list, FALSE);
 
+	return TRUE;
+}
 
-	started_apps = appmanager_get_started_apps();
-	while (started_apps != NULL)
+gboolean send_output(GmAppmanager * obj, gchar * name, gint max,
+							gchar ** output, GError ** error)
+{
+	*output = appmanager_output_tail(name, max > 0 ? max : 0);
+	if (*output == NULL)
 	{
-		number_of_appws++;
-		*proceslist =
-			(gchar **) realloc(*proceslist,
-							   (number_of_appws + 1) * sizeof(gchar *));
-		if (*proceslist == NULL)
-		{
-			g_warning("Could not reallocate memory. errno: %d", errno);
-			return FALSE;
-		}
-
-		msg = (gchar *) malloc((256) * sizeof(gchar));
-		if (msg == NULL)
-		{
-			g_warning("Could not allocate memory. errno: %d", errno);
-			return FALSE;
-		}
-		g_snprintf(msg, 256, "name::%s::pid::%d", started_apps->menu_elt->name,
-				   started_apps->PID);
-		(*proceslist)[number_of_appws - 1] = msg;
-		started_apps = started_apps->prev;
+		*output = g_strdup("");
 	}
+	return TRUE;
+}
+
+static void processes_stopped(guint killed, DBusGMethodInvocation * context)
+{
+	dbus_g_method_return(context, (gint) killed);
+}
 
-	if (number_of_appws > 0)
+/**
+* \brief asks the bus daemon for the process ID of the sender of a call
+* \return process ID, 0 if unknown
+*/
+static GPid get_sender_pid(DBusGMethodInvocation * context)
+{
+	GError *error = NULL;
+	gchar *sender;
+	guint pid = 0;
+
+	sender = dbus_g_method_get_sender(context);
+	if (sender == NULL || bus_proxy == NULL)
 	{
-		(*proceslist)[number_of_appws] = NULL;
+		g_free(sender);
+		return 0;
 	}
+	if (!dbus_g_proxy_call(bus_proxy, "GetConnectionUnixProcessID", &error,
+						   G_TYPE_STRING, sender, G_TYPE_INVALID,
+						   G_TYPE_UINT, &pid, G_TYPE_INVALID))
+	{
+		g_warning("Could not get process ID of %s: %s", sender, error->message);
+		g_error_free(error);
+		pid = 0;
+	}
+	g_free(sender);
+	return (GPid) pid;
+}
 
-	// gdk_thread lock??
-
+/**
+* \brief handled asynchronously, the reply is sent once all programs exited.
+* The program of the sender is not stopped.
+*/
+gboolean stop_processes(GmAppmanager * obj, DBusGMethodInvocation * context)
+{
+	appmanager_stop_processes(get_sender_pid(context),
+							  (STOP_FUNC) processes_stopped, context);
 	return TRUE;
 }
 
@@ -119,7 +190,6 @@ static void gm_appmanager_init(GmAppmanager * self)
 gboolean listener_dbus_start_session()
 {
 	DBusGConnection *bus;
-	DBusGProxy *bus_proxy;
 	GError *error = NULL;
 	GmAppmanager *obj;
 	guint request_name_result;
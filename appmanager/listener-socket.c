@@ -1,30 +1,67 @@
 /**
  * \file listener-socket.c
  *
+ * Every accepted connection has its own non-blocking watch. Received bytes
+ * are collected until a newline ends a message, after which the reply is
+ * written as far as the client accepts it. A connection serves a single
+ * message unless the client sends ::keepalive::, after which it may send
+ * any amount of messages, also without waiting for the replies. After
+ * ::subscribe:: the connection only carries events. Connections
+ * that exceed LISTENER_MAX_MESSAGE_SIZE, make no progress for
+ * LISTENER_IDLE_TIMEOUT or do not complete a message within
+ * LISTENER_READ_TIMEOUT are closed, so a client can not stall gappman.
+ * Subscribers that let more than LISTENER_MAX_EVENT_QUEUE bytes of events
+ * pile up are disconnected.
  *
+ * Replies are formatted into the send buffer of the connection, which is
+ * written with a single send as far as the client accepts it. The process
+ * list, fontsize, configuration path and window geometry replies are cached
+ * and only formatted again when the data they were formatted from changed.
+ *
+ * The listener runs in its own thread with its own GMainContext, so clients
+ * do not delay input handling and drawing. That thread answers the messages
+ * that only read the cached replies, the latency and resource snapshots the
+ * GTK thread publishes and the captured output. Messages that change
+ * gappman's state, and requests for the process list after the process
+ * table changed, are handled by the GTK thread in an idle callback. Their reply is handed back to the listener
+ * thread, which handles the next message of the connection after that.
+ *
+ * gappman listens on a unix domain socket in a directory only its user can
+ * access, see gm_get_listener_socket_path(). Connections of processes owned
+ * by other users are refused. Listening on TCP port LISTENER_TCP_PORT of the
+ * loopback address, which any local user can connect to, must be enabled in
+ * the configuration file.
  *
  * GPL v2
  *
  * Authors:
  *   Martijn Brekhof <m.brekhof@gmail.com>
- * 
- * \bug When client sends a message that does not end with a newline gappman stalls as the g_io_read_line function in handleconnection keeps waiting.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "listener-socket.h"
 
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <glib.h>
 #include <glib/gprintf.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <string.h>
 #include <stdlib.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <gm_generic.h>
 #include <gm_layout.h>
 #include "appmanager.h"
+#include "appmanager_events.h"
 
 #define SEND_PROCESS_LIST 1		///< message id used to specify we received a
 								// request to sent the current list of
@@ -38,14 +75,103 @@
 								// request to sent the configuration path
 								// gappman uses
 #define SEND_WINDOWGEOMETRY 5 ///< message id used to specify we received a request to sent the window geometry
+#define SEND_LATENCY 6 ///< message id used to specify we received a request to sent the launch-to-window latencies
+#define STOP_PROCESSES 7 ///< message id used to specify we received a request to stop all programs started by gappman
+#define SEND_OUTPUT 8 ///< message id used to specify we received a request to sent the captured output of a program
+#define SEND_RESOURCES 9 ///< message id used to specify we received a request to sent the resource usage history of the started programs
+#define KEEPALIVE 10 ///< message id used to specify we received a request to keep the connection open for more messages
+#define SUBSCRIBE 11 ///< message id used to specify we received a request to sent events
+
+#define LISTENER_MAX_MESSAGE_SIZE 4096 ///< maximum length in bytes of a received message
+#define LISTENER_READ_TIMEOUT 5000 ///< milliseconds a client gets to send a complete message
+#define LISTENER_IDLE_TIMEOUT 2000 ///< milliseconds a connection may not make progress while reading or writing
+#define LISTENER_MAX_CONNECTIONS 32 ///< maximum amount of connections handled at once
+#define LISTENER_READ_SIZE 512 ///< bytes read from a connection at once
+#define LISTENER_KEEPALIVE_TIMEOUT 60000 ///< milliseconds a kept alive connection may wait for its next message
+#define LISTENER_MAX_PENDING_REPLY 262144 ///< bytes of unsent replies after which no more messages are read from a connection
+#define LISTENER_MAX_EVENT_QUEUE 65536 ///< bytes of unsent events after which a subscriber is disconnected
+#define LISTENER_TCP_PORT "2103" ///< port gappman listens on if the TCP listener is enabled
+
+/**
+* \brief state of an accepted connection
+*/
+struct connection
+{
+	volatile gint ref;	///< references held by the listener thread and by messages handled by the GTK thread
+	int fd;	///< socket of the connection, -1 once closed
+	GIOChannel *channel;	///< channel watched for fd
+	GSource *source;	///< watch on channel
+	GIOCondition condition;	///< conditions the watch waits for
+	GSource *timeout_source;	///< read or idle timeout
+	gboolean keepalive;	///< TRUE if the client sends more than one message
+	gboolean subscribed;	///< TRUE if the connection only carries events
+	gboolean busy;	///< TRUE while the GTK thread handles a message of the connection
+	gboolean eof;	///< TRUE if the client closed its side of the connection
+	gboolean closing;	///< TRUE if the connection is closed once the replies were sent
+	GString *message;	///< received messages that were not handled yet
+	GString *reply;	///< replies that were not completely sent yet
+	gsize written;	///< bytes of reply that were sent
+	GTimer *timer;	///< measures the time since the current message started
+	GPid peer;	///< process ID of the client, 0 if unknown
+};
+
+/**
+* \brief socket gappman listens on
+*/
+struct listener
+{
+	int fd;	///< listening socket, -1 if not listening
+	GIOChannel *channel;	///< channel watched for fd
+	GSource *source;	///< watch on channel
+	gboolean local;	///< TRUE for the unix domain socket
+};
+
+/**
+* \brief message handled by the GTK thread
+*/
+struct job
+{
+	struct connection *conn;	///< connection the message was received on
+	int msg_id;	///< message id returned by parsemessage
+	gchar *msg;	///< received message without the newline
+	GString *reply;	///< reply formatted by the GTK thread
+};
+
+static struct listener unix_listener = { -1, NULL, NULL, TRUE };	///< listener on the unix domain socket
+static struct listener tcp_listener = { -1, NULL, NULL, FALSE };	///< listener on LISTENER_TCP_PORT
+static gchar *socket_path = NULL;	///< path unix_listener is bound to
+static GList *connections = NULL;	///< accepted connections
+static guint subscribers = 0;	///< amount of connections that subscribed to events
+static GMainContext *listener_context = NULL;	///< context of the listener thread
+static GThread *listener_thread = NULL;	///< thread that handles the connections
+static volatile gint listener_running = FALSE;	///< TRUE until the listener thread should stop
+static GMutex *cache_lock = NULL;	///< protects the cached replies
+
+/**
+* \brief formatted reply that is reused until the data it was formatted from changes
+*/
+struct cached_reply
+{
+	GString *text;	///< formatted reply, NULL if not formatted yet
+	gint values[2];	///< numbers text was formatted from
+	gconstpointer string;	///< string text was formatted from
+	guint serial;	///< serial of the process table text was formatted for, 0 if text does not depend on the table
+};
 
-static GIOChannel *mygio;
+static struct cached_reply process_list_reply;	///< ::listprocesses:: reply
+static struct cached_reply fontsize_reply;	///< ::showfontsize:: reply
+static struct cached_reply confpath_reply;	///< ::showconfpath:: reply
+static struct cached_reply geometry_reply;	///< ::showwindowgeometry:: reply
 
 /**
 * \brief parses a received message for keywords
 *
 * The protocol requires messages to be surrounded by double colons (i.e. ::)
+* and to end with a newline. The reply is sent after which the connection is
+* closed, unless the connection is kept alive.
 * The current supported messages are:
+* - `::keepalive::` to keep the connection open. From now on each reply, including this one, is preceded by its length in bytes and a newline. Messages without reply get a reply of length 0. Messages may be sent without waiting for the replies, which are sent in order.
+*   - returns: `keepalive::1`
 * - `::listprocesses::` to get a list of processes currently managed by gappman.
 *   - returns: `::<PROGRAMNAMA>::<PID>::[<PROGRAMNAME>::<PID>::]...`
 * - `::showfontsize::` to get the fontsize used by gappman
@@ -56,12 +182,22 @@ static GIOChannel *mygio;
 *   - returns: `confpath::<PATH>`
 * - `::showwindowgeometry::` to get the window geometry of the main window used by gappman
 *   - returns: `windowgeometry::<WIDTH>x<HEIGHT>`
+* - `::showlatency::` to get the launch-to-window latency histogram of each program started by gappman
+*   - returns: `::name::<PROGRAMNAME>::count::<N>::min::<MS>::mean::<MS>::max::<MS>::buckets::<B0>,...,<B15>[::name::...]...`
+* - `::stopprocesses::` to stop all programs started by gappman. The reply is sent when all programs exited.
+*   - returns: `killed::<N>` where N is the amount of programs that did not exit in time and were killed
+* - `::showoutput::<PROGRAMNAME>::[<BYTES>::]` to get the last BYTES (default: all) of output captured for a program
+*   - returns: `output::<OUTPUT>` where OUTPUT may span multiple lines and continues until the connection is closed. Nothing is returned if the output of the program is not captured.
+* - `::showresources::` to get the CPU (tenths of a percent), resident memory (bytes) and storage IO (bytes per interval) history of each program started by gappman, oldest sample first
+*   - returns: `::name::<PROGRAMNAME>::pid::<PID>::samples::<TIME>,<CPU>,<RSS>,<READ>,<WRITE>[;<TIME>,...][::name::...]...`
+* - `::subscribe::` to receive events until the connection is closed. Further messages are ignored. Each event is sent as a line or, on a kept alive connection, like a reply preceded by its length. See appmanager_events.h for the events.
+*   - returns: `subscribe::1` followed by a newline if the connection is not kept alive
 * \param msg received message
-* \return int corresponding to the received message.
+* \return int corresponding to the received message, 0 if the message is unknown
 */
 static int parsemessage(gchar * msg)
 {
-	int msg_id;
+	int msg_id = 0;
 	gchar **contentssplit = NULL;
 
 #if defined(DEBUG)
@@ -69,6 +205,11 @@ g_debug("received message %s", msg);
 #endif
 
 	contentssplit = g_strsplit(msg, "::", 0);
+	if (contentssplit[0] == NULL)
+	{
+		g_strfreev(contentssplit);
+		return msg_id;
+	}
 
 	if (g_strcmp0(contentssplit[1], "listprocesses") == 0)
 	{
@@ -90,53 +231,155 @@ g_debug("received message %s", msg);
 	{
 		msg_id = SEND_WINDOWGEOMETRY;
 	}
+	else if (g_strcmp0(contentssplit[1], "showlatency") == 0)
+	{
+		msg_id = SEND_LATENCY;
+	}
+	else if (g_strcmp0(contentssplit[1], "stopprocesses") == 0)
+	{
+		msg_id = STOP_PROCESSES;
+	}
+	else if (g_strcmp0(contentssplit[1], "showoutput") == 0)
+	{
+		msg_id = SEND_OUTPUT;
+	}
+	else if (g_strcmp0(contentssplit[1], "showresources") == 0)
+	{
+		msg_id = SEND_RESOURCES;
+	}
+	else if (g_strcmp0(contentssplit[1], "keepalive") == 0)
+	{
+		msg_id = KEEPALIVE;
+	}
+	else if (g_strcmp0(contentssplit[1], "subscribe") == 0)
+	{
+		msg_id = SUBSCRIBE;
+	}
 	g_strfreev(contentssplit);
 	return msg_id;
 }
 
-static void writemsg(GIOChannel * gio, gchar * msg)
+static void writemsg(GString * reply, const gchar * msg)
 {
-	GIOError gerror = G_IO_ERROR_NONE;
-	gsize bytes_written;
-
 #if defined(DEBUG)
 g_debug("sending message %s", msg);
 #endif
 
-	gerror = g_io_channel_write(gio, msg, strlen(msg), &bytes_written);
-	if (gerror != G_IO_ERROR_NONE)
+	g_string_append(reply, msg);
+}
+
+/**
+* \brief checks whether a cached reply was formatted from the given data. If
+* not, the cache is emptied and the caller must format the reply into it.
+* Must be called with cache_lock held.
+* \return TRUE if cache->text can be sent as is
+*/
+static gboolean cache_valid(struct cached_reply *cache, gint value1, gint value2,
+							gconstpointer string)
+{
+	if (cache->text != NULL && cache->values[0] == value1
+		&& cache->values[1] == value2 && cache->string == string)
+	{
+		return TRUE;
+	}
+
+	if (cache->text == NULL)
 	{
-		g_warning("Error sending message: %s : bytes written %d\n", msg,
-				  (int)bytes_written);
+		cache->text = g_string_new(NULL);
 	}
+	g_string_truncate(cache->text, 0);
+	cache->values[0] = value1;
+	cache->values[1] = value2;
+	cache->string = string;
+	return FALSE;
 }
 
-static void sendprocesslist(GIOChannel * gio)
+/**
+* \brief appends a cached reply, may be called by either thread
+* \param serial serial of the process table the reply must be formatted for
+* \return FALSE if the reply is not formatted yet or outdated
+*/
+static gboolean writecached(GString * reply, struct cached_reply *cache, guint serial)
 {
-	struct process_info *appw_list;
-	gchar *msg = NULL;
-	msg = (gchar *) malloc((256 + 16) * sizeof(gchar));
+	gboolean valid;
 
-	appw_list = appmanager_get_started_apps();
-	while (appw_list != NULL)
+	g_mutex_lock(cache_lock);
+	valid = cache->text != NULL && cache->serial == serial;
+	if (valid)
 	{
-		if (strlen((const char *)appw_list->menu_elt->name) < 256)
-		{
-			g_sprintf(msg, "::name::%s", appw_list->menu_elt->name);
-		}
-		else
-		{
-			g_sprintf(msg, "::name::");
-		}
-		writemsg(gio, msg);
+#if defined(DEBUG)
+g_debug("sending message %s", cache->text->str);
+#endif
+		g_string_append_len(reply, cache->text->str, cache->text->len);
+	}
+	g_mutex_unlock(cache_lock);
+
+	return valid;
+}
+
+static void cache_free(struct cached_reply *cache)
+{
+	if (cache->text != NULL)
+	{
+		g_string_free(cache->text, TRUE);
+		cache->text = NULL;
+	}
+}
 
-		g_sprintf(msg, "::pid::%d", appw_list->PID);
-		writemsg(gio, msg);
+static void sendprocess(struct process_info *proc, GString * reply)
+{
+	g_string_append_printf(reply, "::name::%s::pid::%d", proc->menu_elt->name, proc->PID);
+}
+
+/**
+* \brief appends each string of a snapshot preceded by :: and frees the snapshot
+* \param snapshot NULL terminated list, may be NULL
+*/
+static void sendsnapshot(gchar ** snapshot, GString * reply)
+{
+	gchar **item;
+
+	if (snapshot == NULL)
+	{
+		return;
+	}
+
+	for (item = snapshot; *item != NULL; item++)
+	{
+		writemsg(reply, "::");
+		writemsg(reply, *item);
+	}
+	g_strfreev(snapshot);
+}
+
+static void sendoutput(gchar * msg, GString * reply)
+{
+	gchar **contentssplit = NULL;
+	gchar *output;
+	gsize max = 0;
 
-		appw_list = appw_list->prev;
+	contentssplit = g_strsplit(msg, "::", 4);
+	if (contentssplit[0] == NULL || contentssplit[1] == NULL
+		|| contentssplit[2] == NULL)
+	{
+		g_strfreev(contentssplit);
+		return;
+	}
+
+	if (contentssplit[3] != NULL)
+	{
+		max = strtoul(contentssplit[3], NULL, 10);
 	}
 
-	free(msg);
+	output = appmanager_output_tail(contentssplit[2], max);
+	if (output != NULL)
+	{
+		writemsg(reply, "output::");
+		writemsg(reply, output);
+		g_free(output);
+	}
+
+	g_strfreev(contentssplit);
 }
 
 static void handle_update_resolution(gchar * msg)
@@ -152,7 +395,10 @@ static void handle_update_resolution(gchar * msg)
 	for (i = 0; i < 5; i++)
 	{
 		if (contentssplit[i] == NULL)
+		{
+			g_strfreev(contentssplit);
 			return;
+		}
 	}
 
 	if (g_strcmp0(contentssplit[2], "general") == 0)
@@ -170,191 +416,1169 @@ static void handle_update_resolution(gchar * msg)
 	g_strfreev(contentssplit);
 }
 
-static gboolean handleconnection(GIOChannel * gio, GIOCondition cond,
-								 gpointer data)
+/**
+* \brief handles a message that the listener thread can answer itself, which
+* are the messages that only read the cached replies, published snapshots or
+* captured output
+* \param msg_id message id returned by parsemessage
+* \param msg received message without the newline
+* \param reply will hold the reply, if any
+* \return FALSE if the message must be handled by the GTK thread
+*/
+static gboolean handle_in_listener(int msg_id, gchar * msg, GString * reply)
 {
-	gsize len;
-	gchar *msg;
-	GError *gerror = NULL;
-	GIOStatus status = G_IO_STATUS_NORMAL;
-	int newsock;
-	struct sockaddr_in cli_addr;
-	socklen_t cli_len;
-	GIOChannel *new_gio = NULL;
-	int msg_id;
-	struct metadata *appmanager_config;
-
-	cli_len = sizeof(cli_addr);
-	newsock = accept(*(int *)data, (struct sockaddr *)&cli_addr, &cli_len);
-	if (newsock < 0)
+	switch (msg_id)
 	{
-		perror("Error accepting message:");
-		// we return TRUE to keep watch active.
+	case SEND_PROCESS_LIST:
+		return writecached(reply, &process_list_reply, appmanager_processes_get_serial());
+	case SEND_FONTSIZE:
+		return writecached(reply, &fontsize_reply, 0);
+	case SEND_CONFPATH:
+		return writecached(reply, &confpath_reply, 0);
+	case SEND_WINDOWGEOMETRY:
+		return writecached(reply, &geometry_reply, 0);
+	case KEEPALIVE:
+		writemsg(reply, "keepalive::1");
+		return TRUE;
+	case SUBSCRIBE:
+		writemsg(reply, "subscribe::1");
+		return TRUE;
+	case SEND_LATENCY:
+		sendsnapshot(appmanager_latency_get_snapshot(), reply);
+		return TRUE;
+	case SEND_RESOURCES:
+		sendsnapshot(appmanager_sampler_get_snapshot(), reply);
+		return TRUE;
+	case SEND_OUTPUT:
+		sendoutput(msg, reply);
+		return TRUE;
+	case 0:
+		g_warning("Listener: unknown message %s", msg);
 		return TRUE;
 	}
 
-	if (cond & G_IO_IN)
+	return FALSE;
+}
+
+/**
+* \brief formats the cached replies that do not depend on the process table
+* again if the data they were formatted from changed. Must be called by the
+* GTK thread.
+*/
+static void update_cached_replies()
+{
+	struct metadata *appmanager_config = appmanager_get_metadata();
+
+	g_mutex_lock(cache_lock);
+	if (!cache_valid(&fontsize_reply, gm_layout_get_fontsize(), 0, NULL))
+	{
+		g_string_printf(fontsize_reply.text, "fontsize::%d", gm_layout_get_fontsize());
+	}
+	if (!cache_valid(&confpath_reply, 0, 0, appmanager_config->conffile))
+	{
+		g_string_printf(confpath_reply.text, "confpath::%s", appmanager_config->conffile);
+	}
+	if (!cache_valid(&geometry_reply, appmanager_config->window_width,
+					 appmanager_config->window_height, NULL))
 	{
-		// TODO: fork to handle connections concurrently
-		new_gio = g_io_channel_unix_new(newsock);
-		g_io_channel_set_buffer_size(new_gio, 0);
-		g_io_channel_set_encoding(new_gio, "UTF-8", NULL);
-		g_io_channel_set_line_term(new_gio, NULL, -1);
+		g_string_printf(geometry_reply.text, "windowgeometry::%dx%d",
+						appmanager_config->window_width,
+						appmanager_config->window_height);
+	}
+	g_mutex_unlock(cache_lock);
+}
 
-		status = g_io_channel_read_line(new_gio, &msg, &len, NULL, &gerror);
-		if (status == G_IO_STATUS_ERROR)
-		{
-			g_warning("Listener (handleconnection): %s\n", gerror->message);
-		}
-		else
+/**
+* \brief handles a message in the GTK thread and puts the answer in reply
+* \param msg_id message id returned by parsemessage
+* \param msg received message without the newline
+* \param reply will hold the reply, if any
+*/
+static void handle_in_main(int msg_id, gchar * msg, GString * reply)
+{
+	guint serial;
+
+	update_cached_replies();
+	switch (msg_id)
+	{
+	case SEND_PROCESS_LIST:
+		serial = appmanager_processes_get_serial();
+		g_mutex_lock(cache_lock);
+		if (!cache_valid(&process_list_reply, serial, 0, NULL))
 		{
-			msg_id = parsemessage(msg);
-			switch (msg_id)
-			{
-			case SEND_PROCESS_LIST:
-				sendprocesslist(new_gio);
-				break;;
-			case SEND_FONTSIZE:
-				g_free(msg);
-				msg = (gchar *) malloc(16 * sizeof(gchar));
-				g_sprintf(msg, "fontsize::%d", gm_get_fontsize());
-				writemsg(new_gio, msg);
-				break;;
-			case UPDATE_RES:
-				handle_update_resolution(msg);
-				break;;
-			case SEND_CONFPATH:
-				g_free(msg);
-				appmanager_config = appmanager_get_metadata();
-				msg =
-					(gchar *) malloc((10 + strlen(appmanager_config->conffile)) * sizeof(gchar));
-				g_sprintf(msg, "confpath::%s", appmanager_config->conffile);
-				writemsg(new_gio, msg);
-				break;;
-			case SEND_WINDOWGEOMETRY:
-				g_free(msg);
-				appmanager_config = appmanager_get_metadata();
-				msg = (gchar *) malloc(30 * sizeof(gchar));
-				if(msg != NULL)
-				{
-					g_snprintf(msg, 30, "windowgeometry::%dx%d", appmanager_config->window_width, appmanager_config->window_height);
-					writemsg(new_gio, msg);
-				}
-				break;;
-			}
-			g_free(msg);
+			appmanager_processes_foreach((GFunc) sendprocess, process_list_reply.text);
 		}
-		listener_socket_close(new_gio);
+		process_list_reply.serial = serial;
+		g_mutex_unlock(cache_lock);
+		writecached(reply, &process_list_reply, serial);
+		break;;
+	case SEND_FONTSIZE:
+		writecached(reply, &fontsize_reply, 0);
+		break;;
+	case UPDATE_RES:
+		handle_update_resolution(msg);
+		break;;
+	case SEND_CONFPATH:
+		writecached(reply, &confpath_reply, 0);
+		break;;
+	case SEND_WINDOWGEOMETRY:
+		writecached(reply, &geometry_reply, 0);
+		break;;
 	}
-	// Always return TRUE to keep watch active.
-	return TRUE;
 }
 
-static void restart_listener(GtkWidget *win, GdkEvent *event, gpointer data)
+/**
+* \brief attaches a source to the context of the listener thread
+* \return source, the caller holds a reference until remove_source is called
+*/
+static GSource *add_source(GSource * source, GSourceFunc func, gpointer data)
 {
-	if(gm_check_key(event))
+	g_source_set_callback(source, func, data, NULL);
+	g_source_attach(source, listener_context);
+	return source;
+}
+
+static void remove_source(GSource ** source)
+{
+	if (*source != NULL)
 	{
-		listener_socket_open(win);	
+		g_source_destroy(*source);
+		g_source_unref(*source);
+		*source = NULL;
 	}
 }
 
-gboolean listener_socket_open(GtkWidget * win)
+static void connection_unref(struct connection *conn)
 {
-	static int sock;
-	int s;
-	struct addrinfo hints;
-	struct addrinfo *result = NULL;
-	struct addrinfo *rp = NULL;
-	const gchar *server = "localhost";
-	const gchar *port = "2103";
-	gboolean listener_started = FALSE;
+	if (g_atomic_int_dec_and_test(&conn->ref))
+	{
+		g_string_free(conn->message, TRUE);
+		g_string_free(conn->reply, TRUE);
+		g_timer_destroy(conn->timer);
+		g_free(conn);
+	}
+}
 
-	memset(&hints, 0, sizeof(struct addrinfo));
-	hints.ai_family = AF_INET;
-	hints.ai_socktype = SOCK_STREAM;
-	hints.ai_flags = AI_PASSIVE;
-	hints.ai_protocol = 0;
-	hints.ai_canonname = NULL;
-	hints.ai_addr = NULL;
-	hints.ai_next = NULL;
+static void push_event(const gchar *event, gpointer data);
 
-	s = getaddrinfo(NULL, "2103", &hints, &result);
-	if (s != 0)
+/**
+* \brief (un)subscribes the listener to events, called in the GTK thread
+*/
+static gboolean subscribe_events(gpointer subscribe)
+{
+	// the listener may have been closed in the meantime
+	if (GPOINTER_TO_INT(subscribe) && listener_context != NULL)
 	{
-		g_warning("getaddrinfo: %s\n", gai_strerror(s));
+		appmanager_events_subscribe(push_event, NULL);
 	}
 	else
 	{
-		for (rp = result; rp != NULL; rp = rp->ai_next)
-		{
-			sock = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+		appmanager_events_unsubscribe(push_event, NULL);
+	}
+	return FALSE;
+}
 
-			if (sock == -1)
-				continue;
+static void close_connection(struct connection *conn)
+{
+	connections = g_list_remove(connections, conn);
 
-			if (bind(sock, rp->ai_addr, rp->ai_addrlen) == 0)
-			{
-				break;			/* Success */
-			}
-			close(sock);
+	if (conn->subscribed && --subscribers == 0)
+	{
+		g_idle_add(subscribe_events, GINT_TO_POINTER(FALSE));
+	}
+
+	remove_source(&conn->source);
+	remove_source(&conn->timeout_source);
+	g_io_channel_unref(conn->channel);
+	close(conn->fd);
+	// a message handled by the GTK thread may still refer to conn
+	conn->fd = -1;
+	connection_unref(conn);
+}
+
+static gboolean handle_io(GIOChannel * gio, GIOCondition cond, struct connection *conn);
+
+static gboolean connection_timeout(struct connection *conn)
+{
+	g_warning("Listener: closing connection, client did not %s in time",
+			  conn->written < conn->reply->len ? "read the reply" : "send its message");
+	remove_source(&conn->timeout_source);
+	close_connection(conn);
+	return FALSE;
+}
+
+/**
+* \brief (re)starts the timeout of a connection after it made progress. A
+* message must be completed within LISTENER_READ_TIMEOUT. A kept alive
+* connection without pending message or reply may wait
+* LISTENER_KEEPALIVE_TIMEOUT for its next message. Messages like
+* ::stopprocesses:: take a while, so a connection does not time out while
+* the GTK thread handles its message.
+*/
+static void arm_timeout(struct connection *conn)
+{
+	gdouble remaining;
+	guint delay = LISTENER_IDLE_TIMEOUT;
+
+	remove_source(&conn->timeout_source);
+
+	// subscribers wait for events as long as they like and the GTK
+	// thread may take a while to handle a message
+	if (conn->busy || (conn->subscribed && conn->written == conn->reply->len))
+	{
+		return;
+	}
+
+	// while replies are pending the client must keep reading them
+	if (conn->written == conn->reply->len)
+	{
+		if (conn->keepalive && conn->message->len == 0)
+		{
+			delay = LISTENER_KEEPALIVE_TIMEOUT;
 		}
-		if (rp != NULL)			/* An address succeeded */
+		else
 		{
-			// Listen for TCP connections
-			if (listen(sock, 5) >= 0)
+			remaining = LISTENER_READ_TIMEOUT - g_timer_elapsed(conn->timer, NULL) * 1000;
+			if (remaining < delay)
 			{
-				listener_started = TRUE;
+				delay = remaining > 0 ? (guint) remaining : 0;
 			}
 		}
-		freeaddrinfo(result);	/* No longer needed */
+	}
+
+	conn->timeout_source = add_source(g_timeout_source_new(delay),
+									  (GSourceFunc) connection_timeout, conn);
+}
+
+/**
+* \brief sends as much of the pending replies as the client accepts
+* \return FALSE if the connection failed
+*/
+static gboolean send_reply(struct connection *conn)
+{
+	ssize_t sent;
 
-		if (listener_started == TRUE)
+	while (conn->written < conn->reply->len)
+	{
+		sent = send(conn->fd, conn->reply->str + conn->written,
+					conn->reply->len - conn->written, MSG_NOSIGNAL);
+		if (sent >= 0)
+		{
+			conn->written += sent;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK)
 		{
-			mygio = g_io_channel_unix_new(sock);
+			return TRUE;
+		}
+		else if (errno != EINTR)
+		{
+			g_warning("Listener: error sending reply: %s", g_strerror(errno));
+			return FALSE;
+		}
+	}
 
-			if (!g_io_add_watch
-				(mygio, G_IO_IN, handleconnection, (gpointer) & sock))
-			{
-				g_warning("Cannot add watch on GIOChannel!\n");
-				listener_started = FALSE;
-			}
+	g_string_truncate(conn->reply, 0);
+	conn->written = 0;
+	return TRUE;
+}
+
+/**
+* \brief appends the reply of a handled message to the pending replies
+*/
+static void finish_message(struct connection *conn, int msg_id, GString * reply)
+{
+	switch (msg_id)
+	{
+	case KEEPALIVE:
+		conn->keepalive = TRUE;
+		break;;
+	case SUBSCRIBE:
+		conn->subscribed = TRUE;
+		if (subscribers++ == 0)
+		{
+			g_idle_add(subscribe_events, GINT_TO_POINTER(TRUE));
 		}
+		break;;
 	}
 
-	if (listener_started == TRUE)
+	if (conn->keepalive)
 	{
-		g_message("Listening on port %s on %s\n", port, server);
-		return TRUE;
+		// the length tells the client where the reply ends
+		g_string_append_printf(conn->reply, "%" G_GSIZE_FORMAT "\n", reply->len);
+	}
+	else if (conn->subscribed)
+	{
+		// like the events that follow, the reply is a line
+		g_string_append_c(reply, '\n');
 	}
 	else
 	{
-		close(sock);
-		gm_show_confirmation_dialog
-			("Could not start listener.\nShould I try again?",
-			 "Restart listener", restart_listener, win, "Cancel", NULL,
-			 NULL, win);
-		return FALSE;
+		conn->closing = TRUE;
 	}
+	g_string_append_len(conn->reply, reply->str, reply->len);
 }
 
+static void free_job(struct job *job)
+{
+	connection_unref(job->conn);
+	g_free(job->msg);
+	g_string_free(job->reply, TRUE);
+	g_free(job);
+}
 
-gboolean listener_socket_close(GIOChannel * close_gio)
+static void continue_connection(struct connection *conn);
+
+/**
+* \brief adds the reply of a message handled by the GTK thread to its
+* connection, called in the listener thread
+*/
+static gboolean finish_job(struct job *job)
 {
-	GIOStatus status;
-	GError *gerror = NULL;
-	if (close_gio == NULL)
+	struct connection *conn = job->conn;
+
+	if (conn->fd == -1)
 	{
-		close_gio = mygio;
+		// the connection was closed in the meantime
+		return FALSE;
 	}
-	if (close_gio == NULL)
+
+	conn->busy = FALSE;
+	finish_message(conn, job->msg_id, job->reply);
+	continue_connection(conn);
+	return FALSE;
+}
+
+/**
+* \brief hands the reply of a message handled by the GTK thread back to the
+* listener thread
+*/
+static void return_job(struct job *job)
+{
+	GSource *source;
+
+	// the listener may have been closed in the meantime
+	if (listener_context == NULL)
 	{
-		return FALSE;
+		free_job(job);
+		return;
+	}
+
+	source = g_idle_source_new();
+	g_source_set_callback(source, (GSourceFunc) finish_job, job, (GDestroyNotify) free_job);
+	g_source_attach(source, listener_context);
+	g_source_unref(source);
+}
+
+/**
+* \brief answers ::stopprocesses:: once all programs exited
+*/
+static void processes_stopped(guint killed, struct job *job)
+{
+	gchar *answer;
+
+	answer = g_strdup_printf("killed::%u", killed);
+	writemsg(job->reply, answer);
+	g_free(answer);
+	return_job(job);
+}
+
+/**
+* \brief handles a message in the GTK thread and hands the reply back to the
+* listener thread
+*/
+static gboolean run_job(struct job *job)
+{
+	// the listener may have been closed in the meantime
+	if (listener_context != NULL)
+	{
+		if (job->msg_id == STOP_PROCESSES)
+		{
+			// the connection stays busy until the programs exited, the
+			// client's program is not stopped
+			appmanager_stop_processes(job->conn->peer, (STOP_FUNC) processes_stopped, job);
+			return FALSE;
+		}
+		handle_in_main(job->msg_id, job->msg, job->reply);
+	}
+	return_job(job);
+	return FALSE;
+}
+
+/**
+* \brief handles a complete message. Messages the listener thread can not
+* answer are handed to the GTK thread, the next message of the connection is
+* handled after the reply came back.
+* \param msg received message without the newline, is modified
+*/
+static void process_message(struct connection *conn, gchar * msg)
+{
+	GString *reply;
+	struct job *job;
+	gsize length;
+	int msg_id;
+
+	length = strlen(msg);
+	if (length > 0 && msg[length - 1] == '\r')
+	{
+		msg[length - 1] = '\0';
+	}
+
+	msg_id = parsemessage(msg);
+	reply = g_string_new(NULL);
+	if (handle_in_listener(msg_id, msg, reply))
+	{
+		finish_message(conn, msg_id, reply);
+		g_string_free(reply, TRUE);
+		return;
+	}
+
+	g_atomic_int_inc(&conn->ref);
+	job = g_new(struct job, 1);
+	job->conn = conn;
+	job->msg_id = msg_id;
+	job->msg = g_strdup(msg);
+	job->reply = reply;
+	conn->busy = TRUE;
+	g_idle_add((GSourceFunc) run_job, job);
+}
+
+/**
+* \brief handles the complete messages that were received, one at a time
+* \return FALSE if the connection should be closed right away
+*/
+static gboolean process_input(struct connection *conn)
+{
+	gchar *newline;
+	gchar *msg;
+
+	while (!conn->closing && !conn->busy && !conn->subscribed
+		   && (newline = memchr(conn->message->str, '\n', conn->message->len)) != NULL)
+	{
+		msg = g_strndup(conn->message->str, newline - conn->message->str);
+		g_string_erase(conn->message, 0, newline - conn->message->str + 1);
+		if (conn->message->len > 0)
+		{
+			// the next message started already
+			g_timer_start(conn->timer);
+		}
+		process_message(conn, msg);
+		g_free(msg);
+	}
+
+	if (conn->subscribed)
+	{
+		// further messages are ignored
+		g_string_truncate(conn->message, 0);
+	}
+	else if (conn->message->len > LISTENER_MAX_MESSAGE_SIZE
+			 && memchr(conn->message->str, '\n', conn->message->len) == NULL)
+	{
+		g_warning("Listener: message exceeds %d bytes, closing connection",
+				  LISTENER_MAX_MESSAGE_SIZE);
+		return FALSE;
+	}
+
+	if (conn->eof && !conn->busy && !conn->closing)
+	{
+		// clients that close their side right after sending a single
+		// message do not need to end it with a newline
+		if (!conn->keepalive && !conn->subscribed && conn->message->len > 0)
+		{
+			msg = g_strndup(conn->message->str, conn->message->len);
+			g_string_truncate(conn->message, 0);
+			process_message(conn, msg);
+			g_free(msg);
+		}
+		if (!conn->busy)
+		{
+			conn->closing = TRUE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+* \brief reads what the client sent and handles each complete message
+* \return FALSE if the connection should be closed right away
+*/
+static gboolean read_messages(struct connection *conn)
+{
+	gchar data[LISTENER_READ_SIZE];
+	ssize_t length;
+
+	while (!conn->closing && !conn->busy && !conn->eof
+		   && conn->reply->len - conn->written < LISTENER_MAX_PENDING_REPLY)
+	{
+		length = read(conn->fd, data, sizeof(data));
+		if (length == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (length == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return TRUE;
+		}
+		if (length <= 0)
+		{
+			conn->eof = TRUE;
+			break;
+		}
+
+		if (conn->message->len == 0)
+		{
+			g_timer_start(conn->timer);
+		}
+		g_string_append_len(conn->message, data, length);
+		if (!process_input(conn))
+		{
+			return FALSE;
+		}
+	}
+
+	return process_input(conn);
+}
+
+/**
+* \brief makes the watch of a connection wait for the client to send
+* messages, unless too many replies are pending, the GTK thread handles a
+* message of the connection or the connection is closing, and for the client
+* to accept replies if there are any pending
+*/
+static void update_watch(struct connection *conn)
+{
+	GIOCondition condition = 0;
+
+	if (!conn->closing && !conn->busy && !conn->eof
+		&& conn->reply->len - conn->written < LISTENER_MAX_PENDING_REPLY)
+	{
+		condition |= G_IO_IN;
+	}
+	if (conn->written < conn->reply->len)
+	{
+		condition |= G_IO_OUT;
+	}
+
+	if (condition == 0)
+	{
+		// nothing to do until the GTK thread replied
+		remove_source(&conn->source);
+		return;
+	}
+
+	condition |= G_IO_HUP | G_IO_ERR;
+	if (conn->source != NULL && condition == conn->condition)
+	{
+		return;
+	}
+
+	remove_source(&conn->source);
+	conn->condition = condition;
+	conn->source = add_source(g_io_create_watch(conn->channel, condition),
+							  (GSourceFunc) handle_io, conn);
+}
+
+/**
+* \brief closes a connection that is done or updates its watch and timeout
+* \return FALSE if the connection was closed
+*/
+static gboolean update_connection(struct connection *conn)
+{
+	if (conn->closing && !conn->busy && conn->written == conn->reply->len)
+	{
+		close_connection(conn);
+		return FALSE;
+	}
+
+	update_watch(conn);
+	arm_timeout(conn);
+	return TRUE;
+}
+
+/**
+* \brief sends the replies and handles the messages that waited for the GTK
+* thread
+*/
+static void continue_connection(struct connection *conn)
+{
+	if (!send_reply(conn) || !process_input(conn) || !send_reply(conn))
+	{
+		close_connection(conn);
+		return;
+	}
+	update_connection(conn);
+}
+
+static gboolean handle_io(GIOChannel * gio, GIOCondition cond, struct connection *conn)
+{
+	GSource *source = conn->source;
+
+	if (!send_reply(conn) || !read_messages(conn) || !send_reply(conn))
+	{
+		close_connection(conn);
+		return FALSE;
+	}
+
+	if (!update_connection(conn))
+	{
+		return FALSE;
+	}
+
+	// update_watch replaced this watch if the conditions changed
+	return conn->source == source;
+}
+
+/**
+* \brief queues an event on each subscribed connection and sends it as far
+* as the subscriber accepts it, called in the listener thread
+*/
+static gboolean deliver_event(gchar * event)
+{
+	struct connection *conn;
+	GList *iter;
+	GList *next;
+	gchar prefix[32];
+	gsize length;
+
+	length = strlen(event);
+	// kept alive connections keep getting their messages preceded by
+	// their length, the others get a line
+	g_snprintf(prefix, sizeof(prefix), "%" G_GSIZE_FORMAT "\n", length);
+	for (iter = connections; iter != NULL; iter = next)
+	{
+		// the connection may be closed below
+		next = iter->next;
+		conn = iter->data;
+		if (!conn->subscribed || conn->closing)
+		{
+			continue;
+		}
+
+		if (conn->reply->len - conn->written + length + sizeof(prefix) > LISTENER_MAX_EVENT_QUEUE)
+		{
+			g_warning("Listener: subscriber does not keep up with events, closing connection");
+			close_connection(conn);
+			continue;
+		}
+
+		if (conn->keepalive)
+		{
+			g_string_append(conn->reply, prefix);
+			g_string_append_len(conn->reply, event, length);
+		}
+		else
+		{
+			g_string_append_len(conn->reply, event, length);
+			g_string_append_c(conn->reply, '\n');
+		}
+		if (!send_reply(conn))
+		{
+			close_connection(conn);
+			continue;
+		}
+		update_connection(conn);
+	}
+
+	return FALSE;
+}
+
+/**
+* \brief hands an event to the listener thread, called in the GTK thread
+*/
+static void push_event(const gchar *event, gpointer data)
+{
+	GSource *source;
+
+	if (listener_context == NULL)
+	{
+		return;
+	}
+
+	source = g_idle_source_new();
+	g_source_set_callback(source, (GSourceFunc) deliver_event, g_strdup(event), g_free);
+	g_source_attach(source, listener_context);
+	g_source_unref(source);
+}
+
+/**
+* \brief checks whether the process on the other end of a connection to the
+* unix domain socket runs as the same user as gappman or as root
+* \param sock accepted connection
+* \param peer set to the process ID of the client, 0 if unknown
+* \return TRUE if the connection may be handled
+*/
+static gboolean peer_allowed(int sock, GPid * peer)
+{
+	*peer = 0;
+#ifdef SO_PEERCRED
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+	{
+		g_warning("Listener: could not get credentials of client: %s", g_strerror(errno));
+		return FALSE;
+	}
+	if (cred.uid != getuid() && cred.uid != 0)
+	{
+		g_warning("Listener: refusing connection of process %d owned by uid %u",
+				  (int) cred.pid, (unsigned int) cred.uid);
+		return FALSE;
+	}
+	*peer = cred.pid;
+#endif
+	// without SO_PEERCRED only the permissions of the socket directory apply
+	return TRUE;
+}
+
+static gboolean handleconnection(GIOChannel * gio, GIOCondition cond,
+								 gpointer data)
+{
+	struct listener *listener = data;
+	struct connection *conn;
+	struct sockaddr_storage cli_addr;
+	socklen_t cli_len;
+	int newsock;
+	GPid peer = 0;
+
+	// accept all pending connections at once
+	while (TRUE)
+	{
+		cli_len = sizeof(cli_addr);
+		newsock = accept(listener->fd, (struct sockaddr *)&cli_addr, &cli_len);
+		if (newsock < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				g_warning("Listener: error accepting connection: %s", g_strerror(errno));
+			}
+			// we return TRUE to keep watch active.
+			return TRUE;
+		}
+
+		if (listener->local && !peer_allowed(newsock, &peer))
+		{
+			close(newsock);
+			continue;
+		}
+
+		if (g_list_length(connections) >= LISTENER_MAX_CONNECTIONS)
+		{
+			g_warning("Listener: more than %d connections, refusing connection",
+					  LISTENER_MAX_CONNECTIONS);
+			close(newsock);
+			continue;
+		}
+
+		fcntl(newsock, F_SETFD, FD_CLOEXEC);
+		fcntl(newsock, F_SETFL, O_NONBLOCK);
+
+		conn = g_new0(struct connection, 1);
+		conn->ref = 1;
+		conn->fd = newsock;
+		conn->message = g_string_new(NULL);
+		conn->reply = g_string_new(NULL);
+		conn->timer = g_timer_new();
+		conn->peer = peer;
+		conn->channel = g_io_channel_unix_new(newsock);
+		connections = g_list_prepend(connections, conn);
+		update_connection(conn);
+	}
+}
+
+/**
+* \brief creates the directory of the unix domain socket if needed and makes
+* sure only gappman's user can access it
+* \param dir directory
+* \return TRUE if the directory can be used
+*/
+static gboolean check_socket_dir(const gchar * dir)
+{
+	struct stat st;
+
+	if (mkdir(dir, 0700) != 0 && errno != EEXIST)
+	{
+		g_warning("Listener: could not create %s: %s", dir, g_strerror(errno));
+		return FALSE;
+	}
+
+	// lstat, so a symlink planted in a shared tmp directory is not followed
+	if (lstat(dir, &st) != 0)
+	{
+		g_warning("Listener: could not stat %s: %s", dir, g_strerror(errno));
+		return FALSE;
+	}
+	if (!S_ISDIR(st.st_mode) || st.st_uid != getuid()
+		|| (st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+	{
+		g_warning("Listener: %s must be a directory only accessible by uid %u",
+				  dir, (unsigned int) getuid());
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+* \brief binds a socket to socket_path. A socket left behind by a gappman
+* that did not exit cleanly is removed, the socket of a running gappman is
+* left alone.
+* \return TRUE if binding succeeded
+*/
+static gboolean bind_unix_socket(int sock, struct sockaddr_un *addr)
+{
+	int probe;
+	gboolean in_use;
+
+	if (bind(sock, (struct sockaddr *)addr, sizeof(*addr)) == 0)
+	{
+		return TRUE;
+	}
+	if (errno != EADDRINUSE)
+	{
+		g_warning("Listener: could not bind to %s: %s", addr->sun_path, g_strerror(errno));
+		return FALSE;
+	}
+
+	probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (probe < 0)
+	{
+		return FALSE;
+	}
+	in_use = connect(probe, (struct sockaddr *)addr, sizeof(*addr)) == 0;
+	close(probe);
+	if (in_use)
+	{
+		g_warning("Listener: %s is in use, is gappman already running?", addr->sun_path);
+		return FALSE;
+	}
+
+	unlink(addr->sun_path);
+	if (bind(sock, (struct sockaddr *)addr, sizeof(*addr)) != 0)
+	{
+		g_warning("Listener: could not bind to %s: %s", addr->sun_path, g_strerror(errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+* \brief opens the unix domain socket
+* \return listening socket or -1 on failure
+*/
+static int open_unix_listener()
+{
+	struct sockaddr_un addr;
+	gchar *dir;
+	gboolean dir_ok;
+	int sock;
+
+	g_free(socket_path);
+	socket_path = gm_get_listener_socket_path();
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(socket_path) >= sizeof(addr.sun_path))
+	{
+		g_warning("Listener: socket path %s is too long", socket_path);
+		return -1;
+	}
+	strcpy(addr.sun_path, socket_path);
+
+	dir = g_path_get_dirname(socket_path);
+	dir_ok = check_socket_dir(dir);
+	g_free(dir);
+	if (!dir_ok)
+	{
+		return -1;
+	}
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+	{
+		return -1;
+	}
+	if (!bind_unix_socket(sock, &addr))
+	{
+		close(sock);
+		return -1;
+	}
+	chmod(socket_path, S_IRUSR | S_IWUSR);
+
+	if (listen(sock, 5) < 0)
+	{
+		close(sock);
+		unlink(socket_path);
+		return -1;
+	}
+
+	g_message("Listening on %s\n", socket_path);
+	return sock;
+}
+
+/**
+* \brief opens TCP port LISTENER_TCP_PORT on the loopback address, so only
+* local processes can connect
+* \return listening socket or -1 on failure
+*/
+static int open_tcp_listener()
+{
+	int sock = -1;
+	int s;
+	struct addrinfo hints;
+	struct addrinfo *result = NULL;
+	struct addrinfo *rp = NULL;
+	const gchar *server = "localhost";
+	gboolean listener_started = FALSE;
+
+	memset(&hints, 0, sizeof(struct addrinfo));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	// without AI_PASSIVE a NULL node resolves to the loopback address
+	hints.ai_flags = 0;
+	hints.ai_protocol = 0;
+	hints.ai_canonname = NULL;
+	hints.ai_addr = NULL;
+	hints.ai_next = NULL;
+
+	s = getaddrinfo(NULL, LISTENER_TCP_PORT, &hints, &result);
+	if (s != 0)
+	{
+		g_warning("getaddrinfo: %s\n", gai_strerror(s));
+		return -1;
+	}
+
+	for (rp = result; rp != NULL; rp = rp->ai_next)
+	{
+		sock = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+
+		if (sock == -1)
+			continue;
+
+		if (bind(sock, rp->ai_addr, rp->ai_addrlen) == 0)
+		{
+			break;			/* Success */
+		}
+		close(sock);
+	}
+	if (rp != NULL)			/* An address succeeded */
+	{
+		// Listen for TCP connections
+		if (listen(sock, 5) >= 0)
+		{
+			listener_started = TRUE;
+		}
+		else
+		{
+			close(sock);
+		}
+	}
+	freeaddrinfo(result);	/* No longer needed */
+
+	if (listener_started == FALSE)
+	{
+		return -1;
+	}
+
+	g_message("Listening on port %s on %s\n", LISTENER_TCP_PORT, server);
+	return sock;
+}
+
+/**
+* \brief watches a listening socket for new connections
+* \return TRUE if the watch was added
+*/
+static gboolean start_listener(struct listener *listener, int sock)
+{
+	listener->fd = sock;
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+	listener->channel = g_io_channel_unix_new(sock);
+
+	listener->source = add_source(g_io_create_watch(listener->channel, G_IO_IN),
+								  (GSourceFunc) handleconnection, listener);
+
+	return TRUE;
+}
+
+/**
+* \brief stops watching a listening socket and closes it
+* \return TRUE if closing the socket succeeded
+*/
+static gboolean stop_listener(struct listener *listener)
+{
+	GIOChannel *channel = listener->channel;
+	gboolean closed;
+
+	if (channel == NULL)
+	{
+		return FALSE;
+	}
+
+	remove_source(&listener->source);
+	listener->channel = NULL;
+	listener->fd = -1;
+
+	if (listener->local)
+	{
+		unlink(socket_path);
+	}
+
+	closed = listener_socket_close(channel);
+	g_io_channel_unref(channel);
+
+	return closed;
+}
+
+static gpointer run_listener(gpointer data)
+{
+	while (g_atomic_int_get(&listener_running))
+	{
+		g_main_context_iteration(listener_context, TRUE);
+	}
+	return NULL;
+}
+
+/**
+* \brief starts the listener thread unless it runs already
+* \return TRUE if the thread runs
+*/
+static gboolean start_thread()
+{
+	if (listener_thread != NULL)
+	{
+		return TRUE;
+	}
+
+	if (cache_lock == NULL)
+	{
+		cache_lock = g_mutex_new();
+	}
+	listener_context = g_main_context_new();
+	update_cached_replies();
+
+	g_atomic_int_set(&listener_running, TRUE);
+	listener_thread = g_thread_create(run_listener, NULL, TRUE, NULL);
+	if (listener_thread == NULL)
+	{
+		g_warning("Listener: failed to create thread");
+		g_atomic_int_set(&listener_running, FALSE);
+		g_main_context_unref(listener_context);
+		listener_context = NULL;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+* \brief stops the listener thread and waits for it to exit
+*/
+static void stop_thread()
+{
+	if (listener_thread == NULL)
+	{
+		return;
+	}
+
+	g_atomic_int_set(&listener_running, FALSE);
+	g_main_context_wakeup(listener_context);
+	g_thread_join(listener_thread);
+	listener_thread = NULL;
+}
+
+static void restart_listener(GtkWidget *win, GdkEvent *event, gpointer data)
+{
+	if(gm_check_key(event))
+	{
+		listener_socket_open(win);
+	}
+}
+
+gboolean listener_socket_open(GtkWidget * win)
+{
+	int sock;
+	gboolean listener_started = TRUE;
+
+	if (!start_thread())
+	{
+		listener_started = FALSE;
+	}
+	// a restart only reopens the listeners that failed
+	else if (unix_listener.fd == -1)
+	{
+		sock = open_unix_listener();
+		if (sock == -1 || !start_listener(&unix_listener, sock))
+		{
+			listener_started = FALSE;
+		}
+	}
+
+	if (listener_thread != NULL && gm_parseconf_get_tcp_listener() && tcp_listener.fd == -1)
+	{
+		sock = open_tcp_listener();
+		if (sock == -1 || !start_listener(&tcp_listener, sock))
+		{
+			listener_started = FALSE;
+		}
+	}
+
+	if (listener_started == TRUE)
+	{
+		return TRUE;
+	}
+	else
+	{
+		gm_show_confirmation_dialog
+			("Could not start listener.\nShould I try again?",
+			 "Restart listener", restart_listener, win, "Cancel", NULL,
+			 NULL, win);
+		return FALSE;
+	}
+}
+
+
+gboolean listener_socket_close(GIOChannel * close_gio)
+{
+	GIOStatus status;
+	GError *gerror = NULL;
+	gboolean closed;
+
+	if (close_gio == NULL)
+	{
+		// with the listener thread stopped its state can be freed here
+		stop_thread();
+		while (connections != NULL)
+		{
+			close_connection(connections->data);
+		}
+		closed = stop_listener(&unix_listener);
+		closed = stop_listener(&tcp_listener) || closed;
+		appmanager_events_unsubscribe(push_event, NULL);
+		if (listener_context != NULL)
+		{
+			// frees the replies and events the listener thread did not handle
+			g_main_context_unref(listener_context);
+			listener_context = NULL;
+		}
+		g_free(socket_path);
+		socket_path = NULL;
+		cache_free(&process_list_reply);
+		cache_free(&fontsize_reply);
+		cache_free(&confpath_reply);
+		cache_free(&geometry_reply);
+		return closed;
 	}
 
 	status = g_io_channel_shutdown(close_gio, TRUE, &gerror);
 	if (status == G_IO_STATUS_ERROR)
 	{
 		g_warning("Listener (listener_socket_close): %s\n", gerror->message);
+		g_error_free(gerror);
 		return FALSE;
 	}
 
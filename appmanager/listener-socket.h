@@ -15,14 +15,16 @@
 #include <gtk/gtk.h>
 
 /**
-* \brief Starts the gappman listener. Should be started only once.
+* \brief Starts the gappman listener on its unix domain socket and, if enabled
+* in the configuration file, on its TCP port. The connections are handled by
+* a separate thread. Should be started only once.
 * \return TRUE if setting up the channel succeeded. False otherwise.
 */
 gboolean listener_socket_open(GtkWidget * win);
 
 /**
 * \brief Closes a listener.
-* \param close_gio pointer to an open GIOChannel, if NULL it will close gappman's listener
+* \param close_gio pointer to an open GIOChannel, if NULL it will stop the listener thread and close gappman's listener
 * \return TRUE if closing the channel succeeded. False otherwise.
 */
 gboolean listener_socket_close(GIOChannel * close_gio);
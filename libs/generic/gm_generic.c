@@ -10,6 +10,9 @@
  */
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
 #include "gm_generic.h"
 
 #define MENU_ELTS_ARRAY_INCREMENT 5 ///< amount with which the menu_elts array should be incremented when too small to hold all elements
@@ -243,7 +246,22 @@ gm_menu_element *gm_menu_element_create()
   elt->module = NULL;
   elt->module_conffile = NULL;
   elt->autostart = 0;
+  elt->autostart_after = NULL;
+  elt->autostart_delay = 0;
+  elt->autostart_ready = NULL;
+  elt->restart = NULL;
+  elt->restart_backoff = -1;
+  elt->restart_max_backoff = -1;
+  elt->restart_limit = -1;
+  elt->restart_interval = -1;
   elt->printlabel = 0;
+  elt->zygote = 0;
+  elt->single_instance = 0;
+  elt->profile = NULL;
+  elt->capture = 0;
+  elt->capture_size = -1;
+  elt->capture_file = NULL;
+  elt->capture_rotate_size = -1;
   elt->app_height = -1;
   elt->app_width = -1;
   elt->pid = -1;
@@ -252,6 +270,113 @@ gm_menu_element *gm_menu_element_create()
   return elt;
 }
 
+gm_launch_profile *gm_launch_profile_create()
+{
+	gm_launch_profile *profile;
+
+	profile = g_new(gm_launch_profile, 1);
+	profile->cpus = 0;
+	profile->nice = GM_PROFILE_UNSET;
+	profile->ionice_class = GM_PROFILE_UNSET;
+	profile->ionice_level = 4;
+	profile->max_memory = -1;
+	profile->max_files = -1;
+	profile->oom_score_adj = GM_PROFILE_UNSET;
+
+	return profile;
+}
+
+guint64 gm_launch_profile_parse_cpus(const gchar *cpus)
+{
+	gchar **ranges;
+	guint64 mask = 0;
+	gint first;
+	gint last;
+	gint cpu;
+	gint i;
+
+	ranges = g_strsplit(cpus, ",", 0);
+	for (i = 0; ranges[i] != NULL; i++)
+	{
+		switch (sscanf(ranges[i], "%d-%d", &first, &last))
+		{
+		case 1:
+			last = first;
+			break;
+		case 2:
+			break;
+		default:
+			g_strfreev(ranges);
+			return 0;
+		}
+
+		if (first < 0 || last < first || last > 63)
+		{
+			g_strfreev(ranges);
+			return 0;
+		}
+
+		for (cpu = first; cpu <= last; cpu++)
+		{
+			mask |= G_GUINT64_CONSTANT(1) << cpu;
+		}
+	}
+	g_strfreev(ranges);
+
+	return mask;
+}
+
+gm_menu_element *gm_menu_element_copy(gm_menu_element *elt)
+{
+	gm_menu_element *copy;
+	int i;
+
+	if (elt == NULL)
+		return NULL;
+
+	copy = gm_menu_element_create();
+	if (copy == NULL)
+		return NULL;
+
+	copy->name = g_strdup(elt->name);
+	copy->exec = g_strdup(elt->exec);
+	copy->logo = g_strdup(elt->logo);
+	copy->module = g_strdup(elt->module);
+	copy->module_conffile = g_strdup(elt->module_conffile);
+	copy->autostart = elt->autostart;
+	copy->autostart_after = g_strdup(elt->autostart_after);
+	copy->autostart_delay = elt->autostart_delay;
+	copy->autostart_ready = g_strdup(elt->autostart_ready);
+	copy->restart = g_strdup(elt->restart);
+	copy->restart_backoff = elt->restart_backoff;
+	copy->restart_max_backoff = elt->restart_max_backoff;
+	copy->restart_limit = elt->restart_limit;
+	copy->restart_interval = elt->restart_interval;
+	copy->printlabel = elt->printlabel;
+	copy->zygote = elt->zygote;
+	copy->single_instance = elt->single_instance;
+	if (elt->profile != NULL)
+	{
+		copy->profile = g_memdup(elt->profile, sizeof(gm_launch_profile));
+	}
+	copy->capture = elt->capture;
+	copy->capture_size = elt->capture_size;
+	copy->capture_file = g_strdup(elt->capture_file);
+	copy->capture_rotate_size = elt->capture_rotate_size;
+	copy->app_width = elt->app_width;
+	copy->app_height = elt->app_height;
+	for (i = 0; i < gm_menu_element_get_amount_of_arguments(elt); i++)
+	{
+		if (!gm_menu_element_add_argument(g_strdup(elt->args[i]), copy))
+		{
+			gm_menu_element_free(copy);
+			return NULL;
+		}
+	}
+
+	return copy;
+}
+
 void gm_menu_element_free(gm_menu_element *elt)
 {
 	int i;
@@ -268,6 +393,11 @@ void gm_menu_element_free(gm_menu_element *elt)
   free(elt->module);
   free(elt->module_conffile);
   free(elt->logo);
+  free(elt->autostart_after);
+  free(elt->autostart_ready);
+  free(elt->restart);
+  g_free(elt->profile);
+  free(elt->capture_file);
   for (i = 0; i < (gm_menu_element_get_amount_of_arguments(elt)); i++)
   {
     free(elt->args[i]);
@@ -347,3 +477,30 @@ gm_menu_page *gm_menu_page_next(gm_menu_page *page)
 	return page->next;
 }
  
+
+gchar *gm_get_listener_socket_path()
+{
+	const gchar *runtime_dir;
+	gchar *dir;
+	gchar *path;
+
+	runtime_dir = g_getenv("XDG_RUNTIME_DIR");
+	if (runtime_dir != NULL && runtime_dir[0] != '\0')
+	{
+		return g_build_filename(runtime_dir, GM_LISTENER_SOCKET_NAME, NULL);
+	}
+
+	dir = g_strdup_printf("gappman-%u", (unsigned int) getuid());
+	path = g_build_filename(g_get_tmp_dir(), dir, GM_LISTENER_SOCKET_NAME, NULL);
+	g_free(dir);
+
+	return path;
+}
+
+gint64 gm_get_monotonic_time()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (gint64) ts.tv_sec * G_GINT64_CONSTANT(1000000) + ts.tv_nsec / 1000;
+}
@@ -37,6 +37,11 @@ typedef struct _menu_element gm_menu_element;
 */
 typedef struct _menu_page gm_menu_page;
 
+/**
+* \brief scheduling and resource settings applied to a started program
+*/
+typedef struct _launch_profile gm_launch_profile;
+
 /**
 * \brief Function to initialize the module
 */
@@ -110,6 +115,27 @@ struct length
 };
 
 
+#define GM_LISTENER_SOCKET_NAME "gappman.sock" ///< name of the unix domain socket gappman listens on
+#define GM_PROFILE_UNSET G_MININT ///< value of a launch profile setting that should be inherited from gappman
+
+/**
+* \brief settings applied to a program after it is forked and before it is executed
+*/
+struct _launch_profile
+{
+	guint64 cpus;	///< mask of the CPUs the program may run on, CPU 0
+					// is bit 0. 0 to inherit.
+	gint nice;		///< nice value or GM_PROFILE_UNSET
+	gint ionice_class;	///< IO scheduling class: 1 (realtime), 2
+						// (best-effort), 3 (idle) or GM_PROFILE_UNSET
+	gint ionice_level;	///< priority within the IO scheduling class, 0
+						// (highest) to 7
+	gint64 max_memory;	///< RLIMIT_AS in bytes, -1 to inherit
+	gint64 max_files;	///< RLIMIT_NOFILE, -1 to inherit
+	gint oom_score_adj;	///< written to /proc/self/oom_score_adj, -1000 to
+						// 1000 or GM_PROFILE_UNSET
+};
+
 /**
 * \brief structure to hold the attributes to create the button to start a program
 */
@@ -131,7 +157,41 @@ struct _menu_element
 									// configuration file
 	gint autostart;				///< a value of 1 will start program at
 								// startup, 0 will not.
+	gchar *autostart_after;		///< name of the program that must be ready
+								// before this program is autostarted
+	gint autostart_delay;		///< milliseconds to wait before this
+								// program is autostarted
+	gchar *autostart_ready;		///< when this autostarted program is
+								// ready: "started", "exit" or "file:<path>"
+	gchar *restart;				///< when the program should be restarted
+								// after it exited: "never", "always" or
+								// "on-failure"
+	gint restart_backoff;		///< milliseconds to wait before the first
+								// restart, -1 for the default
+	gint restart_max_backoff;	///< maximum milliseconds to wait before a
+								// restart, -1 for the default
+	gint restart_limit;			///< maximum amount of restarts within
+								// restart_interval, -1 for the default
+	gint restart_interval;		///< seconds a program must run before its
+								// restarts are no longer counted, -1 for
+								// the default
 	gint printlabel;				///< If set to 1 the name should be printed
+	gint zygote;				///< a value of 1 will start the program
+								// through the zygote, 0 will not.
+	gint single_instance;		///< a value of 1 will activate the window
+								// of the running program instead of
+								// starting another instance, 0 will not.
+	gm_launch_profile *profile;	///< settings applied to the program when
+								// it is started, NULL to inherit gappman's
+	gint capture;				///< a value of 1 will keep the output of
+								// the program in memory, 0 will let it
+								// inherit gappman's stdout and stderr.
+	gint capture_size;			///< kilobytes of output kept in memory,
+								// -1 for the default
+	gchar *capture_file;		///< file the captured output is also
+								// written to, NULL for none
+	gint capture_rotate_size;	///< kilobytes after which capture_file is
+								// rotated, -1 for the default
 	gchar **args;				///< arguments that need to be passed to the executable
 	gint amount_of_args;			///< total amount of elements in the args array
 	gint pid;					///< process ID of the process that was started by this menu_element
@@ -326,6 +386,27 @@ void gm_menu_set_max_elts_in_single_box(gint amount, gm_menu *menu);
 */
 gm_menu_element *gm_menu_element_create(); 
 
+/**
+* \brief creates a launch profile in which all settings are inherited
+* \return new launch profile, free with g_free
+*/
+gm_launch_profile *gm_launch_profile_create();
+
+/**
+* \brief parses a list of CPUs like "0,2-3" into a CPU mask
+* \param cpus list of CPU numbers and ranges separated by commas
+* \return mask with bit n set for CPU n, or 0 if cpus could not be parsed
+*/
+guint64 gm_launch_profile_parse_cpus(const gchar *cpus);
+
+/**
+* \brief creates a deep copy of the configuration values of a gm_menu_element.
+* Runtime values like the widget and process ID are not copied.
+* \param elt gm_menu_element that should be copied
+* \return gm_menu_element reference which should be freed with gm_menu_element_free
+*/
+gm_menu_element *gm_menu_element_copy(gm_menu_element *elt);
+
 /**
 * \brief add an argument to the argument list for a gm_menu_element
 * \param *elt gm_menu_element which should have its argument list expanded
@@ -392,5 +473,20 @@ void gm_menu_page_free(gm_menu_page *page);
 */
 gm_menu_page *gm_menu_page_next(gm_menu_page* page);
 
+/**
+* \brief returns the path of the unix domain socket gappman listens on. This
+* is GM_LISTENER_SOCKET_NAME in $XDG_RUNTIME_DIR or, if that is not set, in
+* the directory gappman-UID in the temporary directory.
+* \return path, must be freed with g_free
+*/
+gchar *gm_get_listener_socket_path();
+
+/**
+* \brief returns the time of a clock that is not affected by changes of the
+* system time, e.g. by NTP
+* \return microseconds since an unspecified point in the past
+*/
+gint64 gm_get_monotonic_time();
+
 #endif
 
@@ -38,6 +38,7 @@
 #include <gdk/gdkx.h>
 #include <X11/Xlib.h>
 #include <X11/XKBlib.h>
+#include <X11/Xatom.h>
 
 #include "gm_keybinder.h"
 
@@ -80,6 +81,22 @@ static GSList *bindings = NULL;
 static guint32 last_event_time = 0;
 static gboolean processing_event = FALSE;
 
+/* Window watcher: reports each top level client once, together with
+ * the process ID found in its _NET_WM_PID property.
+ */
+static WindowMappedHandler window_handler = NULL;
+static void *window_user_data = NULL;
+static GHashTable *reported_windows = NULL;
+static Atom net_client_list = None;
+static Atom net_client_list_stacking = None;
+static Atom net_wm_pid = None;
+static Atom net_active_window = None;
+
+/* Active window watcher: reports each change of _NET_ACTIVE_WINDOW */
+static WindowActivatedHandler active_handler = NULL;
+static void *active_user_data = NULL;
+static Window last_active_window = None;
+
 /* Return the modifier mask that needs to be pressed to produce key in the
  * given group (keyboard layout) and level ("shift level").
  */
@@ -344,6 +361,144 @@ do_ungrab_key (struct Binding *binding)
 	return TRUE;
 }
 
+static void
+init_atoms (Display *display)
+{
+	if (net_wm_pid != None)
+		return;
+
+	net_client_list = XInternAtom (display, "_NET_CLIENT_LIST", False);
+	net_client_list_stacking = XInternAtom (display, "_NET_CLIENT_LIST_STACKING", False);
+	net_wm_pid = XInternAtom (display, "_NET_WM_PID", False);
+	net_active_window = XInternAtom (display, "_NET_ACTIVE_WINDOW", False);
+}
+
+/* Returns the _NET_WM_PID of xwindow or 0 if the window has none.
+ * The window may already be gone, so errors are trapped.
+ */
+static gint
+get_window_pid (Display *display, Window xwindow)
+{
+	Atom type;
+	int format;
+	unsigned long n_items, bytes_after;
+	unsigned char *data = NULL;
+	gint pid = 0;
+
+	gdk_error_trap_push ();
+	if (XGetWindowProperty (display, xwindow, net_wm_pid,
+	                        0, 1, False, XA_CARDINAL,
+	                        &type, &format, &n_items, &bytes_after,
+	                        &data) == Success &&
+	    type == XA_CARDINAL && format == 32 && n_items == 1) {
+		pid = (gint) *((unsigned long *) data);
+	}
+	if (data != NULL)
+		XFree (data);
+	gdk_error_trap_pop ();
+
+	return pid;
+}
+
+static void
+report_window (Display *display, Window xwindow)
+{
+	gint pid;
+
+	if (g_hash_table_lookup (reported_windows, GUINT_TO_POINTER (xwindow)))
+		return;
+
+	pid = get_window_pid (display, xwindow);
+	if (pid <= 0)
+		return;
+
+	g_hash_table_insert (reported_windows, GUINT_TO_POINTER (xwindow),
+	                     GINT_TO_POINTER (pid));
+
+	TRACE (g_print ("Window 0x%lx mapped for pid %d\n", xwindow, pid));
+
+	if (window_handler != NULL)
+		(window_handler) ((gulong) xwindow, pid, window_user_data);
+}
+
+/* Reports the clients in _NET_CLIENT_LIST that were not reported yet
+ * and forgets the clients that are no longer managed.
+ * Used with reparenting window managers, where the MapNotify seen on
+ * the root window is the one of the frame and not of the client.
+ */
+static void
+report_client_list (Display *display, Window root)
+{
+	Atom type;
+	int format;
+	unsigned long n_items, bytes_after, i;
+	unsigned char *data = NULL;
+	Window *clients;
+	GHashTable *previous;
+	gpointer pid;
+
+	gdk_error_trap_push ();
+	if (XGetWindowProperty (display, root, net_client_list,
+	                        0, G_MAXLONG, False, XA_WINDOW,
+	                        &type, &format, &n_items, &bytes_after,
+	                        &data) == Success &&
+	    type == XA_WINDOW && format == 32) {
+		previous = reported_windows;
+		reported_windows = g_hash_table_new (g_direct_hash, g_direct_equal);
+		clients = (Window *) data;
+		for (i = 0; i < n_items; i++) {
+			pid = g_hash_table_lookup (previous,
+			                           GUINT_TO_POINTER (clients[i]));
+			if (pid != NULL)
+				g_hash_table_insert (reported_windows,
+				                     GUINT_TO_POINTER (clients[i]),
+				                     pid);
+			else
+				report_window (display, clients[i]);
+		}
+		g_hash_table_destroy (previous);
+	}
+	if (data != NULL)
+		XFree (data);
+	gdk_error_trap_pop ();
+}
+
+/* Reports the window in _NET_ACTIVE_WINDOW of root if it changed since
+ * the last report. The pid is 0 if no window is active or the active
+ * window has no _NET_WM_PID.
+ */
+static void
+report_active_window (Display *display, Window root)
+{
+	Atom type;
+	int format;
+	unsigned long n_items, bytes_after;
+	unsigned char *data = NULL;
+	Window active = None;
+
+	gdk_error_trap_push ();
+	if (XGetWindowProperty (display, root, net_active_window,
+	                        0, 1, False, XA_WINDOW,
+	                        &type, &format, &n_items, &bytes_after,
+	                        &data) == Success &&
+	    type == XA_WINDOW && format == 32 && n_items == 1) {
+		active = *((Window *) data);
+	}
+	if (data != NULL)
+		XFree (data);
+	gdk_error_trap_pop ();
+
+	if (active == last_active_window)
+		return;
+	last_active_window = active;
+
+	TRACE (g_print ("Window 0x%lx activated\n", active));
+
+	(active_handler) ((gulong) active,
+	                  active != None ? get_window_pid (display, active) : 0,
+	                  active_user_data);
+}
+
 static GdkFilterReturn
 filter_func (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
 {
@@ -409,6 +564,26 @@ filter_func (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
 	case KeyRelease:
 		TRACE (g_print ("Got KeyRelease! \n"));
 		break;
+	case MapNotify:
+		if (window_handler != NULL)
+			report_window (xevent->xmap.display, xevent->xmap.window);
+		break;
+	case DestroyNotify:
+		if (reported_windows != NULL)
+			g_hash_table_remove (reported_windows,
+			                     GUINT_TO_POINTER (xevent->xdestroywindow.window));
+		break;
+	case PropertyNotify:
+		if (window_handler != NULL &&
+		    xevent->xproperty.atom == net_client_list &&
+		    xevent->xproperty.state == PropertyNewValue)
+			report_client_list (xevent->xproperty.display,
+			                    xevent->xproperty.window);
+		else if (active_handler != NULL &&
+		         xevent->xproperty.atom == net_active_window)
+			report_active_window (xevent->xproperty.display,
+			                      xevent->xproperty.window);
+		break;
 	}
 
 	return GDK_FILTER_CONTINUE;
@@ -503,6 +678,129 @@ gm_keybinder_unbind (const char *keystring, KeybinderHandler handler)
 	}
 }
 
+void
+gm_keybinder_watch_windows (WindowMappedHandler handler, void *user_data)
+{
+	GdkWindow *rootwin = gdk_get_default_root_window ();
+	Display *display = GDK_WINDOW_XDISPLAY (rootwin);
+
+	if (reported_windows == NULL) {
+		reported_windows = g_hash_table_new (g_direct_hash, g_direct_equal);
+		init_atoms (display);
+
+		/* Windows that already exist are not reported */
+		window_handler = NULL;
+		report_client_list (display, GDK_WINDOW_XWINDOW (rootwin));
+	}
+
+	window_handler = handler;
+	window_user_data = user_data;
+
+	if (handler == NULL)
+		return;
+
+	gdk_window_set_events (rootwin,
+	                       gdk_window_get_events (rootwin) |
+	                       GDK_SUBSTRUCTURE_MASK |
+	                       GDK_PROPERTY_CHANGE_MASK);
+}
+
+void
+gm_keybinder_watch_active_window (WindowActivatedHandler handler,
+                                  void *user_data)
+{
+	GdkWindow *rootwin = gdk_get_default_root_window ();
+	Display *display = GDK_WINDOW_XDISPLAY (rootwin);
+
+	init_atoms (display);
+
+	active_handler = handler;
+	active_user_data = user_data;
+	last_active_window = None;
+
+	if (handler == NULL)
+		return;
+
+	gdk_window_set_events (rootwin,
+	                       gdk_window_get_events (rootwin) |
+	                       GDK_PROPERTY_CHANGE_MASK);
+}
+
+gulong
+gm_keybinder_find_window (WindowMatchFunc match, void *user_data)
+{
+	GdkWindow *rootwin = gdk_get_default_root_window ();
+	Display *display = GDK_WINDOW_XDISPLAY (rootwin);
+	Atom type;
+	int format;
+	unsigned long n_items, bytes_after, i;
+	unsigned char *data = NULL;
+	Window *clients;
+	gulong found = 0;
+	gint pid;
+
+	init_atoms (display);
+
+	/* Prefer the stacking order so the topmost window is found first,
+	 * not every window manager supports it though.
+	 */
+	gdk_error_trap_push ();
+	if (XGetWindowProperty (display, GDK_WINDOW_XWINDOW (rootwin),
+	                        net_client_list_stacking,
+	                        0, G_MAXLONG, False, XA_WINDOW,
+	                        &type, &format, &n_items, &bytes_after,
+	                        &data) != Success || type != XA_WINDOW) {
+		if (data != NULL)
+			XFree (data);
+		data = NULL;
+		XGetWindowProperty (display, GDK_WINDOW_XWINDOW (rootwin),
+		                    net_client_list,
+		                    0, G_MAXLONG, False, XA_WINDOW,
+		                    &type, &format, &n_items, &bytes_after,
+		                    &data);
+	}
+
+	if (data != NULL && type == XA_WINDOW && format == 32) {
+		clients = (Window *) data;
+		for (i = n_items; i > 0 && found == 0; i--) {
+			pid = get_window_pid (display, clients[i - 1]);
+			if (pid > 0 && (match) (pid, user_data))
+				found = clients[i - 1];
+		}
+	}
+	if (data != NULL)
+		XFree (data);
+	gdk_error_trap_pop ();
+
+	return found;
+}
+
+void
+gm_keybinder_activate_window (gulong xwindow, guint32 timestamp)
+{
+	GdkWindow *rootwin = gdk_get_default_root_window ();
+	Display *display = GDK_WINDOW_XDISPLAY (rootwin);
+	XEvent xev;
+
+	init_atoms (display);
+
+	memset (&xev, 0, sizeof (xev));
+	xev.xclient.type = ClientMessage;
+	xev.xclient.send_event = True;
+	xev.xclient.window = xwindow;
+	xev.xclient.message_type = net_active_window;
+	xev.xclient.format = 32;
+	xev.xclient.data.l[0] = 2; /* source indication: pager */
+	xev.xclient.data.l[1] = timestamp;
+	xev.xclient.data.l[2] = None;
+
+	gdk_error_trap_push ();
+	XSendEvent (display, GDK_WINDOW_XWINDOW (rootwin), False,
+	            SubstructureRedirectMask | SubstructureNotifyMask, &xev);
+	gdk_flush ();
+	gdk_error_trap_pop ();
+}
+
 guint32
 gm_keybinder_get_current_event_time (void)
 {
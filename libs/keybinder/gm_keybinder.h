@@ -38,6 +38,12 @@ G_BEGIN_DECLS
 
 typedef void (* KeybinderHandler) (const char *keystring, void *user_data);
 
+typedef void (* WindowMappedHandler) (gulong xwindow, gint pid, void *user_data);
+
+typedef void (* WindowActivatedHandler) (gulong xwindow, gint pid, void *user_data);
+
+typedef gboolean (* WindowMatchFunc) (gint pid, void *user_data);
+
 void gm_keybinder_init (void);
 
 gboolean gm_keybinder_bind (const char *keystring,
@@ -49,6 +55,31 @@ void gm_keybinder_unbind (const char *keystring,
 
 guint32 gm_keybinder_get_current_event_time (void);
 
+/* Calls handler once for every top level window that is mapped after
+ * this call and has a _NET_WM_PID property. Requires gm_keybinder_init.
+ * Passing NULL stops reporting windows.
+ */
+void gm_keybinder_watch_windows (WindowMappedHandler handler,
+                                 void *user_data);
+
+/* Calls handler every time the window manager activates another window,
+ * as reported by _NET_ACTIVE_WINDOW on the root window. xwindow is 0 if
+ * no window is active and pid is 0 if the window has no _NET_WM_PID.
+ * Requires gm_keybinder_init. Passing NULL stops reporting.
+ */
+void gm_keybinder_watch_active_window (WindowActivatedHandler handler,
+                                       void *user_data);
+
+/* Returns the topmost client window whose _NET_WM_PID is accepted by
+ * match, or 0 if there is no such window.
+ */
+gulong gm_keybinder_find_window (WindowMatchFunc match, void *user_data);
+
+/* Asks the window manager to raise and focus xwindow using
+ * _NET_ACTIVE_WINDOW.
+ */
+void gm_keybinder_activate_window (gulong xwindow, guint32 timestamp);
+
 G_END_DECLS
 
 #endif /* __GM_KEY_BINDER_H__ */
@@ -0,0 +1,618 @@
+/**
+ * \file gm_launcher.c
+ * \brief starts programs using posix_spawn
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "gm_launcher.h"
+
+#define IOPRIO_WHO_PROCESS 1 ///< ioprio_set applies to a single process
+#define IOPRIO_CLASS_SHIFT 13 ///< position of the class in an IO priority
+
+extern char **environ;
+
+/**
+* \brief returns the monotonic time in seconds
+*/
+static gdouble get_time()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+gm_launcher *gm_launcher_create(const gchar *exec, gchar **args, gint amount_of_args)
+{
+	gm_launcher *launcher;
+	gint i;
+
+	if (exec == NULL)
+	{
+		return NULL;
+	}
+
+	launcher = g_new0(gm_launcher, 1);
+	launcher->exec = g_strdup(exec);
+	launcher->output_fd = -1;
+
+	/**
+	  First element should be the filename of the executable and
+	  last element needs to be NULL. see man exec for more details
+	*/
+	launcher->argv = g_new(gchar *, amount_of_args + 2);
+	launcher->argv[0] = g_strdup(exec);
+	for (i = 0; i < amount_of_args; i++)
+	{
+		launcher->argv[i + 1] = g_strdup(args[i]);
+	}
+	launcher->argv[i + 1] = NULL;
+
+	return launcher;
+}
+
+gm_launcher *gm_launcher_create_from_menu_element(gm_menu_element *elt)
+{
+	gm_launcher *launcher;
+
+	if (elt == NULL)
+	{
+		return NULL;
+	}
+
+	launcher = gm_launcher_create(elt->exec, elt->args,
+								  gm_menu_element_get_amount_of_arguments(elt));
+	if (launcher != NULL)
+	{
+		gm_launcher_set_profile(launcher, elt->profile);
+	}
+	return launcher;
+}
+
+void gm_launcher_free(gm_launcher *launcher)
+{
+	if (launcher == NULL)
+	{
+		return;
+	}
+
+	g_free(launcher->exec);
+	g_strfreev(launcher->argv);
+	g_strfreev(launcher->envp);
+	g_free(launcher->working_directory);
+	g_free(launcher->profile);
+	g_free(launcher);
+}
+
+void gm_launcher_set_working_directory(gm_launcher *launcher, const gchar *directory)
+{
+	g_free(launcher->working_directory);
+	launcher->working_directory = g_strdup(directory);
+}
+
+void gm_launcher_set_env(gm_launcher *launcher, const gchar *variable, const gchar *value)
+{
+	gchar *entry;
+	gsize length;
+	guint i;
+
+	if (launcher->envp == NULL)
+	{
+		launcher->envp = g_strdupv(environ);
+	}
+
+	entry = g_strconcat(variable, "=", value, NULL);
+	length = strlen(variable);
+
+	for (i = 0; launcher->envp[i] != NULL; i++)
+	{
+		if ((strncmp(launcher->envp[i], variable, length) == 0)
+			&& (launcher->envp[i][length] == '='))
+		{
+			g_free(launcher->envp[i]);
+			launcher->envp[i] = entry;
+			return;
+		}
+	}
+
+	launcher->envp = g_renew(gchar *, launcher->envp, i + 2);
+	launcher->envp[i] = entry;
+	launcher->envp[i + 1] = NULL;
+}
+
+void gm_launcher_set_profile(gm_launcher *launcher, const gm_launch_profile *profile)
+{
+	g_free(launcher->profile);
+	launcher->profile = NULL;
+	if (profile != NULL)
+	{
+		launcher->profile = g_memdup(profile, sizeof(gm_launch_profile));
+	}
+}
+
+void gm_launcher_set_flags(gm_launcher *launcher, GmLauncherFlags flags)
+{
+	launcher->flags = flags;
+}
+
+void gm_launcher_set_output(gm_launcher *launcher, int fd)
+{
+	launcher->output_fd = fd;
+}
+
+gdouble gm_launcher_get_last_launch_time(gm_launcher *launcher)
+{
+	return launcher->last_launch_time;
+}
+
+guint64 gm_launcher_get_cpus()
+{
+	cpu_set_t set;
+	guint64 cpus = 0;
+	gint cpu;
+
+	if (sched_getaffinity(0, sizeof(set), &set) == -1)
+	{
+		return 0;
+	}
+
+	for (cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++)
+	{
+		if (CPU_ISSET(cpu, &set))
+		{
+			cpus |= G_GUINT64_CONSTANT(1) << cpu;
+		}
+	}
+	return cpus;
+}
+
+/**
+* \brief converts a CPU mask to a cpu_set_t. Only uses macros so it can be
+* called between fork and exec.
+*/
+static void cpus_to_set(guint64 cpus, cpu_set_t *set)
+{
+	gint cpu;
+
+	CPU_ZERO(set);
+	for (cpu = 0; cpu < 64; cpu++)
+	{
+		if (cpus & (G_GUINT64_CONSTANT(1) << cpu))
+		{
+			CPU_SET(cpu, set);
+		}
+	}
+}
+
+GmReturnCode gm_launcher_set_cpus(guint64 cpus)
+{
+	cpu_set_t set;
+	DIR *dir;
+	struct dirent *entry;
+	pid_t tid;
+	GmReturnCode status = GM_SUCCESS;
+
+	cpus_to_set(cpus, &set);
+
+	// sched_setaffinity only applies to a single thread, so pin every
+	// thread that already exists, e.g. the conf.d parser threads
+	dir = opendir("/proc/self/task");
+	if (dir == NULL)
+	{
+		if (sched_setaffinity(0, sizeof(set), &set) == -1)
+		{
+			g_warning("Could not set CPU affinity: %s", g_strerror(errno));
+			return GM_FAIL;
+		}
+		return GM_SUCCESS;
+	}
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		tid = atoi(entry->d_name);
+		if (tid > 0 && sched_setaffinity(tid, sizeof(set), &set) == -1
+			&& errno != ESRCH)
+		{
+			g_warning("Could not set CPU affinity of thread %d: %s", (int) tid,
+					  g_strerror(errno));
+			status = GM_FAIL;
+		}
+	}
+	closedir(dir);
+
+	return status;
+}
+
+/**
+* \brief checks if a profile holds settings that must be applied in the
+* child between fork and exec. The CPU affinity is not one of them, the
+* child inherits it from the thread that starts it.
+* \param profile launch profile, may be NULL
+* \return TRUE if the program must be started using fork
+*/
+static gboolean profile_needs_fork(gm_launch_profile *profile)
+{
+	if (profile == NULL)
+	{
+		return FALSE;
+	}
+
+	return profile->nice != GM_PROFILE_UNSET
+		|| profile->ionice_class != GM_PROFILE_UNSET
+		|| profile->max_memory >= 0 || profile->max_files >= 0
+		|| profile->oom_score_adj != GM_PROFILE_UNSET;
+}
+
+/**
+* \brief applies a launch profile to the calling process. Called in the child
+* between fork and exec, so only async-signal-safe functions are used.
+* Settings that can not be applied, e.g. a lower oom_score_adj without the
+* required privileges, are skipped.
+* \param profile launch profile
+* \param oom_score_adj profile->oom_score_adj formatted by the parent
+*/
+static void apply_profile(gm_launch_profile *profile, const char *oom_score_adj)
+{
+	cpu_set_t set;
+	struct rlimit limit;
+	int fd;
+
+	if (profile->cpus != 0)
+	{
+		cpus_to_set(profile->cpus, &set);
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+
+	if (profile->nice != GM_PROFILE_UNSET)
+	{
+		setpriority(PRIO_PROCESS, 0, profile->nice);
+	}
+
+#ifdef SYS_ioprio_set
+	if (profile->ionice_class != GM_PROFILE_UNSET)
+	{
+		syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+				(profile->ionice_class << IOPRIO_CLASS_SHIFT) | profile->ionice_level);
+	}
+#endif
+
+	if (profile->max_memory >= 0)
+	{
+		limit.rlim_cur = limit.rlim_max = profile->max_memory;
+		setrlimit(RLIMIT_AS, &limit);
+	}
+
+	if (profile->max_files >= 0)
+	{
+		limit.rlim_cur = limit.rlim_max = profile->max_files;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	if (oom_score_adj[0] != '\0')
+	{
+		fd = open("/proc/self/oom_score_adj", O_WRONLY);
+		if (fd != -1)
+		{
+			if (write(fd, oom_score_adj, strlen(oom_score_adj)) == -1)
+			{
+				// not allowed to lower the score, keep the inherited value
+			}
+			close(fd);
+		}
+	}
+}
+
+#ifndef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+static void set_cloexec(int fd)
+{
+	int flags;
+
+	flags = fcntl(fd, F_GETFD);
+	if (flags != -1 && !(flags & FD_CLOEXEC))
+	{
+		fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+	}
+}
+
+/**
+* \brief marks every open file descriptor above stderr close-on-exec, so
+* started programs do not inherit the sockets and files the process
+* inherited or opened before its first launch. Scanning the descriptors is
+* only done for the first launch, descriptors opened afterwards must be
+* opened close-on-exec, like gappman does.
+*/
+static void set_cloexec_once()
+{
+	static gboolean done = FALSE;
+	DIR *dir;
+	struct dirent *entry;
+	long max_fd;
+	int fd;
+
+	if (done)
+	{
+		return;
+	}
+	done = TRUE;
+
+	dir = opendir("/proc/self/fd");
+	if (dir != NULL)
+	{
+		while ((entry = readdir(dir)) != NULL)
+		{
+			fd = atoi(entry->d_name);
+			if ((fd > 2) && (fd != dirfd(dir)))
+			{
+				set_cloexec(fd);
+			}
+		}
+		closedir(dir);
+		return;
+	}
+
+	max_fd = sysconf(_SC_OPEN_MAX);
+	for (fd = 3; fd < max_fd; fd++)
+	{
+		set_cloexec(fd);
+	}
+}
+#endif
+
+/**
+* \brief closes all file descriptors above stderr. Called in the child
+* between fork and exec, so only async-signal-safe functions are used.
+* \param max_fd highest possible file descriptor plus one, determined by the
+* parent
+*/
+static void close_inherited_fds(long max_fd)
+{
+	int fd;
+
+#ifdef SYS_close_range
+	if (syscall(SYS_close_range, STDERR_FILENO + 1, ~0U, 0) == 0)
+	{
+		return;
+	}
+#endif
+
+	for (fd = STDERR_FILENO + 1; fd < max_fd; fd++)
+	{
+		close(fd);
+	}
+}
+
+/**
+* \brief starts the program using fork for when the launch profile of the
+* program must be applied in the child or posix_spawn can not change the
+* working directory of the child.
+* \return process ID of the child or -1 on failure
+*/
+static pid_t launch_with_fork(gm_launcher *launcher, char **envp)
+{
+	char oom_score_adj[16] = "";
+	sigset_t signals;
+	long max_fd;
+	pid_t pid;
+	int signum;
+	int fd;
+
+	if (launcher->profile != NULL && launcher->profile->oom_score_adj != GM_PROFILE_UNSET)
+	{
+		snprintf(oom_score_adj, sizeof(oom_score_adj), "%d\n",
+				 launcher->profile->oom_score_adj);
+	}
+
+	max_fd = sysconf(_SC_OPEN_MAX);
+
+	pid = fork();
+	if (pid != 0)
+	{
+		// also set the group in the parent, so the group exists as soon
+		// as fork returns. Fails harmlessly if the child did so already.
+		if (pid != -1 && (launcher->flags & GM_LAUNCHER_NEW_PROCESS_GROUP))
+		{
+			setpgid(pid, pid);
+		}
+		return pid;
+	}
+
+	if (launcher->flags & GM_LAUNCHER_NEW_PROCESS_GROUP)
+	{
+		setpgid(0, 0);
+	}
+
+	if (launcher->profile != NULL)
+	{
+		apply_profile(launcher->profile, oom_score_adj);
+	}
+
+	if (launcher->working_directory != NULL && chdir(launcher->working_directory) == -1)
+	{
+		_exit(127);
+	}
+
+	// restore the signal handlers and mask posix_spawn would reset
+	for (signum = 1; signum < NSIG; signum++)
+	{
+		signal(signum, SIG_DFL);
+	}
+	sigemptyset(&signals);
+	sigprocmask(SIG_SETMASK, &signals, NULL);
+
+	if (launcher->output_fd != -1)
+	{
+		dup2(launcher->output_fd, STDOUT_FILENO);
+		dup2(launcher->output_fd, STDERR_FILENO);
+	}
+
+	fd = open("/dev/null", O_RDWR);
+	if (fd != -1)
+	{
+		dup2(fd, STDIN_FILENO);
+		if (launcher->flags & GM_LAUNCHER_STDOUT_TO_DEV_NULL)
+		{
+			dup2(fd, STDOUT_FILENO);
+		}
+		if (launcher->flags & GM_LAUNCHER_STDERR_TO_DEV_NULL)
+		{
+			dup2(fd, STDERR_FILENO);
+		}
+	}
+	close_inherited_fds(max_fd);
+
+	if (launcher->flags & GM_LAUNCHER_SEARCH_PATH)
+	{
+		execvpe(launcher->exec, launcher->argv, envp);
+	}
+	else
+	{
+		execve(launcher->exec, launcher->argv, envp);
+	}
+	_exit(127);
+}
+
+GmReturnCode gm_launcher_start(gm_launcher *launcher, GPid *pid)
+{
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	sigset_t signals;
+	cpu_set_t set;
+	cpu_set_t saved_set;
+	gboolean use_fork;
+	gboolean restore_cpus = FALSE;
+	char **envp;
+	pid_t childpid = -1;
+	gdouble start;
+	short attr_flags;
+	int result;
+
+	if (launcher == NULL)
+	{
+		return GM_FAIL;
+	}
+
+	envp = launcher->envp != NULL ? launcher->envp : environ;
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawnattr_init(&attr);
+
+	// The child must not inherit gappman's stdin, signal mask and signal handlers
+	posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+	if (launcher->output_fd != -1)
+	{
+		posix_spawn_file_actions_adddup2(&actions, launcher->output_fd, STDOUT_FILENO);
+		posix_spawn_file_actions_adddup2(&actions, launcher->output_fd, STDERR_FILENO);
+	}
+	if (launcher->flags & GM_LAUNCHER_STDOUT_TO_DEV_NULL)
+	{
+		posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+	}
+	if (launcher->flags & GM_LAUNCHER_STDERR_TO_DEV_NULL)
+	{
+		posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+	}
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+	posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+#else
+	set_cloexec_once();
+#endif
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+	if (launcher->working_directory != NULL)
+	{
+		posix_spawn_file_actions_addchdir_np(&actions, launcher->working_directory);
+	}
+#endif
+
+	attr_flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_USEVFORK
+	attr_flags |= POSIX_SPAWN_USEVFORK;
+#endif
+	if (launcher->flags & GM_LAUNCHER_NEW_PROCESS_GROUP)
+	{
+		attr_flags |= POSIX_SPAWN_SETPGROUP;
+		posix_spawnattr_setpgroup(&attr, 0);
+	}
+	posix_spawnattr_setflags(&attr, attr_flags);
+	sigemptyset(&signals);
+	posix_spawnattr_setsigmask(&attr, &signals);
+	sigfillset(&signals);
+	posix_spawnattr_setsigdefault(&attr, &signals);
+
+	use_fork = profile_needs_fork(launcher->profile);
+#ifndef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+	use_fork = use_fork || launcher->working_directory != NULL;
+#endif
+
+	// the child inherits the CPU affinity of this thread, so change it
+	// around posix_spawn instead of forking gappman
+	if (!use_fork && launcher->profile != NULL && launcher->profile->cpus != 0
+		&& sched_getaffinity(0, sizeof(saved_set), &saved_set) == 0)
+	{
+		cpus_to_set(launcher->profile->cpus, &set);
+		restore_cpus = sched_setaffinity(0, sizeof(set), &set) == 0;
+	}
+
+	start = get_time();
+	if (use_fork)
+	{
+		childpid = launch_with_fork(launcher, envp);
+		result = childpid == -1 ? errno : 0;
+	}
+	else if (launcher->flags & GM_LAUNCHER_SEARCH_PATH)
+	{
+		result = posix_spawnp(&childpid, launcher->exec, &actions, &attr,
+							  launcher->argv, envp);
+	}
+	else
+	{
+		result = posix_spawn(&childpid, launcher->exec, &actions, &attr,
+							 launcher->argv, envp);
+	}
+	launcher->last_launch_time = get_time() - start;
+
+	if (restore_cpus)
+	{
+		sched_setaffinity(0, sizeof(saved_set), &saved_set);
+	}
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (result != 0)
+	{
+		g_warning("Could not execute %s: %s", launcher->exec, g_strerror(result));
+		return GM_FAIL;
+	}
+
+	launcher->launches++;
+	launcher->total_launch_time += launcher->last_launch_time;
+	g_get_current_time(&launcher->last_launch);
+
+	if (pid != NULL)
+	{
+		*pid = childpid;
+	}
+
+	return GM_SUCCESS;
+}
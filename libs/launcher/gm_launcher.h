@@ -0,0 +1,153 @@
+/**
+ * \file gm_launcher.h
+ * \brief starts programs using posix_spawn
+ *
+ * A launcher holds the argument vector, environment and working directory
+ * of a program. These are built once when the launcher is created so
+ * starting the program only costs a single posix_spawn call. posix_spawn
+ * does not copy the page tables of the calling process, which keeps the
+ * time needed to start a program independent of the memory size of the
+ * process that starts it.
+ *
+ * Programs whose launch profile changes the scheduling priority, IO
+ * priority, resource limits or OOM score are started using fork, as these
+ * must be applied in the child before it executes the program. A CPU
+ * affinity is applied using posix_spawn, by changing the affinity of the
+ * calling thread while the program is started.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_LAUNCHER_H__
+#define __GAPPMAN_LAUNCHER_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+/**
+* Flags that change how gm_launcher_start starts a program
+*/
+typedef enum launcher_flags
+{
+	GM_LAUNCHER_DEFAULT = 0,	///< inherit stdout and stderr, exec must be a path
+	GM_LAUNCHER_SEARCH_PATH = 1 << 0,	///< search exec in PATH if it does not contain a slash
+	GM_LAUNCHER_STDOUT_TO_DEV_NULL = 1 << 1,	///< redirect stdout to /dev/null
+	GM_LAUNCHER_STDERR_TO_DEV_NULL = 1 << 2,	///< redirect stderr to /dev/null
+	GM_LAUNCHER_NEW_PROCESS_GROUP = 1 << 3	///< start the program in a process group of its own, so it can be signalled together with its descendants
+} GmLauncherFlags;
+
+typedef struct _launcher gm_launcher;
+
+/**
+* \brief prebuilt information needed to start a program
+*/
+struct _launcher
+{
+	gchar *exec;	///< path to the executable
+	gchar **argv;	///< NULL terminated argument vector, argv[0] is exec
+	gchar **envp;	///< NULL terminated environment, NULL to inherit gappman's environment
+	gchar *working_directory;	///< directory the program is started in, NULL to inherit
+	gm_launch_profile *profile;	///< settings applied to the program, NULL to inherit gappman's
+	GmLauncherFlags flags;	///< flags used when starting the program
+	int output_fd;	///< file descriptor stdout and stderr are redirected to, -1 to inherit
+	guint launches;	///< amount of times the program was started
+	gdouble last_launch_time;	///< seconds spent in the last call to posix_spawn
+	gdouble total_launch_time;	///< seconds spent in all calls to posix_spawn
+	GTimeVal last_launch;	///< time at which the program was last started
+};
+
+/**
+* \brief creates a launcher for exec
+* \param exec path to the executable
+* \param args arguments that should be passed to exec, may be NULL
+* \param amount_of_args amount of elements in args
+* \return new launcher or NULL if exec is NULL
+*/
+gm_launcher *gm_launcher_create(const gchar *exec, gchar **args, gint amount_of_args);
+
+/**
+* \brief creates a launcher for the program of a menu element
+* \param elt menu element
+* \return new launcher or NULL if elt has no executable
+*/
+gm_launcher *gm_launcher_create_from_menu_element(gm_menu_element *elt);
+
+/**
+* \brief relinguishes the memory occupied by a launcher
+* \param launcher launcher, may be NULL
+*/
+void gm_launcher_free(gm_launcher *launcher);
+
+/**
+* \brief sets the directory the program is started in
+* \param launcher launcher
+* \param directory working directory or NULL to inherit gappman's working directory
+*/
+void gm_launcher_set_working_directory(gm_launcher *launcher, const gchar *directory);
+
+/**
+* \brief sets an environment variable for the program. The first call copies
+* gappman's environment.
+* \param launcher launcher
+* \param variable name of the environment variable
+* \param value value of the environment variable
+*/
+void gm_launcher_set_env(gm_launcher *launcher, const gchar *variable, const gchar *value);
+
+/**
+* \brief sets the scheduling and resource settings applied to the program
+* \param launcher launcher
+* \param profile profile that is copied into the launcher or NULL to inherit gappman's settings
+*/
+void gm_launcher_set_profile(gm_launcher *launcher, const gm_launch_profile *profile);
+
+/**
+* \brief sets the flags used when starting the program
+* \param launcher launcher
+* \param flags bitwise or of GmLauncherFlags
+*/
+void gm_launcher_set_flags(gm_launcher *launcher, GmLauncherFlags flags);
+
+/**
+* \brief redirects stdout and stderr of the program to a file descriptor,
+* e.g. the write end of a pipe. GM_LAUNCHER_STDOUT_TO_DEV_NULL and
+* GM_LAUNCHER_STDERR_TO_DEV_NULL take precedence. The launcher does not
+* close fd.
+* \param launcher launcher
+* \param fd file descriptor or -1 to inherit gappman's stdout and stderr
+*/
+void gm_launcher_set_output(gm_launcher *launcher, int fd);
+
+/**
+* \brief starts the program. The caller is responsible for reaping the child,
+* e.g. using g_child_watch_add.
+* \param launcher launcher
+* \param pid will hold the process ID of the started program, may be NULL
+* \return GM_SUCCESS if the program was started, GM_FAIL otherwise
+*/
+GmReturnCode gm_launcher_start(gm_launcher *launcher, GPid *pid);
+
+/**
+* \brief returns the time spent starting the program the last time
+* \param launcher launcher
+* \return seconds spent in posix_spawn or 0 if the program was never started
+*/
+gdouble gm_launcher_get_last_launch_time(gm_launcher *launcher);
+
+/**
+* \brief returns the CPUs the calling thread may run on
+* \return mask with bit n set for CPU n, only the first 64 CPUs are reported
+*/
+guint64 gm_launcher_get_cpus();
+
+/**
+* \brief restricts all threads of the calling process, and the threads and
+* processes they create afterwards, to a set of CPUs
+* \param cpus mask with bit n set for CPU n
+* \return GM_SUCCESS or GM_FAIL if the affinity could not be changed
+*/
+GmReturnCode gm_launcher_set_cpus(guint64 cpus);
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * \file gm_zygote-protocol.h
+ * \brief messages exchanged between gappman and the zygote
+ *
+ * Requests and replies are sent as single packets over a SOCK_SEQPACKET
+ * socket. The zygote's end of the socket is its stdin.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_ZYGOTE_PROTOCOL_H__
+#define __GAPPMAN_ZYGOTE_PROTOCOL_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+
+#define ZYGOTE_MAX_MESSAGE_SIZE 65536 ///< maximum size of a single request
+
+/**
+* Types of the messages exchanged with the zygote
+*/
+enum zygote_message_type
+{
+	ZYGOTE_LAUNCH,	///< request to start a program
+	ZYGOTE_SPAWNED,	///< reply, the program was started
+	ZYGOTE_FAILED,	///< reply, the program could not be started
+	ZYGOTE_EXITED	///< notification, a started program exited
+};
+
+/**
+* \brief header of a launch request. The header is followed by the NUL
+* terminated strings exec, working directory (empty to inherit), argc
+* arguments and envc environment entries (envc is 0 to inherit).
+*/
+struct zygote_request
+{
+	guint32 type;	///< ZYGOTE_LAUNCH
+	guint32 flags;	///< GmLauncherFlags
+	guint32 argc;	///< amount of arguments, excluding exec
+	guint32 envc;	///< amount of environment entries
+	guint32 has_profile;	///< 1 if profile should be applied to the program
+	gm_launch_profile profile;	///< launch profile of the program
+};
+
+/**
+* \brief reply to a launch request or notification of an exited program
+*/
+struct zygote_reply
+{
+	guint32 type;	///< ZYGOTE_SPAWNED, ZYGOTE_FAILED or ZYGOTE_EXITED
+	gint32 pid;	///< process ID of the started or exited program
+	gint32 status;	///< exit status as returned by waitpid for ZYGOTE_EXITED
+	gdouble launch_time;	///< seconds spent in posix_spawn for ZYGOTE_SPAWNED
+};
+
+#endif
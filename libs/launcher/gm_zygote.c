@@ -0,0 +1,455 @@
+/**
+ * \file gm_zygote.c
+ * \brief starts programs through a helper process
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include "gm_zygote.h"
+#include "gm_zygote-protocol.h"
+
+#ifndef ZYGOTE_PATH
+#define ZYGOTE_PATH "/usr/libexec/gmzygote"
+#endif
+
+#define ZYGOTE_TIMEOUT 250 ///< milliseconds the GTK thread waits for the zygote to reply to a launch request
+#define ZYGOTE_POLL_INTERVAL 1000 ///< milliseconds between checks if a program of a stopped zygote still runs
+
+extern char **environ;
+
+/**
+* \brief program started by the zygote that is being watched
+*/
+struct zygote_watch
+{
+	GPid pid;	///< process ID of the program
+	GChildWatchFunc function;	///< function to call when the program exits, NULL if not watched yet
+	gpointer data;	///< user data passed to function
+	gboolean exited;	///< TRUE if the program exited before it was watched
+	gint status;	///< exit status of the program if exited is TRUE
+};
+
+static int zygote_fd = -1;	///< gappman's end of the zygote socket
+static guint zygote_source = 0;	///< source id of the watch on zygote_fd
+static GHashTable *watches = NULL;	///< struct zygote_watch indexed by process ID
+
+static void zygote_lost();
+
+static void zygote_reaped(GPid pid, gint status, gpointer data)
+{
+	g_spawn_close_pid(pid);
+}
+
+static gboolean dispatch_watch(struct zygote_watch *watch)
+{
+	watch->function(watch->pid, watch->status, watch->data);
+	g_free(watch);
+	return FALSE;
+}
+
+#ifdef SYS_pidfd_open
+static gboolean pidfd_event(GIOChannel *source, GIOCondition condition,
+							struct zygote_watch *watch)
+{
+	return dispatch_watch(watch);
+}
+#endif
+
+static gboolean poll_program(struct zygote_watch *watch)
+{
+	if (kill(watch->pid, 0) == 0 || errno == EPERM)
+	{
+		return TRUE;
+	}
+	return dispatch_watch(watch);
+}
+
+/**
+* \brief keeps track of a program after the zygote, its parent, stopped.
+* The program is no longer a child of anyone gappman can wait for, so its
+* exit status is unknown and reported as 0 once it exited.
+* \param watch watch of the program
+*/
+static void track_orphan(struct zygote_watch *watch)
+{
+	GIOChannel *channel;
+	int fd;
+
+	watch->status = 0;
+
+#ifdef SYS_pidfd_open
+	// a pidfd becomes readable when the process exits
+	fd = syscall(SYS_pidfd_open, watch->pid, 0);
+	if (fd != -1)
+	{
+		channel = g_io_channel_unix_new(fd);
+		g_io_channel_set_close_on_unref(channel, TRUE);
+		g_io_add_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+					   (GIOFunc) pidfd_event, watch);
+		g_io_channel_unref(channel);
+		return;
+	}
+#endif
+
+	g_timeout_add(ZYGOTE_POLL_INTERVAL, (GSourceFunc) poll_program, watch);
+}
+
+/**
+* \brief handles a notification that a program started by the zygote exited
+* \param pid process ID of the program
+* \param status exit status as returned by waitpid
+*/
+static void program_exited(GPid pid, gint status)
+{
+	struct zygote_watch *watch;
+
+	watch = g_hash_table_lookup(watches, GINT_TO_POINTER(pid));
+	if (watch == NULL)
+	{
+		// program exited before gm_zygote_child_watch_add was called
+		watch = g_new0(struct zygote_watch, 1);
+		watch->pid = pid;
+		watch->exited = TRUE;
+		watch->status = status;
+		g_hash_table_insert(watches, GINT_TO_POINTER(pid), watch);
+		return;
+	}
+
+	g_hash_table_steal(watches, GINT_TO_POINTER(pid));
+	watch->status = status;
+	dispatch_watch(watch);
+}
+
+/**
+* \brief receives a single reply from the zygote
+* \param reply will hold the reply
+* \return TRUE if a reply was received, FALSE if the zygote is gone
+*/
+static gboolean receive_reply(struct zygote_reply *reply)
+{
+	ssize_t size;
+
+	do
+	{
+		size = recv(zygote_fd, reply, sizeof(struct zygote_reply), 0);
+	}
+	while (size == -1 && errno == EINTR);
+
+	if (size != sizeof(struct zygote_reply))
+	{
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean zygote_event(GIOChannel *source, GIOCondition condition, gpointer data)
+{
+	struct zygote_reply reply;
+
+	if ((condition & G_IO_IN) && receive_reply(&reply))
+	{
+		if (reply.type == ZYGOTE_EXITED)
+		{
+			program_exited(reply.pid, reply.status);
+		}
+		return TRUE;
+	}
+
+	zygote_source = 0;
+	zygote_lost();
+	return FALSE;
+}
+
+/**
+* \brief called when the connection with the zygote is lost. Watched
+* programs are tracked by their process ID from now on.
+*/
+static void zygote_lost()
+{
+	g_warning("Lost connection with zygote");
+	gm_zygote_stop();
+}
+
+GmReturnCode gm_zygote_start(gchar **preload)
+{
+	posix_spawn_file_actions_t actions;
+	GIOChannel *channel;
+	const gchar *path;
+	gchar **argv;
+	GPid pid;
+	int sv[2];
+	int result;
+	guint i;
+
+	if (zygote_fd != -1)
+	{
+		return GM_SUCCESS;
+	}
+
+	path = g_getenv("GM_ZYGOTE");
+	if (path == NULL)
+	{
+		path = ZYGOTE_PATH;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == -1)
+	{
+		g_warning("Could not create zygote socket: %s", g_strerror(errno));
+		return GM_FAIL;
+	}
+	fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+	fcntl(sv[1], F_SETFD, FD_CLOEXEC);
+
+	argv = g_new0(gchar *, (preload != NULL ? g_strv_length(preload) : 0) + 2);
+	argv[0] = (gchar *) path;
+	for (i = 0; preload != NULL && preload[i] != NULL; i++)
+	{
+		argv[i + 1] = preload[i];
+	}
+
+	// the zygote uses its stdin to communicate with gappman
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, sv[1], STDIN_FILENO);
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+	posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+#endif
+	result = posix_spawn(&pid, path, &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	g_free(argv);
+	close(sv[1]);
+
+	if (result != 0)
+	{
+		g_warning("Could not start zygote %s: %s", path, g_strerror(result));
+		close(sv[0]);
+		return GM_FAIL;
+	}
+
+	zygote_fd = sv[0];
+	watches = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	channel = g_io_channel_unix_new(zygote_fd);
+	zygote_source = g_io_add_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+								   zygote_event, NULL);
+	g_io_channel_unref(channel);
+
+	g_child_watch_add(pid, zygote_reaped, NULL);
+
+	return GM_SUCCESS;
+}
+
+void gm_zygote_stop()
+{
+	GHashTableIter iter;
+	struct zygote_watch *watch;
+
+	if (zygote_fd == -1)
+	{
+		return;
+	}
+
+	if (zygote_source != 0)
+	{
+		g_source_remove(zygote_source);
+		zygote_source = 0;
+	}
+
+	// closing the socket makes the zygote exit
+	close(zygote_fd);
+	zygote_fd = -1;
+
+	g_hash_table_iter_init(&iter, watches);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &watch))
+	{
+		if (watch->function != NULL)
+		{
+			// the zygote can no longer report when this program exits
+			track_orphan(watch);
+		}
+		else
+		{
+			g_free(watch);
+		}
+	}
+	g_hash_table_destroy(watches);
+	watches = NULL;
+}
+
+gboolean gm_zygote_is_running()
+{
+	return zygote_fd != -1;
+}
+
+/**
+* \brief appends the NUL terminated string str to message
+*/
+static void append_string(GByteArray *message, const gchar *str)
+{
+	if (str == NULL)
+	{
+		str = "";
+	}
+	g_byte_array_append(message, (const guint8 *) str, strlen(str) + 1);
+}
+
+GmReturnCode gm_zygote_launch(gm_launcher *launcher, GPid *pid)
+{
+	struct zygote_request request;
+	struct zygote_reply reply;
+	struct pollfd pfd;
+	GByteArray *message;
+	GTimer *timer;
+	gboolean sent;
+	gdouble remaining;
+	guint i;
+	int ready;
+
+	if (zygote_fd == -1 || launcher == NULL)
+	{
+		return GM_FAIL;
+	}
+
+	memset(&request, 0, sizeof(request));
+	request.type = ZYGOTE_LAUNCH;
+	request.flags = launcher->flags;
+	request.argc = g_strv_length(launcher->argv) - 1;
+	request.envc = launcher->envp != NULL ? g_strv_length(launcher->envp) : 0;
+	if (launcher->profile != NULL)
+	{
+		request.has_profile = 1;
+		request.profile = *launcher->profile;
+	}
+
+	message = g_byte_array_new();
+	g_byte_array_append(message, (const guint8 *) &request, sizeof(request));
+	append_string(message, launcher->exec);
+	append_string(message, launcher->working_directory);
+	for (i = 1; launcher->argv[i] != NULL; i++)
+	{
+		append_string(message, launcher->argv[i]);
+	}
+	for (i = 0; i < request.envc; i++)
+	{
+		append_string(message, launcher->envp[i]);
+	}
+
+	if (message->len > ZYGOTE_MAX_MESSAGE_SIZE)
+	{
+		g_warning("Arguments of %s too long for zygote", launcher->exec);
+		g_byte_array_free(message, TRUE);
+		return GM_FAIL;
+	}
+
+	sent = send(zygote_fd, message->data, message->len, MSG_NOSIGNAL) == (ssize_t) message->len;
+	g_byte_array_free(message, TRUE);
+	if (!sent)
+	{
+		zygote_lost();
+		return GM_FAIL;
+	}
+
+	// wait for the reply to this request, handling exit notifications
+	// that arrive in the mean time. The zygote only spawns the program, so
+	// it replies quickly unless it hangs, in which case it is stopped and
+	// the caller starts the program itself.
+	timer = g_timer_new();
+	pfd.fd = zygote_fd;
+	pfd.events = POLLIN;
+	while (1)
+	{
+		remaining = ZYGOTE_TIMEOUT - g_timer_elapsed(timer, NULL) * 1000;
+		ready = poll(&pfd, 1, remaining > 0 ? (int) remaining : 0);
+		if (ready == -1 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (ready <= 0 || !receive_reply(&reply))
+		{
+			g_warning("Zygote did not reply within %d ms", ZYGOTE_TIMEOUT);
+			g_timer_destroy(timer);
+			zygote_lost();
+			return GM_FAIL;
+		}
+
+		if (reply.type == ZYGOTE_EXITED)
+		{
+			program_exited(reply.pid, reply.status);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	g_timer_destroy(timer);
+
+	if (reply.type != ZYGOTE_SPAWNED)
+	{
+		g_warning("Zygote could not execute %s", launcher->exec);
+		return GM_FAIL;
+	}
+
+	// like gm_launcher_start, only count the time spent spawning the
+	// program, not the round trip to the zygote
+	launcher->last_launch_time = reply.launch_time;
+	launcher->launches++;
+	launcher->total_launch_time += launcher->last_launch_time;
+	g_get_current_time(&launcher->last_launch);
+
+	if (pid != NULL)
+	{
+		*pid = reply.pid;
+	}
+
+	return GM_SUCCESS;
+}
+
+void gm_zygote_child_watch_add(GPid pid, GChildWatchFunc function, gpointer data)
+{
+	struct zygote_watch *watch;
+
+	if (watches == NULL)
+	{
+		// zygote is gone, watch the program itself
+		watch = g_new0(struct zygote_watch, 1);
+		watch->pid = pid;
+		watch->function = function;
+		watch->data = data;
+		track_orphan(watch);
+		return;
+	}
+
+	watch = g_hash_table_lookup(watches, GINT_TO_POINTER(pid));
+	if (watch != NULL && watch->exited)
+	{
+		g_hash_table_steal(watches, GINT_TO_POINTER(pid));
+		watch->function = function;
+		watch->data = data;
+		g_idle_add((GSourceFunc) dispatch_watch, watch);
+		return;
+	}
+
+	watch = g_new0(struct zygote_watch, 1);
+	watch->pid = pid;
+	watch->function = function;
+	watch->data = data;
+	g_hash_table_insert(watches, GINT_TO_POINTER(pid), watch);
+}
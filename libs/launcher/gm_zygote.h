@@ -0,0 +1,65 @@
+/**
+ * \file gm_zygote.h
+ * \brief starts programs through a helper process
+ *
+ * The zygote is a small helper process that is started once. It preloads
+ * configured libraries, which keeps them in memory, and starts programs on
+ * request. The process that uses the zygote therefore never forks itself.
+ * Programs started by the zygote are children of the zygote. Use
+ * gm_zygote_child_watch_add instead of g_child_watch_add to be notified
+ * when they exit.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_ZYGOTE_H__
+#define __GAPPMAN_ZYGOTE_H__
+
+#include <glib.h>
+#include <gm_generic.h>
+#include "gm_launcher.h"
+
+/**
+* \brief starts the zygote. The location of the zygote can be overridden
+* using the environment variable GM_ZYGOTE.
+* \param preload NULL terminated array of libraries the zygote should load, may be NULL
+* \return GM_SUCCESS if the zygote was started, GM_FAIL otherwise
+*/
+GmReturnCode gm_zygote_start(gchar **preload);
+
+/**
+* \brief stops the zygote. Programs started by the zygote keep running.
+*/
+void gm_zygote_stop();
+
+/**
+* \brief checks if the zygote is running
+* \return TRUE if the zygote is running, FALSE otherwise
+*/
+gboolean gm_zygote_is_running();
+
+/**
+* \brief starts the program of launcher through the zygote. A zygote that
+* does not reply within a fraction of a second is stopped, so the caller is
+* not blocked for long.
+* \param launcher launcher of the program
+* \param pid will hold the process ID of the started program, may be NULL
+* \return GM_SUCCESS if the program was started, GM_FAIL otherwise. If
+* gm_zygote_is_running returns FALSE afterwards the zygote was lost and the
+* program should be started using gm_launcher_start instead.
+*/
+GmReturnCode gm_zygote_launch(gm_launcher *launcher, GPid *pid);
+
+/**
+* \brief calls function when a program started by the zygote exits. If the
+* zygote stops before the program exits, function is still only called once
+* the program exited, but with status 0 as the real exit status is unknown.
+* \param pid process ID returned by gm_zygote_launch
+* \param function function that should be called
+* \param data user data passed to function
+*/
+void gm_zygote_child_watch_add(GPid pid, GChildWatchFunc function, gpointer data);
+
+#endif
@@ -0,0 +1,256 @@
+/**
+ * \file gmzygote.c
+ * \brief helper process that starts programs on behalf of gappman
+ *
+ * Started by gm_zygote_start with its stdin connected to gappman. Each
+ * argument is the path of a library that is loaded at startup and kept
+ * loaded. The zygote exits when gappman closes the connection.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "gm_launcher.h"
+#include "gm_zygote-protocol.h"
+
+static int sigchld_pipe[2];	///< self-pipe used to handle SIGCHLD in the main loop
+
+static void sigchld_handler(int signum)
+{
+	int saved_errno = errno;
+
+	if (write(sigchld_pipe[1], "c", 1) == -1)
+	{
+		// pipe is full, the main loop will reap the children anyway
+	}
+	errno = saved_errno;
+}
+
+static void send_reply(guint32 type, pid_t pid, gint status, gdouble launch_time)
+{
+	struct zygote_reply reply;
+
+	memset(&reply, 0, sizeof(reply));
+	reply.type = type;
+	reply.pid = pid;
+	reply.status = status;
+	reply.launch_time = launch_time;
+
+	while (send(STDIN_FILENO, &reply, sizeof(reply), MSG_NOSIGNAL) == -1
+		   && errno == EINTR);
+}
+
+/**
+* \brief reaps all exited children and notifies gappman
+*/
+static void reap_children()
+{
+	pid_t pid;
+	int status;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+	{
+		send_reply(ZYGOTE_EXITED, pid, status, 0);
+	}
+}
+
+/**
+* \brief returns the next NUL terminated string from a request
+* \param pos current position in the request, moved past the string
+* \param end end of the request
+* \return the string or NULL if the request is truncated
+*/
+static gchar *next_string(gchar **pos, gchar *end)
+{
+	gchar *str = *pos;
+	gchar *nul;
+
+	if (str >= end)
+	{
+		return NULL;
+	}
+
+	nul = memchr(str, '\0', end - str);
+	if (nul == NULL)
+	{
+		return NULL;
+	}
+
+	*pos = nul + 1;
+	return str;
+}
+
+/**
+* \brief starts the program described by a launch request
+* \param message the request
+* \param size size of the request in bytes
+*/
+static void handle_request(gchar *message, ssize_t size)
+{
+	struct zygote_request request;
+	gm_launcher *launcher;
+	gchar **args;
+	gchar *pos;
+	gchar *end;
+	gchar *exec;
+	gchar *directory;
+	gchar *entry;
+	gchar *value;
+	GPid pid;
+	guint i;
+
+	if (size < (ssize_t) sizeof(request))
+	{
+		return;
+	}
+	memcpy(&request, message, sizeof(request));
+	if (request.type != ZYGOTE_LAUNCH || request.argc > ZYGOTE_MAX_MESSAGE_SIZE)
+	{
+		send_reply(ZYGOTE_FAILED, -1, 0, 0);
+		return;
+	}
+
+	pos = message + sizeof(request);
+	end = message + size;
+
+	exec = next_string(&pos, end);
+	directory = next_string(&pos, end);
+	args = g_new0(gchar *, request.argc + 1);
+	for (i = 0; i < request.argc; i++)
+	{
+		args[i] = next_string(&pos, end);
+	}
+
+	if (exec == NULL || directory == NULL || (request.argc > 0 && args[request.argc - 1] == NULL))
+	{
+		g_free(args);
+		send_reply(ZYGOTE_FAILED, -1, 0, 0);
+		return;
+	}
+
+	launcher = gm_launcher_create(exec, args, request.argc);
+	g_free(args);
+	gm_launcher_set_flags(launcher, request.flags);
+	if (request.has_profile)
+	{
+		gm_launcher_set_profile(launcher, &request.profile);
+	}
+	if (*directory != '\0')
+	{
+		gm_launcher_set_working_directory(launcher, directory);
+	}
+	for (i = 0; i < request.envc; i++)
+	{
+		entry = next_string(&pos, end);
+		if (entry == NULL || (value = strchr(entry, '=')) == NULL)
+		{
+			break;
+		}
+		*value = '\0';
+		gm_launcher_set_env(launcher, entry, value + 1);
+	}
+
+	if (gm_launcher_start(launcher, &pid) == GM_SUCCESS)
+	{
+		send_reply(ZYGOTE_SPAWNED, pid, 0, gm_launcher_get_last_launch_time(launcher));
+	}
+	else
+	{
+		send_reply(ZYGOTE_FAILED, -1, 0, 0);
+	}
+	gm_launcher_free(launcher);
+}
+
+int main(int argc, char **argv)
+{
+	struct sigaction action;
+	struct pollfd fds[2];
+	gchar *message;
+	gchar buf[64];
+	ssize_t size;
+	int i;
+
+	// Keep the preloaded libraries mapped for the lifetime of the zygote
+	for (i = 1; i < argc; i++)
+	{
+		if (dlopen(argv[i], RTLD_NOW | RTLD_GLOBAL) == NULL)
+		{
+			g_warning("Zygote could not preload %s: %s", argv[i], dlerror());
+		}
+	}
+
+	if (pipe(sigchld_pipe) == -1)
+	{
+		g_warning("Zygote could not create pipe: %s", g_strerror(errno));
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < 2; i++)
+	{
+		fcntl(sigchld_pipe[i], F_SETFL, O_NONBLOCK);
+		fcntl(sigchld_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = sigchld_handler;
+	action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGCHLD, &action, NULL);
+
+	message = g_malloc(ZYGOTE_MAX_MESSAGE_SIZE);
+
+	fds[0].fd = STDIN_FILENO;
+	fds[0].events = POLLIN;
+	fds[1].fd = sigchld_pipe[0];
+	fds[1].events = POLLIN;
+
+	while (1)
+	{
+		if (poll(fds, 2, -1) == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		if (fds[1].revents & POLLIN)
+		{
+			while (read(sigchld_pipe[0], buf, sizeof(buf)) > 0);
+			reap_children();
+		}
+
+		if (fds[0].revents & (POLLIN | POLLHUP | POLLERR))
+		{
+			size = recv(STDIN_FILENO, message, ZYGOTE_MAX_MESSAGE_SIZE, 0);
+			if (size == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			if (size <= 0)
+			{
+				// gappman closed the connection
+				break;
+			}
+			handle_request(message, size);
+		}
+	}
+
+	g_free(message);
+	return EXIT_SUCCESS;
+}
@@ -13,42 +13,665 @@
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <gm_changeresolution.h>
 #include <gm_generic.h>
 
-static XRRScreenConfiguration *sc = NULL;
+static Display *dpy = NULL;
+static Window root;
+static int rr_event_base = 0;	///< first event number of the RandR extension
+static gboolean use_crtcs = FALSE;	///< TRUE if the server supports RandR 1.2 or newer
+static gboolean use_current_resources = FALSE;	///< TRUE if the server supports RandR 1.3 or newer
+static gboolean stale = TRUE;	///< TRUE if the cached configuration must be reloaded
+
+static XRRScreenConfiguration *sc = NULL;	///< screen configuration used with RandR 1.0 and 1.1
+
+static XRRScreenResources *resources = NULL;	///< outputs, CRTCs and modes of the screen
+static XRROutputInfo **outputs = NULL;	///< output information, in the order of resources->outputs
+static XRRCrtcInfo **crtcs = NULL;	///< CRTC information, in the order of resources->crtcs
+static GSList *returned_sizes = NULL;	///< size lists returned by gm_res_getpossibleresolutions, most recent first
+static int returned_nsize = 0;	///< amount of sizes in the most recent list
+static gboolean sizes_stale = TRUE;	///< TRUE if the most recent list must be built again
+static GmResChangedFunc changed_func = NULL;	///< called when the screen configuration changed
+static void *changed_data = NULL;	///< passed to changed_func
+
+static void free_resources()
+{
+	int i;
+
+	if (resources == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < resources->noutput; i++)
+	{
+		if (outputs[i] != NULL)
+		{
+			XRRFreeOutputInfo(outputs[i]);
+		}
+	}
+	for (i = 0; i < resources->ncrtc; i++)
+	{
+		if (crtcs[i] != NULL)
+		{
+			XRRFreeCrtcInfo(crtcs[i]);
+		}
+	}
+	g_free(outputs);
+	g_free(crtcs);
+	XRRFreeScreenResources(resources);
+	outputs = NULL;
+	crtcs = NULL;
+	resources = NULL;
+}
+
+/**
+* \brief reloads the cached screen configuration if it changed since it was
+* last loaded
+* \return GM_SUCCESS or GM_NO_SCREEN_CONFIGURATION
+*/
+static int load_configuration()
+{
+	int i;
+
+	if (dpy == NULL)
+	{
+		return GM_NO_SCREEN_CONFIGURATION;
+	}
+
+	if (!stale)
+	{
+		return GM_SUCCESS;
+	}
+	sizes_stale = TRUE;
+
+	if (!use_crtcs)
+	{
+		if (sc != NULL)
+		{
+			XRRFreeScreenConfigInfo(sc);
+		}
+		sc = XRRGetScreenInfo(dpy, root);
+		if (sc == NULL)
+		{
+			return GM_NO_SCREEN_CONFIGURATION;
+		}
+		stale = FALSE;
+		return GM_SUCCESS;
+	}
+
+	free_resources();
+
+	// GetScreenResourcesCurrent does not probe the outputs, which
+	// may take several hundred milliseconds
+	if (use_current_resources)
+	{
+		resources = XRRGetScreenResourcesCurrent(dpy, root);
+	}
+	else
+	{
+		resources = XRRGetScreenResources(dpy, root);
+	}
+	if (resources == NULL)
+	{
+		return GM_NO_SCREEN_CONFIGURATION;
+	}
+
+	outputs = g_new0(XRROutputInfo *, resources->noutput);
+	for (i = 0; i < resources->noutput; i++)
+	{
+		outputs[i] = XRRGetOutputInfo(dpy, resources, resources->outputs[i]);
+	}
+	crtcs = g_new0(XRRCrtcInfo *, resources->ncrtc);
+	for (i = 0; i < resources->ncrtc; i++)
+	{
+		crtcs[i] = XRRGetCrtcInfo(dpy, resources, resources->crtcs[i]);
+	}
+
+	stale = FALSE;
+	return GM_SUCCESS;
+}
+
+/**
+* \brief marks the cached configuration stale when the screen configuration
+* changed, e.g. by another program
+*/
+static GdkFilterReturn filter_randr_events(GdkXEvent *gdk_xevent, GdkEvent *event,
+										   gpointer data)
+{
+	XEvent *xevent = (XEvent *) gdk_xevent;
+
+	if (xevent->type == rr_event_base + RRScreenChangeNotify
+		|| xevent->type == rr_event_base + RRNotify)
+	{
+		XRRUpdateConfiguration(xevent);
+		stale = TRUE;
+		if (changed_func != NULL)
+		{
+			changed_func(changed_data);
+		}
+	}
+
+	return GDK_FILTER_CONTINUE;
+}
 
 void gm_res_free()
 {
-	XRRFreeScreenConfigInfo(sc);
+	GSList *l;
+
+	if (dpy == NULL)
+	{
+		return;
+	}
+
+	gdk_window_remove_filter(NULL, filter_randr_events, NULL);
+
+	if (sc != NULL)
+	{
+		XRRFreeScreenConfigInfo(sc);
+		sc = NULL;
+	}
+	free_resources();
+
+	for (l = returned_sizes; l != NULL; l = l->next)
+	{
+		g_free(l->data);
+	}
+	g_slist_free(returned_sizes);
+	returned_sizes = NULL;
+	returned_nsize = 0;
+	sizes_stale = TRUE;
+
+	dpy = NULL;
+	stale = TRUE;
+	changed_func = NULL;
+	changed_data = NULL;
+}
+
+void gm_res_set_changed_callback(GmResChangedFunc func, void *user_data)
+{
+	changed_func = func;
+	changed_data = user_data;
 }
 
 int gm_res_init()
 {
-	GdkDisplay *gdk_dpy;
+	int error_base;
+	int major = 0;
+	int minor = 0;
+	int mask;
 
-	gdk_dpy = gdk_display_get_default();
+	if (dpy != NULL)
+	{
+		g_warning("gm_res already initialized");
+		return GM_FAIL;
+	}
+
+	dpy = GDK_DISPLAY_XDISPLAY(gdk_display_get_default());
+	root = GDK_ROOT_WINDOW();
 
-	if (sc == NULL)
+	if (!XRRQueryExtension(dpy, &rr_event_base, &error_base)
+		|| !XRRQueryVersion(dpy, &major, &minor))
 	{
-		sc = XRRGetScreenInfo(GDK_DISPLAY_XDISPLAY(gdk_dpy),
-							  GDK_ROOT_WINDOW());
-		return GM_SUCCESS;
+		dpy = NULL;
+		return GM_NO_RANDR_EXTENSION;
+	}
+
+	use_crtcs = major > 1 || (major == 1 && minor >= 2);
+	use_current_resources = major > 1 || (major == 1 && minor >= 3);
+
+	mask = RRScreenChangeNotifyMask;
+	if (use_crtcs)
+	{
+		mask |= RRCrtcChangeNotifyMask | RROutputChangeNotifyMask;
+	}
+	XRRSelectInput(dpy, root, mask);
+	gdk_window_add_filter(NULL, filter_randr_events, NULL);
+
+	stale = TRUE;
+	return load_configuration();
+}
+
+/**
+* \brief returns the cached information of a CRTC
+*/
+static XRRCrtcInfo *lookup_crtc(RRCrtc crtc)
+{
+	int i;
+
+	for (i = 0; i < resources->ncrtc; i++)
+	{
+		if (resources->crtcs[i] == crtc)
+		{
+			return crtcs[i];
+		}
+	}
+	return NULL;
+}
+
+static XRRModeInfo *lookup_mode(RRMode mode)
+{
+	int i;
+
+	for (i = 0; i < resources->nmode; i++)
+	{
+		if (resources->modes[i].id == mode)
+		{
+			return &resources->modes[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+* \brief calculates the vertical refresh rate of a mode
+* \return refresh rate in Hz or 0 if it is unknown
+*/
+static double get_refresh_rate(XRRModeInfo *mode)
+{
+	double vtotal = mode->vTotal;
+
+	if (mode->modeFlags & RR_DoubleScan)
+	{
+		vtotal *= 2;
+	}
+	if (mode->modeFlags & RR_Interlace)
+	{
+		vtotal /= 2;
+	}
+
+	if (mode->hTotal == 0 || vtotal == 0)
+	{
+		return 0;
+	}
+	return mode->dotClock / (mode->hTotal * vtotal);
+}
+
+/**
+* \brief returns the size of a mode on the screen, taking the rotation of the
+* CRTC into account
+*/
+static void get_mode_size(XRRModeInfo *mode, Rotation rotation, int *width, int *height)
+{
+	if (rotation & (RR_Rotate_90 | RR_Rotate_270))
+	{
+		*width = mode->height;
+		*height = mode->width;
 	}
 	else
 	{
-		g_warning("gm_res already initialized");
+		*width = mode->width;
+		*height = mode->height;
+	}
+}
+
+/**
+* \brief selects the output whose resolution is changed
+* \param name name of the output, NULL for the primary output or, if there is
+* none, the first output that is switched on
+* \return index of the output in outputs or -1 if there is no such output
+*/
+static int select_output(const char *name)
+{
+	RROutput primary = None;
+	int i;
+
+	if (name == NULL && use_current_resources)
+	{
+		primary = XRRGetOutputPrimary(dpy, root);
+	}
+
+	for (i = 0; i < resources->noutput; i++)
+	{
+		if (outputs[i] == NULL || outputs[i]->crtc == None)
+		{
+			continue;
+		}
+
+		if (name != NULL)
+		{
+			if (strcmp(outputs[i]->name, name) == 0)
+			{
+				return i;
+			}
+		}
+		else if (primary == None || resources->outputs[i] == primary)
+		{
+			return i;
+		}
+	}
+
+	if (name == NULL && primary != None)
+	{
+		// primary output is switched off
+		for (i = 0; i < resources->noutput; i++)
+		{
+			if (outputs[i] != NULL && outputs[i]->crtc != None)
+			{
+				return i;
+			}
+		}
+	}
+
+	return -1;
+}
+
+/**
+* \brief selects the mode of an output with exactly width x height pixels and
+* the requested refresh rate. If refresh is 0 the mode with the refresh rate
+* closest to the current one is selected. If the output has no mode of
+* width x height the mode with the closest size is selected.
+* \return the mode or None if no mode has the requested refresh rate
+*/
+static RRMode select_mode(XRROutputInfo *output, XRRCrtcInfo *crtc, int width,
+						  int height, int refresh)
+{
+	XRRModeInfo *mode;
+	XRRModeInfo *current;
+	RRMode best = None;
+	RRMode nearest = None;
+	double target;
+	double distance;
+	double best_distance = 0;
+	int nearest_distance = 0;
+	int mode_width;
+	int mode_height;
+	int size_distance;
+	int i;
+
+	current = lookup_mode(crtc->mode);
+	target = refresh > 0 ? refresh : (current != NULL ? get_refresh_rate(current) : 0);
+
+	for (i = 0; i < output->nmode; i++)
+	{
+		mode = lookup_mode(output->modes[i]);
+		if (mode == NULL)
+		{
+			continue;
+		}
+		get_mode_size(mode, crtc->rotation, &mode_width, &mode_height);
+
+		if (mode_width == width && mode_height == height)
+		{
+			if (refresh > 0 && lrint(get_refresh_rate(mode)) != refresh)
+			{
+				continue;
+			}
+			distance = fabs(get_refresh_rate(mode) - target);
+			if (best == None || distance < best_distance)
+			{
+				best = mode->id;
+				best_distance = distance;
+			}
+		}
+		else if (refresh <= 0)
+		{
+			// Higher resolutions prevail, the modes of an output
+			// are sorted by size
+			size_distance = abs((mode_width + mode_height) - (width + height));
+			if (nearest == None || size_distance < nearest_distance)
+			{
+				nearest = mode->id;
+				nearest_distance = size_distance;
+			}
+		}
+	}
+
+	return best != None ? best : nearest;
+}
+
+/**
+* \brief calculates the screen size needed to show all CRTCs
+* \param changed CRTC that is going to be changed
+* \param width width of changed after the change
+* \param height height of changed after the change
+*/
+static void get_screen_size(XRRCrtcInfo *changed, int width, int height,
+							int *screen_width, int *screen_height)
+{
+	int crtc_width;
+	int crtc_height;
+	int i;
+
+	*screen_width = 0;
+	*screen_height = 0;
+	for (i = 0; i < resources->ncrtc; i++)
+	{
+		if (crtcs[i] == NULL || crtcs[i]->mode == None)
+		{
+			continue;
+		}
+
+		crtc_width = crtcs[i] == changed ? width : (int) crtcs[i]->width;
+		crtc_height = crtcs[i] == changed ? height : (int) crtcs[i]->height;
+		*screen_width = MAX(*screen_width, crtcs[i]->x + crtc_width);
+		*screen_height = MAX(*screen_height, crtcs[i]->y + crtc_height);
+	}
+}
+
+/**
+* \brief resizes the screen keeping its physical size per pixel
+* \return FALSE if the X server refused the size
+*/
+static gboolean set_screen_size(int width, int height)
+{
+	int screen = DefaultScreen(dpy);
+	int mm_width;
+	int mm_height;
+
+	mm_width = (int) ((double) width * DisplayWidthMM(dpy, screen) / DisplayWidth(dpy, screen));
+	mm_height = (int) ((double) height * DisplayHeightMM(dpy, screen) / DisplayHeight(dpy, screen));
+
+	gdk_error_trap_push();
+	XRRSetScreenSize(dpy, root, width, height, mm_width, mm_height);
+	if (gdk_error_trap_pop() != 0)
+	{
+		g_warning("Could not resize the screen to %dx%d", width, height);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static int change_crtc_mode(const char *output_name, int width, int height, int refresh)
+{
+	XRROutputInfo *output;
+	XRRCrtcInfo *crtc;
+	XRRModeInfo *mode;
+	RRCrtc crtc_id;
+	RRMode mode_id;
+	int screen = DefaultScreen(dpy);
+	int mode_width;
+	int mode_height;
+	int screen_width;
+	int screen_height;
+	int old_width;
+	int old_height;
+	int min_width;
+	int min_height;
+	int max_width;
+	int max_height;
+	int index;
+	int error;
+	Status status;
+
+	index = select_output(output_name);
+	if (index == -1)
+	{
+		g_warning("Output %s not found or switched off",
+				  output_name != NULL ? output_name : "(primary)");
+		return GM_NO_SCREEN_CONFIGURATION;
+	}
+	output = outputs[index];
+	crtc_id = output->crtc;
+	crtc = lookup_crtc(crtc_id);
+	if (crtc == NULL)
+	{
+		return GM_NO_SCREEN_CONFIGURATION;
+	}
+
+	mode_id = select_mode(output, crtc, width, height, refresh);
+	if (mode_id == None)
+	{
+		g_warning("Mode %dx%d@%d not available on %s", width, height, refresh,
+				  output->name);
+		return GM_SIZE_NOT_AVAILABLE;
+	}
+
+	if (mode_id == crtc->mode)
+	{
+		return GM_SUCCESS;
+	}
+
+	mode = lookup_mode(mode_id);
+	get_mode_size(mode, crtc->rotation, &mode_width, &mode_height);
+	get_screen_size(crtc, mode_width, mode_height, &screen_width, &screen_height);
+
+	// the server refuses screen sizes outside its range
+	if (XRRGetScreenSizeRange(dpy, root, &min_width, &min_height, &max_width, &max_height))
+	{
+		if (screen_width > max_width || screen_height > max_height)
+		{
+			g_warning("Mode %dx%d on %s does not fit in the maximum screen size %dx%d",
+					  mode_width, mode_height, output->name, max_width, max_height);
+			return GM_SIZE_NOT_AVAILABLE;
+		}
+		screen_width = MAX(screen_width, min_width);
+		screen_height = MAX(screen_height, min_height);
+	}
+
+	old_width = DisplayWidth(dpy, screen);
+	old_height = DisplayHeight(dpy, screen);
+
+	// The screen must be large enough for the CRTC before the mode is set
+	// and can only shrink afterwards
+	if ((screen_width > old_width || screen_height > old_height)
+		&& !set_screen_size(MAX(screen_width, old_width), MAX(screen_height, old_height)))
+	{
+		stale = TRUE;
+		return GM_FAIL;
+	}
+
+	gdk_error_trap_push();
+	status = XRRSetCrtcConfig(dpy, resources, crtc_id, CurrentTime, crtc->x, crtc->y,
+							  mode_id, crtc->rotation, crtc->outputs, crtc->noutput);
+	error = gdk_error_trap_pop();
+	if (status != RRSetConfigSuccess || error != 0)
+	{
+		g_warning("Could not set mode %dx%d on %s", mode_width, mode_height, output->name);
+		// undo the growth of the screen
+		if (screen_width > old_width || screen_height > old_height)
+		{
+			set_screen_size(old_width, old_height);
+		}
+		stale = TRUE;
 		return GM_FAIL;
 	}
+
+	if (screen_width != DisplayWidth(dpy, screen) || screen_height != DisplayHeight(dpy, screen))
+	{
+		set_screen_size(screen_width, screen_height);
+	}
+	XFlush(dpy);
+
+	// the notify events will arrive later, do not reuse the old state
+	stale = TRUE;
+
+	return GM_SUCCESS;
 }
 
 int gm_res_getpossibleresolutions(XRRScreenSize ** sizes, int *nsize)
 {
-	if (sc == NULL)
+	XRROutputInfo *output;
+	XRRCrtcInfo *crtc;
+	XRRModeInfo *mode;
+	XRRScreenSize *list;
+	int width;
+	int height;
+	int index;
+	int i;
+	int j;
+
+	if (load_configuration() != GM_SUCCESS)
 	{
 		return GM_NO_SCREEN_CONFIGURATION;
 	}
-	*sizes = XRRConfigSizes(sc, nsize);
+
+	if (returned_sizes != NULL && sizes_stale == FALSE)
+	{
+		*sizes = returned_sizes->data;
+		*nsize = returned_nsize;
+		return GM_SUCCESS;
+	}
+
+	if (!use_crtcs)
+	{
+		list = XRRConfigSizes(sc, nsize);
+		list = g_memdup(list, *nsize * sizeof(XRRScreenSize));
+	}
+	else
+	{
+		index = select_output(NULL);
+		if (index == -1)
+		{
+			return GM_NO_SCREEN_CONFIGURATION;
+		}
+		output = outputs[index];
+		crtc = lookup_crtc(output->crtc);
+		if (crtc == NULL)
+		{
+			return GM_NO_SCREEN_CONFIGURATION;
+		}
+
+		// an output has a mode per refresh rate, list every size once
+		list = g_new0(XRRScreenSize, output->nmode);
+		*nsize = 0;
+		for (i = 0; i < output->nmode; i++)
+		{
+			mode = lookup_mode(output->modes[i]);
+			if (mode == NULL)
+			{
+				continue;
+			}
+			get_mode_size(mode, crtc->rotation, &width, &height);
+			for (j = 0; j < *nsize; j++)
+			{
+				if (list[j].width == width && list[j].height == height)
+				{
+					break;
+				}
+			}
+			if (j < *nsize)
+			{
+				continue;
+			}
+
+			list[*nsize].width = width;
+			list[*nsize].height = height;
+			if (mode->width > 0 && mode->height > 0)
+			{
+				list[*nsize].mwidth = output->mm_width * width / mode->width;
+				list[*nsize].mheight = output->mm_height * height / mode->height;
+			}
+			(*nsize)++;
+		}
+	}
+
+	// callers keep pointers into the list, so it lives until gm_res_free.
+	// Only keep a new list if the sizes actually changed.
+	sizes_stale = FALSE;
+	if (returned_sizes != NULL && *nsize == returned_nsize
+		&& memcmp(returned_sizes->data, list, *nsize * sizeof(XRRScreenSize)) == 0)
+	{
+		g_free(list);
+	}
+	else
+	{
+		returned_sizes = g_slist_prepend(returned_sizes, list);
+		returned_nsize = *nsize;
+	}
+	*sizes = returned_sizes->data;
 
 	return GM_SUCCESS;
 }
@@ -117,7 +740,7 @@ static int get_nearest_size(XRRScreenConfiguration * sc, int *size, int width,
 				abs((sizes[i].width + sizes[i].height) - (width + height));
 
 			// Higher resolutions should prevail over lower resolutions.
-			// So if two consecutive sizes result in equal distances with 
+			// So if two consecutive sizes result in equal distances with
 			// the requested resolution we take the first size.
 			if (size_dist < min_size_dist)
 			{
@@ -138,19 +761,16 @@ static int get_nearest_size(XRRScreenConfiguration * sc, int *size, int width,
 	return GM_SUCCESS;
 }
 
-int gm_res_changeresolution(int width, int height)
+/**
+* \brief changes the resolution using the RandR 1.0 screen configuration
+*/
+static int change_screen_config(int width, int height)
 {
 	Rotation current_rotation;
 	SizeID current_size;
 	int size = -1;
 	int ret_status;
 	short rate = -1;
-	GdkDisplay *gdk_dpy;
-
-	gdk_dpy = gdk_display_get_default();
-
-	if (sc == NULL)
-		return GM_NO_SCREEN_CONFIGURATION;
 
 	current_size = XRRConfigCurrentConfiguration(sc, &current_rotation);
 
@@ -165,42 +785,72 @@ int gm_res_changeresolution(int width, int height)
 	// Change resolution if needed
 	if (size != current_size)
 	{
-		// Grab X server while we mess with it.
-		gdk_x11_display_grab(gdk_dpy);
-		XRRSelectInput(GDK_DISPLAY_XDISPLAY(gdk_dpy), GDK_ROOT_WINDOW(),
-					   RRScreenChangeNotifyMask);
-		XRRSetScreenConfigAndRate(GDK_DISPLAY_XDISPLAY(gdk_dpy), sc,
-								  GDK_ROOT_WINDOW(), size, current_rotation,
+		gdk_error_trap_push();
+		XRRSetScreenConfigAndRate(dpy, sc, root, size, current_rotation,
 								  rate, CurrentTime);
+		stale = TRUE;
+		if (gdk_error_trap_pop() != 0)
+		{
+			g_warning("Could not change the resolution to %dx%d", width, height);
+			return GM_FAIL;
+		}
+	}
 
-		// Release X server
-		gdk_x11_display_ungrab(gdk_dpy);
+	return GM_SUCCESS;
+}
+
+int gm_res_changeresolution_output(const char *output, int width, int height, int refresh)
+{
+	if (load_configuration() != GM_SUCCESS)
+	{
+		return GM_NO_SCREEN_CONFIGURATION;
 	}
 
+	if (use_crtcs)
+	{
+		return change_crtc_mode(output, width, height, refresh);
+	}
+	return change_screen_config(width, height);
+}
 
-	return GM_SUCCESS;
+int gm_res_changeresolution(int width, int height)
+{
+	return gm_res_changeresolution_output(NULL, width, height, 0);
 }
 
 int gm_res_get_current_size(XRRScreenSize * size)
 {
-	int nsize;
-	SizeID size_id;
-	Rotation current_rotation;
-	GdkDisplay *gdk_dpy;
 	XRRScreenSize *sizes;
+	XRRCrtcInfo *crtc;
+	Rotation current_rotation;
+	SizeID size_id;
+	int nsize;
+	int index;
 
-	gdk_dpy = gdk_display_get_default();
-
-	if (sc == NULL)
+	if (load_configuration() != GM_SUCCESS)
 	{
-		g_warning("sc is NULL");
+		g_warning("No screen configuration");
 		return GM_NO_SCREEN_CONFIGURATION;
 	}
-	sizes = XRRConfigSizes(sc, &nsize);
 
-	size_id = XRRConfigCurrentConfiguration(sc, &current_rotation);
+	if (!use_crtcs)
+	{
+		sizes = XRRConfigSizes(sc, &nsize);
+		size_id = XRRConfigCurrentConfiguration(sc, &current_rotation);
+		*size = sizes[size_id];
+		return GM_SUCCESS;
+	}
+
+	index = select_output(NULL);
+	if (index == -1 || (crtc = lookup_crtc(outputs[index]->crtc)) == NULL)
+	{
+		return GM_NO_SCREEN_CONFIGURATION;
+	}
 
-	*size = sizes[size_id];
+	size->width = crtc->width;
+	size->height = crtc->height;
+	size->mwidth = outputs[index]->mm_width;
+	size->mheight = outputs[index]->mm_height;
 
 	return GM_SUCCESS;
 }
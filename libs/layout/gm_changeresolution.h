@@ -2,6 +2,11 @@
  * \file gm_changeresolution.h
  * \brief Changes X screen resolution using the Xrandr extension
  *
+ * With RandR 1.2 or newer the mode of a single output is changed through
+ * its CRTC. Outputs, CRTCs and modes are cached and reloaded after the X
+ * server reports a configuration change, so changes made by other programs
+ * are picked up. Older servers fall back to the RandR 1.0 screen
+ * configuration.
  *
  * GPL v2
  *
@@ -14,9 +19,17 @@
 #include <X11/Xlib.h>
 #include <X11/extensions/Xrandr.h>
 
+/**
+* \brief function called when the screen configuration changed
+* \param user_data data passed to gm_res_set_changed_callback
+*/
+typedef void (*GmResChangedFunc) (void *user_data);
+
 /**
 * \brief initializes the gm_res module. 
 * This needs to be called before any of the other gm_res_* functions are called.
+* Configuration changes are noticed through a GDK event filter, so a GDK
+* display must be open.
 */
 int gm_res_init();
 
@@ -33,11 +46,26 @@ void gm_res_free();
 */
 int gm_res_changeresolution(int width, int height);
 
+/**
+* \brief changes the mode of an output to width x height. Nothing is done if
+* the output already uses the selected mode.
+* \param output name of the output, e.g. "HDMI-1", or NULL for the primary output
+* \param width new width of the output
+* \param height new height of the output
+* \param refresh refresh rate in Hz the mode must have, or 0 for the rate closest
+* to the current one. If refresh is 0 and there is no mode of width x height the
+* mode with the nearest size is used.
+* \return gm_res_error
+*/
+int gm_res_changeresolution_output(const char *output, int width, int height, int refresh);
+
 /**
 * \brief Queries using Xrandr the possible screen resolutions
 * \param sizes pointer to a list of XRRScreenSizes
 * \param size pointer to integer that will hold the amount of available sizes
 * \return int Error type, see enum error_types
+* The list stays valid until gm_res_free is called. Calls return the same
+* list as long as the available sizes do not change.
 */
 int gm_res_getpossibleresolutions(XRRScreenSize ** sizes, int *size);
 
@@ -47,4 +75,13 @@ int gm_res_getpossibleresolutions(XRRScreenSize ** sizes, int *size);
 */
 int gm_res_get_current_size(XRRScreenSize * size);
 
+/**
+* \brief sets the function that is called after the X server reported a
+* change of the screen configuration, e.g. after a resolution switch
+* completed. The function is called from the GDK main loop.
+* \param func function to call or NULL to remove it
+* \param user_data passed to func
+*/
+void gm_res_set_changed_callback(GmResChangedFunc func, void *user_data);
+
 #endif
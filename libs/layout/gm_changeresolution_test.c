@@ -0,0 +1,140 @@
+/**
+ * \file gm_changeresolution_test.c
+ * \brief switches the screen through all available resolutions using gm_res
+ *
+ * Not built by default. Build with "make gm_changeresolution_test" and run it
+ * on a scratch X server, e.g. using tests/xvfbres.sh. Exits with a non zero
+ * status if a check failed. X errors the backend does not trap abort the
+ * program.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <gtk/gtk.h>
+#include <gm_generic.h>
+#include "gm_changeresolution.h"
+
+#define SETTLE_TIMEOUT 2000 ///< milliseconds to wait for the X server to report a change
+
+static gint failures = 0;
+static gboolean changed = FALSE;	///< TRUE once the X server reported a change
+
+static void check(gboolean ok, const gchar *what)
+{
+	printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if (!ok)
+	{
+		failures++;
+	}
+}
+
+static void screen_changed(void *user_data)
+{
+	changed = TRUE;
+}
+
+static gboolean settle_timeout(gboolean *passed)
+{
+	*passed = TRUE;
+	return FALSE;
+}
+
+/**
+* \brief handles X events until the X server reported a change or
+* SETTLE_TIMEOUT passed
+*/
+static void wait_for_change()
+{
+	gboolean passed = FALSE;
+	guint source;
+
+	source = g_timeout_add(SETTLE_TIMEOUT, (GSourceFunc) settle_timeout, &passed);
+	while (!changed && !passed)
+	{
+		g_main_context_iteration(NULL, TRUE);
+	}
+	if (!passed)
+	{
+		g_source_remove(source);
+	}
+	changed = FALSE;
+}
+
+/**
+* \brief switches to a resolution and checks the backend reports it afterwards
+*/
+static void switch_to(int width, int height)
+{
+	XRRScreenSize current;
+	gchar *what;
+	int status;
+
+	status = gm_res_changeresolution(width, height);
+	what = g_strdup_printf("change to %dx%d", width, height);
+	check(status == GM_SUCCESS, what);
+	g_free(what);
+	if (status != GM_SUCCESS)
+	{
+		return;
+	}
+	wait_for_change();
+
+	what = g_strdup_printf("current size is %dx%d", width, height);
+	check(gm_res_get_current_size(&current) == GM_SUCCESS
+		  && current.width == width && current.height == height, what);
+	g_free(what);
+}
+
+int main(int argc, char **argv)
+{
+	XRRScreenSize original;
+	XRRScreenSize *sizes;
+	XRRScreenSize *again;
+	int nsize;
+	int nagain;
+	int i;
+
+	gtk_init(&argc, &argv);
+
+	if (gm_res_init() != GM_SUCCESS)
+	{
+		fprintf(stderr, "No RandR screen configuration available\n");
+		return EXIT_FAILURE;
+	}
+	gm_res_set_changed_callback(screen_changed, NULL);
+
+	check(gm_res_get_current_size(&original) == GM_SUCCESS, "get current size");
+	check(gm_res_getpossibleresolutions(&sizes, &nsize) == GM_SUCCESS && nsize > 0,
+		  "get possible resolutions");
+	check(gm_res_getpossibleresolutions(&again, &nagain) == GM_SUCCESS
+		  && again == sizes && nagain == nsize,
+		  "unchanged resolutions return the same list");
+
+	for (i = 0; i < nsize; i++)
+	{
+		printf("size: %dx%d\n", sizes[i].width, sizes[i].height);
+	}
+
+	for (i = 0; i < nsize; i++)
+	{
+		switch_to(sizes[i].width, sizes[i].height);
+	}
+
+	check(gm_res_changeresolution_output("gm-no-such-output", original.width,
+										 original.height, 0) != GM_SUCCESS,
+		  "unknown output is refused");
+	check(gm_res_changeresolution_output(NULL, original.width, original.height,
+										 1000) != GM_SUCCESS,
+		  "unavailable refresh rate is refused");
+
+	switch_to(original.width, original.height);
+
+	gm_res_free();
+
+	printf("%d checks failed\n", failures);
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
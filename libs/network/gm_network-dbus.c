@@ -29,6 +29,8 @@
 #include "gm_network-generic.h"
 #include "gm_network-dbus.h"
 
+#define STOP_PROCESSES_TIMEOUT 10000 ///< milliseconds gappman gets to stop all programs
+
 static GMutex *check_status_mutex;
 
 static DBusGProxy *get_proxy()
@@ -191,6 +193,33 @@ int gm_dbus_set_default_resolution_for_program(gchar * name, int width,
 	return GM_SUCCESS;
 }
 
+GmReturnCode gm_dbus_stop_processes_in_gappman(int *killed)
+{
+	GError *error = NULL;
+	DBusGProxy *proxy;
+	gboolean status;
+
+	proxy = get_proxy();
+	// gappman replies when all programs exited
+	status = dbus_g_proxy_call_with_timeout(proxy,
+											"StopProcesses", STOP_PROCESSES_TIMEOUT,
+											&error,
+											G_TYPE_INVALID,
+											G_TYPE_INT, killed,
+											G_TYPE_INVALID);
+
+	if (status == FALSE)
+	{
+		g_warning("Failed to call StopProcesses: %s", error->message);
+		g_error_free(error);
+		error = NULL;
+
+		return GM_FAIL;
+	}
+
+	return GM_SUCCESS;
+}
+
 int gm_dbus_get_window_geometry_from_gappman(int *width, int *height)
 {
 	GError *error = NULL;
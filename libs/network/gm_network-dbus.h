@@ -42,6 +42,13 @@ GmReturnCode gm_dbus_get_confpath_from_gappman(gchar ** path);
 */
 int gm_dbus_get_fontsize_from_gappman(int *fontsize);
 
+/**
+* \brief Stops all programs started by gappman
+* \param killed will hold the amount of programs that did not exit in time and were killed
+* \return integer value (GM_*) as defined in libs/generic/gm_generic.h
+*/
+GmReturnCode gm_dbus_stop_processes_in_gappman(int *killed);
+
 /**
 * \brief Requests for the windowgeometry object
 * \param width a value by reference which will hold the retrieved width from gappman
@@ -1,7 +1,12 @@
 /**
- * \file gm_network.c
- *
+ * \file gm_network-socket.c
  *
+ * All requests of a process share a single connection to gappman, which is
+ * kept alive with ::keepalive::. Each reply on the connection is preceded by
+ * its length and a newline. If gappman closed the connection in the
+ * meantime, e.g. because it was idle too long, a new connection is made.
+ * Connections to gappman on the local host use its unix domain socket and
+ * only fall back to TCP if gappman does not listen on that socket.
  *
  * GPL v2
  *
@@ -15,18 +20,30 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
 #ifdef HAVE_NETDB_H
 #include <netdb.h>
 #endif
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 
 #include <glib.h>
-#include <string.h>
-#include "gm_connect-generic.h"
-#include "gm_connect-socket.h"
+#include "gm_network-generic.h"
+#include "gm_network-socket.h"
+
+#define KEEPALIVE_MSG "::keepalive::\n" ///< makes gappman keep the connection open
+#define KEEPALIVE_REPLY "keepalive::1" ///< reply of gappman to KEEPALIVE_MSG
+#define RECEIVE_SIZE 4096 ///< bytes read from the connection at once
+
+static int connection_fd = -1;	///< connection to gappman, -1 if not connected
+static int connection_port = -1;	///< port connection_fd is connected to
+static gchar *connection_host = NULL;	///< host connection_fd is connected to
+static GString *received = NULL;	///< received bytes that are not part of a returned reply yet
 
 static gchar *parse_message(gchar * msg, gchar *keyword)
 {
@@ -44,103 +61,311 @@ static gchar *parse_message(gchar * msg, gchar *keyword)
 	return NULL;
 }
 
-static int send_and_receive_message(GIOChannel *gio, gchar **rcv_msg, gchar *send_msg)
+static void parseProceslistMessage(struct proceslist **procs, gchar * msg)
 {
-  gsize len;
-	gchar *msg = NULL;
-	int status;
-	gsize bytes_written;
-	GError *gerror = NULL;
+	gchar **contentssplit = NULL;
+	int i = 0;
+	int state = 0;
+	contentssplit = g_strsplit(msg, "::", 0);
+
+	while (contentssplit[i] != NULL)
+	{
+		if (g_strcmp0("name", contentssplit[i]) == 0)
+		{
+			*procs = createnewproceslist(*procs);
+			(*procs)->name = contentssplit[i + 1];
+			state = 1;
+		}
+		else if (g_strcmp0("pid", contentssplit[i]) == 0)
+		{
+			if (state == 1)
+			{
+				(*procs)->pid = atoi(contentssplit[i + 1]);
+				state = 0;
+			}
+		}
+		i++;
+	}
+}
 
+void gm_socket_disconnect_from_gappman()
+{
+	if (connection_fd != -1)
+	{
+		close(connection_fd);
+		connection_fd = -1;
+	}
+	g_free(connection_host);
+	connection_host = NULL;
+	connection_port = -1;
+	if (received != NULL)
+	{
+		g_string_truncate(received, 0);
+	}
+}
+
+/**
+* \brief sends data completely
+* \return TRUE if all data was sent
+*/
+static gboolean send_all(const gchar *data, gsize length)
+{
+	ssize_t sent;
+
+	while (length > 0)
+	{
+		sent = send(connection_fd, data, length, MSG_NOSIGNAL);
+		if (sent == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return FALSE;
+		}
+		data += sent;
+		length -= sent;
+	}
+	return TRUE;
+}
+
+/**
+* \brief receives a reply framed as `<LENGTH>\n<REPLY>`
+* \param reply will hold the reply, must be freed with g_free
+* \return GM_SUCCESS or GM_COULD_NOT_RECEIVE_MESSAGE
+*/
+static GmReturnCode receive_reply(gchar ** reply)
+{
+	gchar data[RECEIVE_SIZE];
+	gchar *newline;
+	gchar *end;
+	gsize header;
+	gulong length;
+	ssize_t size;
+
+	while (TRUE)
+	{
+		newline = memchr(received->str, '\n', received->len);
+		if (newline != NULL)
+		{
+			length = strtoul(received->str, &end, 10);
+			if (end != newline)
+			{
+				g_warning("gm_socket: invalid reply from gappman");
+				return GM_COULD_NOT_RECEIVE_MESSAGE;
+			}
+			header = newline - received->str + 1;
+			if (received->len >= header + length)
+			{
+				*reply = g_strndup(received->str + header, length);
+				g_string_erase(received, 0, header + length);
 #if defined(DEBUG)
-g_debug("sending message %s", send_msg);
+g_debug("received message %s", *reply);
 #endif
+				return GM_SUCCESS;
+			}
+		}
 
-	status =
-		g_io_channel_write_chars(gio, (const gchar *)send_msg, -1, &bytes_written,
-								 &gerror);
-	if (status == G_IO_STATUS_ERROR)
+		size = recv(connection_fd, data, sizeof(data), 0);
+		if (size > 0)
+		{
+			g_string_append_len(received, data, size);
+		}
+		else if (size == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			return GM_COULD_NOT_RECEIVE_MESSAGE;
+		}
+	}
+}
+
+/**
+* \brief connects to gappman unless the connection to portno on hostname is
+* still open
+* \param connected will be TRUE if a new connection was made
+* \return integer value (GM_*) as defined in libs/generic/gm_generic.h
+*/
+static GmReturnCode open_connection(int portno, const char *hostname, gboolean *connected)
+{
+	GmReturnCode status;
+
+	*connected = FALSE;
+	if (connection_fd != -1 && connection_port == portno
+		&& g_strcmp0(connection_host, hostname) == 0)
 	{
-		g_warning("gm_socket: %s\n",
-				  gerror->message);
-		return GM_COULD_NOT_SEND_MESSAGE;
+		return GM_SUCCESS;
 	}
 
-	status = g_io_channel_flush(gio, &gerror);
-	if (status == G_IO_STATUS_ERROR)
+	gm_socket_disconnect_from_gappman();
+	status = gm_socket_connect_to_gappman(portno, hostname, &connection_fd);
+	if (status != GM_SUCCESS)
 	{
-		g_warning("gm_socket: %s\n",
-				  gerror->message);
+		if (connection_fd >= 0)
+		{
+			close(connection_fd);
+		}
+		connection_fd = -1;
+		return status;
 	}
+	fcntl(connection_fd, F_SETFD, FD_CLOEXEC);
 
-	status = g_io_channel_read_line(gio, &msg, NULL, NULL, &gerror);
-	if (status == G_IO_STATUS_ERROR)
+	connection_port = portno;
+	connection_host = g_strdup(hostname);
+	if (received == NULL)
 	{
-		g_warning("gm_socket: %s\n",
-          gerror->message);
-		rcv_msg = NULL;
-		return GM_COULD_NOT_RECEIVE_MESSAGE;
+		received = g_string_new(NULL);
 	}
+	*connected = TRUE;
+
+	return GM_SUCCESS;
+}
+
+/**
+* \brief sends messages to gappman and receives their replies. All messages
+* are sent at once and gappman replies in order, so a list of messages costs
+* a single round trip.
+* \param messages NULL terminated list of messages, each ending with a newline
+* \param replies will hold the reply of each message, must be freed with g_strfreev
+* \return integer value (GM_*) as defined in libs/generic/gm_generic.h
+*/
+static GmReturnCode send_requests(int portno, const char *hostname, gchar ** messages,
+								  gchar *** replies)
+{
+	GmReturnCode status;
+	GString *request;
+	gboolean connected;
+	gchar *reply;
+	guint amount;
+	guint attempt;
+	guint i;
+
+	amount = g_strv_length(messages);
+
+	// the connection may have been closed by gappman since the last request
+	for (attempt = 0; attempt < 2; attempt++)
+	{
+		status = open_connection(portno, hostname, &connected);
+		if (status != GM_SUCCESS)
+		{
+			return status;
+		}
+
+		request = g_string_new(connected ? KEEPALIVE_MSG : NULL);
+		for (i = 0; i < amount; i++)
+		{
+			g_string_append(request, messages[i]);
+		}
 #if defined(DEBUG)
-g_debug("received message %s", msg);
+g_debug("sending message %s", request->str);
 #endif
+		if (!send_all(request->str, request->len))
+		{
+			g_string_free(request, TRUE);
+			gm_socket_disconnect_from_gappman();
+			if (connected)
+			{
+				return GM_COULD_NOT_SEND_MESSAGE;
+			}
+			continue;
+		}
+		g_string_free(request, TRUE);
+
+		if (connected)
+		{
+			if (receive_reply(&reply) != GM_SUCCESS || g_strcmp0(reply, KEEPALIVE_REPLY) != 0)
+			{
+				g_warning("gm_socket: gappman does not support kept alive connections");
+				gm_socket_disconnect_from_gappman();
+				return GM_COULD_NOT_RECEIVE_MESSAGE;
+			}
+			g_free(reply);
+		}
+
+		*replies = g_new0(gchar *, amount + 1);
+		for (i = 0; i < amount; i++)
+		{
+			if (receive_reply(&(*replies)[i]) != GM_SUCCESS)
+			{
+				break;
+			}
+		}
+		if (i == amount)
+		{
+			return GM_SUCCESS;
+		}
 
-	*rcv_msg = msg;
-	
-	return GM_SUCCES;
+		g_strfreev(*replies);
+		*replies = NULL;
+		gm_socket_disconnect_from_gappman();
+		if (connected || i > 0)
+		{
+			return GM_COULD_NOT_RECEIVE_MESSAGE;
+		}
+	}
+
+	return GM_COULD_NOT_CONNECT;
 }
 
 /**
-* \brief starts a new connection to the application manager and creates a GIO channel
-* \param portno portnumber the application manager is listening on
-* \param hostname hostname of the machine where the application manager is running
-* \param gio will hold the newly created GIO channel for the connection
-* \param sockfd will hold the socket filedescriptor for this connection to close the socket later on
+* \brief sends a single message and receives its reply
+* \param msg message ending with a newline
+* \param reply will hold the reply, must be freed with g_free
+* \return integer value (GM_*) as defined in libs/generic/gm_generic.h
 */
-static int create_gio_channel(int portno, const char *hostname,
-							  GIOChannel ** gio)
+static GmReturnCode send_request(int portno, const char *hostname, const gchar * msg,
+								 gchar ** reply)
 {
-	int status;
-	int sockfd;
+	GmReturnCode status;
+	gchar *messages[2];
+	gchar **replies = NULL;
+
+	messages[0] = (gchar *) msg;
+	messages[1] = NULL;
 
-	status = gm_socket_connect_to_gappman(portno, hostname, &sockfd);
-	if (status != GM_SUCCES)
+	status = send_requests(portno, hostname, messages, &replies);
+	if (status == GM_SUCCESS)
 	{
-		return GM_COULD_NOT_CONNECT;
+		*reply = replies[0];
+		// only the vector is freed, the reply is returned
+		g_free(replies);
 	}
-	*gio = g_io_channel_unix_new(sockfd);
-	g_io_channel_set_buffer_size(*gio, 0);
-	g_io_channel_set_line_term(*gio, NULL, 2);
-	g_io_channel_set_encoding(*gio, "UTF-8", NULL);
-
-	return GM_SUCCES;
+	return status;
 }
 
-static void parseProceslistMessage(struct proceslist **procs, gchar * msg)
+/**
+* \brief connects to the unix domain socket of gappman on the local host
+* \param sockfd will hold the socket filedescriptor
+* \return TRUE if the connection succeeded
+*/
+static gboolean connect_unix(int *sockfd)
 {
-	gchar **contentssplit = NULL;
-	int i = 0;
-	int state = 0;
-	contentssplit = g_strsplit(msg, "::", 0);
+	struct sockaddr_un serv_addr;
+	gchar *path;
+	gboolean connected = FALSE;
 
-	while (contentssplit[i] != NULL)
+	path = gm_get_listener_socket_path();
+	memset((char *)&serv_addr, 0, sizeof(serv_addr));
+	serv_addr.sun_family = AF_UNIX;
+	if (strlen(path) < sizeof(serv_addr.sun_path))
 	{
-		if (g_strcmp0("name", contentssplit[i]) == 0)
-		{
-			*procs = createnewproceslist(*procs);
-			(*procs)->name = contentssplit[i + 1];
-			state = 1;
-		}
-		else if (g_strcmp0("pid", contentssplit[i]) == 0)
+		strcpy(serv_addr.sun_path, path);
+		*sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (*sockfd >= 0)
 		{
-			if (state == 1)
+			connected = connect(*sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) == 0;
+			if (!connected)
 			{
-				(*procs)->pid = atoi(contentssplit[i + 1]);
-				state = 0;
+				close(*sockfd);
+				*sockfd = -1;
 			}
 		}
-		i++;
 	}
+	g_free(path);
+
+	return connected;
 }
 
 int gm_socket_connect_to_gappman(int portno, const char *hostname, int *sockfd)
@@ -148,6 +373,15 @@ int gm_socket_connect_to_gappman(int portno, const char *hostname, int *sockfd)
 	struct sockaddr_in serv_addr;
 	struct hostent *server;
 
+	if ((hostname == NULL || g_strcmp0(hostname, "localhost") == 0) && connect_unix(sockfd))
+	{
+		return GM_SUCCESS;
+	}
+	if (hostname == NULL)
+	{
+		hostname = "localhost";
+	}
+
 	*sockfd = socket(AF_INET, SOCK_STREAM, 0);
 	if (*sockfd < 0)
 	{
@@ -163,7 +397,7 @@ int gm_socket_connect_to_gappman(int portno, const char *hostname, int *sockfd)
 
 	memset((char *)&serv_addr, 0, sizeof(serv_addr));
 	serv_addr.sin_family = AF_INET;
-	memcpy((char *)server->h_addr, (char *)&serv_addr.sin_addr.s_addr,
+	memcpy((char *)&serv_addr.sin_addr.s_addr, (char *)server->h_addr,
 		   server->h_length);
 	serv_addr.sin_port = htons(portno);
 
@@ -173,82 +407,43 @@ int gm_socket_connect_to_gappman(int portno, const char *hostname, int *sockfd)
 		return GM_COULD_NOT_CONNECT;
 	}
 
-	return GM_SUCCES;
+	return GM_SUCCESS;
 }
 
 int gm_socket_get_started_procs_from_gappman(int portno, const char *hostname,
 											 struct proceslist **startedprocs)
 {
-	gsize len;
-	gchar *msg;
 	int status;
-	gsize bytes_written;
-	GIOChannel *gio = NULL;
-	GError *gerror = NULL;
-
-	status = create_gio_channel(portno, hostname, &gio);
-	if (status != GM_SUCCES)
-		return status;
-
-	msg = g_strdup("::listprocesses::\n");
-	status =
-		g_io_channel_write_chars(gio, (const gchar *)msg, -1, &bytes_written,
-								 &gerror);
-	if (status == G_IO_STATUS_ERROR)
-	{
-		g_warning("%s\n", gerror->message);
-		return GM_COULD_NOT_SEND_MESSAGE;
-	}
-
-	g_io_channel_flush(gio, &gerror);
-
-	g_free(msg);
+	gchar *recv_msg;
 
-	while (g_io_channel_read_line(gio, &msg, &len, NULL, &gerror) !=
-		   G_IO_STATUS_EOF)
+	status = send_request(portno, hostname, "::listprocesses::\n", &recv_msg);
+	if (status != GM_SUCCESS)
 	{
-		parseProceslistMessage(startedprocs, msg);
+		return status;
 	}
 
-	status = g_io_channel_shutdown(gio, TRUE, &gerror);
-	if (status == G_IO_STATUS_ERROR)
-	{
-		g_warning("getStartedProcsFromGappman: %s\n", gerror->message);
-		return GM_COULD_NOT_DISCONNECT;
-	}
+	parseProceslistMessage(startedprocs, recv_msg);
+	g_free(recv_msg);
 
-	return GM_SUCCES;
+	return GM_SUCCESS;
 }
 
 GmReturnCode gm_socket_get_confpath_from_gappman(int portno, const char *hostname,
 										gchar ** path)
 {
 	int status;
-	GError *gerror = NULL;
-  gchar *recv_msg;
-	GIOChannel *gio = NULL;
-	
-	status = create_gio_channel(portno, hostname, &gio);
-	if (status != GM_SUCCES)
-		return status;
+	gchar *recv_msg;
 
-	status = send_and_receive_message(gio, &recv_msg, "::showconfpath::\n");
-	if( status != GM_SUCCES )
+	status = send_request(portno, hostname, "::showconfpath::\n", &recv_msg);
+	if( status != GM_SUCCESS )
 	{
 		return status;
 	}
 
 	*path = parse_message(recv_msg, "confpath");
+	g_free(recv_msg);
 
-	status = g_io_channel_shutdown(gio, TRUE, &gerror);
-	if (status == G_IO_STATUS_ERROR)
-	{
-		g_warning("gm_socket_get_confpath_from_gappman: %s\n",
-				  gerror->message);
-		return GM_COULD_NOT_DISCONNECT;
-	}
-
-	return GM_SUCCES;
+	return GM_SUCCESS;
 }
 
 
@@ -256,81 +451,57 @@ int gm_socket_get_fontsize_from_gappman(int portno, const char *hostname,
 										int *fontsize)
 {
 	int status;
-	GError *gerror = NULL;
-  gchar *recv_msg;
-	GIOChannel *gio = NULL;
-
-	status = create_gio_channel(portno, hostname, &gio);
-	if (status != GM_SUCCES)
-		return status;
+	gchar *recv_msg;
+	gchar *size_msg;
 
-	status = send_and_receive_message(gio, &recv_msg, "::showfontsize::\n");
-	if( status != GM_SUCCES )
+	status = send_request(portno, hostname, "::showfontsize::\n", &recv_msg);
+	if( status != GM_SUCCESS )
 	{
 		return status;
 	}
 
-	*fontsize = atoi(parse_message(recv_msg, "fontsize"));
-
-	status = g_io_channel_shutdown(gio, TRUE, &gerror);
-	if (status == G_IO_STATUS_ERROR)
+	size_msg = parse_message(recv_msg, "fontsize");
+	g_free(recv_msg);
+	if (size_msg == NULL)
 	{
-		g_warning("gm_socket_get_fontsize_from_gappman: %s\n",
-				  gerror->message);
-		return GM_COULD_NOT_DISCONNECT;
+		return GM_COULD_NOT_RECEIVE_MESSAGE;
 	}
+	*fontsize = atoi(size_msg);
 
-
-	return GM_SUCCES;
+	return GM_SUCCESS;
 }
 
 int gm_socket_send_and_receive_message(int portno, const char *hostname,
 									   gchar * msg,
 									   void (*callbackfunc) (gchar *))
 {
-	gsize len;
 	int status;
-	gsize bytes_written;
-	GIOChannel *gio = NULL;
-	GError *gerror = NULL;
+	gchar *send_msg;
 	gchar *recv_msg;
 
-	status = create_gio_channel(portno, hostname, &gio);
-	if (status != GM_SUCCES)
-		return status;
-	status =
-		g_io_channel_write_chars(gio, (const gchar *)msg, -1, &bytes_written,
-								 &gerror);
-	if (status == G_IO_STATUS_ERROR)
+	if (g_str_has_suffix(msg, "\n"))
 	{
-		g_warning("gm_socket_send_and_receive_message: %s\n", gerror->message);
-		return GM_COULD_NOT_SEND_MESSAGE;
+		send_msg = g_strdup(msg);
 	}
-
-	status = g_io_channel_flush(gio, &gerror);
-	if (status == G_IO_STATUS_ERROR)
+	else
 	{
-		g_warning("gm_socket_send_and_receive_message: %s\n", gerror->message);
+		send_msg = g_strconcat(msg, "\n", NULL);
 	}
 
-	if (callbackfunc != NULL)
+	status = send_request(portno, hostname, send_msg, &recv_msg);
+	g_free(send_msg);
+	if (status != GM_SUCCESS)
 	{
-		while (g_io_channel_read_line(gio, &recv_msg, &len, NULL, &gerror) !=
-			   G_IO_STATUS_EOF)
-		{
-			g_warning
-				("I should be calling the callback function right now. But my master has not yet implemented this feature!");
-		}
+		return status;
 	}
 
-	status = g_io_channel_shutdown(gio, TRUE, &gerror);
-	if (status == G_IO_STATUS_ERROR)
+	if (callbackfunc != NULL)
 	{
-		g_warning("gm_socket_send_and_receive_message: %s\n", gerror->message);
-		return GM_COULD_NOT_DISCONNECT;
+		callbackfunc(recv_msg);
 	}
+	g_free(recv_msg);
 
-	return GM_SUCCES;
+	return GM_SUCCESS;
 }
 
 int gm_socket_set_default_resolution_for_program(int portno,
@@ -339,97 +510,73 @@ int gm_socket_set_default_resolution_for_program(int portno,
 												 int height)
 {
 	int status;
-	gsize bytes_written;
-	GIOChannel *gio = NULL;
-	GError *gerror = NULL;
 	gchar *msg;
+	gchar *recv_msg;
 
-	status = create_gio_channel(portno, hostname, &gio);
-	if (status != GM_SUCCES)
-		return status;
-	msg = g_strdup_printf("::updateres::%s::%d::%d::", name, width, height);
-	status =
-		g_io_channel_write_chars(gio, (const gchar *)msg, -1, &bytes_written,
-								 &gerror);
-	if (status == G_IO_STATUS_ERROR)
+	msg = g_strdup_printf("::updateres::%s::%d::%d::\n", name, width, height);
+	// the empty reply confirms gappman handled the message
+	status = send_request(portno, hostname, msg, &recv_msg);
+	g_free(msg);
+	if (status != GM_SUCCESS)
 	{
-		g_warning("gm_socket_set_default_resolution_for_program: %s\n",
-				  gerror->message);
-		return GM_COULD_NOT_SEND_MESSAGE;
+		return status;
 	}
+	g_free(recv_msg);
 
-	status = g_io_channel_flush(gio, &gerror);
-	if (status == G_IO_STATUS_ERROR)
-	{
-		g_warning("gm_socket_set_default_resolution_for_program: %s\n",
-				  gerror->message);
-	}
+	return GM_SUCCESS;
+}
 
-	g_free(msg);
+GmReturnCode gm_socket_stop_processes_in_gappman(int portno, const char *hostname,
+										int *killed)
+{
+	int status;
+	gchar *recv_msg;
+	gchar *killed_msg;
 
-	status = g_io_channel_shutdown(gio, TRUE, &gerror);
-	if (status == G_IO_STATUS_ERROR)
+	// gappman replies when all programs exited
+	status = send_request(portno, hostname, "::stopprocesses::\n", &recv_msg);
+	if( status != GM_SUCCESS )
 	{
-		g_warning("gm_socket_set_default_resolution_for_program: %s\n",
-				  gerror->message);
-		return GM_COULD_NOT_DISCONNECT;
+		return status;
 	}
 
-	return GM_SUCCES;
+	killed_msg = parse_message(recv_msg, "killed");
+	*killed = killed_msg != NULL ? atoi(killed_msg) : 0;
+	g_free(recv_msg);
+
+	return GM_SUCCESS;
 }
 
 #if defined(DEBUG)
 int gm_socket_get_window_geometry_from_gappman(int portno, const char *hostname, int *width, int *height)
 {
 	int status;
-  int i;
-	GError *gerror = NULL;
-  gchar *recv_msg;
-  gchar *geom_msg = NULL;
-  gchar **contentssplit = NULL;
-	GIOChannel *gio = NULL;
-
-	status = create_gio_channel(portno, hostname, &gio);
-	if (status != GM_SUCCES)
-		return status;
+	gchar *recv_msg;
+	gchar *geom_msg = NULL;
+	gchar **contentssplit = NULL;
 
-	status = send_and_receive_message(gio, &recv_msg, "::showwindowgeometry::\n");
-	if( status != GM_SUCCES )
+	status = send_request(portno, hostname, "::showwindowgeometry::\n", &recv_msg);
+	if( status != GM_SUCCESS )
 	{
 		return status;
 	}
 
 	geom_msg = parse_message(recv_msg, "windowgeometry");
+	g_free(recv_msg);
 
+	*width = -1;
+	*height = -1;
 	if(geom_msg != NULL)
 	{
-  	contentssplit = g_strsplit(geom_msg, "x", 2);
+		contentssplit = g_strsplit(geom_msg, "x", 2);
 		if((contentssplit[0] != NULL) && (contentssplit[1] != NULL))
 		{
-  		*width = atoi(contentssplit[0]);
-  		*height = atoi(contentssplit[1]);
-		}
-		else
-		{
-			*width = -1;
-			*height = -1;
+			*width = atoi(contentssplit[0]);
+			*height = atoi(contentssplit[1]);
 		}
-	}
-	else
-	{
-		*width = -1;
-		*height = -1;
-	}
-	
-	status = g_io_channel_shutdown(gio, TRUE, &gerror);
-	if (status == G_IO_STATUS_ERROR)
-	{
-		g_warning("gm_socket_get_fontsize_from_gappman: %s\n",
-				  gerror->message);
-		return GM_COULD_NOT_DISCONNECT;
+		g_strfreev(contentssplit);
 	}
 
-	return GM_SUCCES;
+	return GM_SUCCESS;
 }
 #endif
-
@@ -10,21 +10,11 @@
  *
 */
 
-#ifndef __GAPPMAN_CONNECT_H__
-#define __GAPPMAN_CONNECT_H__
+#ifndef __GM_CONNECT_SOCKET_H__
+#define __GM_CONNECT_SOCKET_H__
 
 #include <gm_generic.h>
 
-/**
-* \brief struct to hold the process ID and program name retrieved from Gappman
-*/
-struct proceslist
-{
-	int pid;					///< process ID of proces started by gappman
-	gchar *name;				///< programname as known by gappman
-	struct proceslist *prev;	///< pointer to previous proces in proceslist
-};
-
 /**
 * \brief Connects to gappman and requests the proceslist
 * \param portno portnumber gappman listens to
@@ -82,6 +72,22 @@ int gm_socket_send_and_receive_message(int portno, const char *hostname,
 									   gchar * msg,
 									   void (*callbackfunc) (gchar *));
 
+/**
+* \brief Connects to gappman and stops all programs started by gappman
+* \param portno portnumber gappman listens to
+* \param hostname servername of host that runs gappman
+* \param killed will hold the amount of programs that did not exit in time and were killed
+* \return integer value (GM_*) as defined in libs/generic/gm_generic.h
+*/
+GmReturnCode gm_socket_stop_processes_in_gappman(int portno, const char *hostname,
+										int *killed);
+
+/**
+* \brief closes the connection that is kept open to gappman. The next request
+* opens a new connection.
+*/
+void gm_socket_disconnect_from_gappman();
+
 #if defined(DEBUG)
 /**
 * \brief Connects to gappman and requests gappman's main window height and width
@@ -93,4 +99,4 @@ int gm_socket_send_and_receive_message(int portno, const char *hostname,
 int gm_socket_get_window_geometry_from_gappman(int portno, const char *hostname, int *width, int *height);
 #endif // DEBUG
 
-#endif // __GAPPMAN_CONNECT_H__
+#endif // __GM_CONNECT_SOCKET_H__
@@ -118,6 +118,25 @@ int gm_network_set_default_resolution_for_program(int portno, const char *hostna
 #endif
 }
 
+GmReturnCode gm_network_stop_processes_in_gappman(int portno, const char *hostname,
+								 int *killed)
+{
+#ifdef NO_LISTENER
+	return GM_NET_COMM_NOT_SUPPORTED;
+#elif defined(WITH_DBUS_SUPPORT)
+	return gm_dbus_stop_processes_in_gappman(killed);
+#else
+	return gm_socket_stop_processes_in_gappman(portno, hostname, killed);
+#endif
+}
+
+void gm_network_disconnect_from_gappman()
+{
+#if !defined(NO_LISTENER) && !defined(WITH_DBUS_SUPPORT)
+	gm_socket_disconnect_from_gappman();
+#endif
+}
+
 #if defined(DEBUG)
 int gm_network_get_window_geometry_from_gappman(int portno, const char *hostname, int *width, int *height)
 {
@@ -80,6 +80,7 @@ int gm_network_get_fontsize_from_gappman(int portno, const char *hostname,
 
 /**
 * \brief Connects to gappman. You only need to use this function if your program is using the socket version.
+* If hostname is localhost or NULL the unix domain socket of gappman is tried first.
 * \param portno portnumber gappman listens to
 * \param hostname servername of host that runs gappman
 * \param sockfd pointer to int which will hold the socket filedescriptor
@@ -112,6 +113,24 @@ int gm_network_set_default_resolution_for_program(int portno, const char *hostna
 										  const gchar * name, int width,
 										  int height);
 
+/**
+* \brief Connects to gappman and stops all programs started by gappman. Returns
+* when all programs exited.
+* \param portno	portnumber gappman listens to. Note, this is actually not used when calling this function using the dbus version.
+* \param hostname servername of host that runs gappman. Note, this is actually not used when calling this function using the dbus version.
+* \param killed will hold the amount of programs that did not exit in time and were killed
+* \return integer value (GM_*) as defined in libs/generic/gm_network_generic.h
+*/
+GmReturnCode gm_network_stop_processes_in_gappman(int portno, const char *hostname,
+								 int *killed);
+
+/**
+* \brief closes the connection the socket version keeps open to gappman, so
+* consecutive requests of a program share a single connection. Does nothing
+* when using the dbus version.
+*/
+void gm_network_disconnect_from_gappman();
+
 #if defined(DEBUG)
 /**
 * \brief Connects to gappman and requests gappman's main window height and width
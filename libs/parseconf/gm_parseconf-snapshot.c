@@ -0,0 +1,559 @@
+/**
+ * \file gm_parseconf-snapshot.c
+ *
+ * The snapshot is a single file in $XDG_RUNTIME_DIR, or /dev/shm if that is
+ * not set, or the temporary directory if /dev/shm does not exist, that holds the configuration gappman is running with. All
+ * references inside the snapshot are byte offsets from the start of the
+ * snapshot, so it can be mapped at any address. An offset of 0 represents a
+ * NULL string.
+ *
+ * Readers only accept a snapshot that is a regular file owned by their own
+ * user, not writable by others and published by a process that is still
+ * running.
+ *
+ * Layout: snapshot_header, followed by the element arrays, argument offset
+ * arrays and strings of the programs, actions and panel menus.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <glib.h>
+#include "gm_parseconf-snapshot.h"
+
+#define SNAPSHOT_MAGIC 0x4e534d47	///< "GMSN"
+#define SNAPSHOT_VERSION 2	///< must be raised when the layout of the snapshot changes
+#define SNAPSHOT_ALIGNMENT 8	///< alignment of the structures in the snapshot
+#define SNAPSHOT_AMOUNT_OF_MENUS 3	///< programs, actions and panel
+
+/**
+* \brief serialized gm_launch_profile
+*/
+struct snapshot_profile
+{
+	guint64 cpus;	///< see gm_launch_profile
+	gint64 max_memory;	///< see gm_launch_profile
+	gint64 max_files;	///< see gm_launch_profile
+	gint32 nice;	///< see gm_launch_profile
+	gint32 ionice_class;	///< see gm_launch_profile
+	gint32 ionice_level;	///< see gm_launch_profile
+	gint32 oom_score_adj;	///< see gm_launch_profile
+};
+
+/**
+* \brief serialized gm_menu_element
+*/
+struct snapshot_element
+{
+	struct snapshot_profile profile;	///< only valid if has_profile is 1
+	gint32 has_profile;	///< 1 if the element has a launch profile
+	gint32 app_width;	///< see gm_menu_element
+	gint32 app_height;	///< see gm_menu_element
+	gint32 autostart;	///< see gm_menu_element
+	gint32 autostart_delay;	///< see gm_menu_element
+	gint32 restart_backoff;	///< see gm_menu_element
+	gint32 restart_max_backoff;	///< see gm_menu_element
+	gint32 restart_limit;	///< see gm_menu_element
+	gint32 restart_interval;	///< see gm_menu_element
+	gint32 printlabel;	///< see gm_menu_element
+	gint32 zygote;	///< see gm_menu_element
+	gint32 single_instance;	///< see gm_menu_element
+	gint32 capture;	///< see gm_menu_element
+	gint32 capture_size;	///< see gm_menu_element
+	gint32 capture_rotate_size;	///< see gm_menu_element
+	guint32 name;	///< offset of the name string
+	guint32 exec;	///< offset of the exec string
+	guint32 logo;	///< offset of the logo string
+	guint32 module;	///< offset of the module string
+	guint32 module_conffile;	///< offset of the module_conffile string
+	guint32 autostart_after;	///< offset of the autostart_after string
+	guint32 autostart_ready;	///< offset of the autostart_ready string
+	guint32 restart;	///< offset of the restart string
+	guint32 capture_file;	///< offset of the capture_file string
+	guint32 amount_of_args;	///< amount of arguments
+	guint32 args;	///< offset of the array holding the argument string offsets
+};
+
+/**
+* \brief serialized gm_menu
+*/
+struct snapshot_menu
+{
+	gint32 width_type;	///< GmLengthType of the menu width
+	gint32 width;	///< menu width value
+	gint32 height_type;	///< GmLengthType of the menu height
+	gint32 height;	///< menu height value
+	gint32 max_elts_in_single_box;	///< see gm_menu
+	gint32 vert_alignment;	///< see gm_menu
+	gfloat hor_alignment;	///< see gm_menu
+	guint32 amount_of_elements;	///< amount of elements in the menu
+	guint32 elts;	///< offset of the snapshot_element array
+};
+
+/**
+* \brief start of every snapshot
+*/
+struct snapshot_header
+{
+	guint32 magic;	///< SNAPSHOT_MAGIC
+	guint32 version;	///< SNAPSHOT_VERSION
+	guint32 size;	///< total size of the snapshot in bytes
+	guint32 generation;	///< raised each time the publishing process writes a snapshot
+	gint32 pid;	///< process ID of the publishing process
+	gint32 fontsize;	///< fontsize used by gappman
+	gint32 window_width;	///< width of gappman's main window
+	gint32 window_height;	///< height of gappman's main window
+	guint32 programname;	///< offset of the programname string
+	guint32 cache_location;	///< offset of the cache location string
+	guint32 popup_key;	///< offset of the popup key string
+	guint32 conffile;	///< offset of the configuration file string
+	struct snapshot_menu menus[SNAPSHOT_AMOUNT_OF_MENUS];	///< programs, actions and panel
+};
+
+static gchar *get_snapshot_filename()
+{
+	const gchar *dir;
+
+	// the runtime directory is only accessible by the user itself
+	dir = g_getenv("XDG_RUNTIME_DIR");
+	if (dir == NULL || dir[0] == '\0')
+	{
+		dir = "/dev/shm";
+	}
+	if (!g_file_test(dir, G_FILE_TEST_IS_DIR))
+	{
+		dir = g_get_tmp_dir();
+	}
+
+	return g_strdup_printf("%s/gappman-%d.snapshot", dir, (int)getuid());
+}
+
+/**
+* \brief reserves size zeroed bytes at the end of the snapshot buffer
+* \return offset of the reserved bytes
+*/
+static guint32 put_block(GString *buf, gsize size)
+{
+	guint32 offset;
+
+	while ((buf->len % SNAPSHOT_ALIGNMENT) != 0)
+	{
+		g_string_append_c(buf, '\0');
+	}
+
+	offset = buf->len;
+	g_string_set_size(buf, buf->len + size);
+	memset(buf->str + offset, 0, size);
+
+	return offset;
+}
+
+static guint32 put_string(GString *buf, const gchar *str)
+{
+	guint32 offset;
+
+	if (str == NULL)
+		return 0;
+
+	offset = buf->len;
+	g_string_append_len(buf, str, strlen(str) + 1);
+
+	return offset;
+}
+
+static void put_element(GString *buf, guint32 offset, gm_menu_element *elt)
+{
+	struct snapshot_element *selt;
+	guint32 args;
+	guint32 str;
+	int i;
+
+	args = put_block(buf, elt->amount_of_args * sizeof(guint32));
+	for (i = 0; i < elt->amount_of_args; i++)
+	{
+		str = put_string(buf, elt->args[i]);
+		((guint32 *)(buf->str + args))[i] = str;
+	}
+
+	// buf->str may have moved, so always take a fresh pointer after
+	// appending to the buffer
+	str = put_string(buf, elt->name);
+	((struct snapshot_element *)(buf->str + offset))->name = str;
+	str = put_string(buf, elt->exec);
+	((struct snapshot_element *)(buf->str + offset))->exec = str;
+	str = put_string(buf, elt->logo);
+	((struct snapshot_element *)(buf->str + offset))->logo = str;
+	str = put_string(buf, elt->module);
+	((struct snapshot_element *)(buf->str + offset))->module = str;
+	str = put_string(buf, elt->module_conffile);
+	((struct snapshot_element *)(buf->str + offset))->module_conffile = str;
+	str = put_string(buf, elt->autostart_after);
+	((struct snapshot_element *)(buf->str + offset))->autostart_after = str;
+	str = put_string(buf, elt->autostart_ready);
+	((struct snapshot_element *)(buf->str + offset))->autostart_ready = str;
+	str = put_string(buf, elt->restart);
+	((struct snapshot_element *)(buf->str + offset))->restart = str;
+	str = put_string(buf, elt->capture_file);
+	((struct snapshot_element *)(buf->str + offset))->capture_file = str;
+
+	selt = (struct snapshot_element *)(buf->str + offset);
+	if (elt->profile != NULL)
+	{
+		selt->has_profile = 1;
+		selt->profile.cpus = elt->profile->cpus;
+		selt->profile.max_memory = elt->profile->max_memory;
+		selt->profile.max_files = elt->profile->max_files;
+		selt->profile.nice = elt->profile->nice;
+		selt->profile.ionice_class = elt->profile->ionice_class;
+		selt->profile.ionice_level = elt->profile->ionice_level;
+		selt->profile.oom_score_adj = elt->profile->oom_score_adj;
+	}
+	selt->app_width = elt->app_width;
+	selt->app_height = elt->app_height;
+	selt->autostart = elt->autostart;
+	selt->autostart_delay = elt->autostart_delay;
+	selt->restart_backoff = elt->restart_backoff;
+	selt->restart_max_backoff = elt->restart_max_backoff;
+	selt->restart_limit = elt->restart_limit;
+	selt->restart_interval = elt->restart_interval;
+	selt->printlabel = elt->printlabel;
+	selt->zygote = elt->zygote;
+	selt->single_instance = elt->single_instance;
+	selt->capture = elt->capture;
+	selt->capture_size = elt->capture_size;
+	selt->capture_rotate_size = elt->capture_rotate_size;
+	selt->amount_of_args = elt->amount_of_args;
+	selt->args = args;
+}
+
+static void put_menu(GString *buf, int index, gm_menu *menu)
+{
+	struct snapshot_menu *smenu;
+	guint32 elts;
+	int amount_of_elements;
+	int i;
+
+	amount_of_elements = (menu == NULL) ? 0 : gm_menu_get_amount_of_elements(menu);
+
+	elts = put_block(buf, amount_of_elements * sizeof(struct snapshot_element));
+	for (i = 0; i < amount_of_elements; i++)
+	{
+		put_element(buf, elts + i * sizeof(struct snapshot_element),
+					menu->elts[i]);
+	}
+
+	smenu = &((struct snapshot_header *)buf->str)->menus[index];
+	smenu->amount_of_elements = amount_of_elements;
+	smenu->elts = elts;
+	if (menu != NULL)
+	{
+		smenu->width_type = menu->menu_width.type;
+		smenu->width = menu->menu_width.value;
+		smenu->height_type = menu->menu_height.type;
+		smenu->height = menu->menu_height.value;
+		smenu->max_elts_in_single_box = menu->max_elts_in_single_box;
+		smenu->vert_alignment = menu->vert_alignment;
+		smenu->hor_alignment = menu->hor_alignment;
+	}
+}
+
+static gboolean write_buffer(int fd, const gchar *buf, gsize len)
+{
+	ssize_t written;
+
+	while (len > 0)
+	{
+		written = write(fd, buf, len);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		buf += written;
+		len -= written;
+	}
+
+	return TRUE;
+}
+
+GmReturnCode snapshot_write(struct snapshot_config *config)
+{
+	static guint32 generation = 0;
+	struct snapshot_header *header;
+	GString *buf;
+	gchar *filename;
+	gchar *tmpname;
+	guint32 str;
+	int fd;
+	GmReturnCode status = GM_FAIL;
+
+	buf = g_string_sized_new(4096);
+	put_block(buf, sizeof(struct snapshot_header));
+
+	str = put_string(buf, config->programname);
+	((struct snapshot_header *)buf->str)->programname = str;
+	str = put_string(buf, config->cache_location);
+	((struct snapshot_header *)buf->str)->cache_location = str;
+	str = put_string(buf, config->popup_key);
+	((struct snapshot_header *)buf->str)->popup_key = str;
+	str = put_string(buf, config->conffile);
+	((struct snapshot_header *)buf->str)->conffile = str;
+
+	put_menu(buf, 0, config->programs);
+	put_menu(buf, 1, config->actions);
+	put_menu(buf, 2, config->panel);
+
+	header = (struct snapshot_header *)buf->str;
+	header->magic = SNAPSHOT_MAGIC;
+	header->version = SNAPSHOT_VERSION;
+	header->size = buf->len;
+	header->generation = ++generation;
+	header->pid = getpid();
+	header->fontsize = config->fontsize;
+	header->window_width = config->window_width;
+	header->window_height = config->window_height;
+
+	filename = get_snapshot_filename();
+	tmpname = g_strconcat(filename, ".XXXXXX", NULL);
+
+	// Write to a temporary file and rename it so readers either see the
+	// previous or the new snapshot, never a partially written one.
+	fd = g_mkstemp(tmpname);
+	if (fd < 0)
+	{
+		g_warning("snapshot_write: could not create %s: errno: %d", tmpname, errno);
+	}
+	else
+	{
+		if (write_buffer(fd, buf->str, buf->len) && (fchmod(fd, S_IRUSR) == 0)
+			&& (rename(tmpname, filename) == 0))
+		{
+			status = GM_SUCCESS;
+		}
+		else
+		{
+			g_warning("snapshot_write: could not publish %s: errno: %d", filename, errno);
+			unlink(tmpname);
+		}
+		close(fd);
+	}
+
+	g_free(tmpname);
+	g_free(filename);
+	g_string_free(buf, TRUE);
+
+	return status;
+}
+
+/**
+* \brief returns a copy of the string at offset or NULL if offset is 0 or invalid
+*/
+static gchar *get_string(const gchar *base, gsize size, guint32 offset)
+{
+	if ((offset == 0) || (offset >= size))
+		return NULL;
+
+	if (memchr(base + offset, '\0', size - offset) == NULL)
+		return NULL;
+
+	return g_strdup(base + offset);
+}
+
+static gboolean is_valid_array(gsize size, guint32 offset, guint32 amount,
+							   gsize elt_size)
+{
+	if (amount == 0)
+		return TRUE;
+
+	if ((offset % SNAPSHOT_ALIGNMENT) != 0 || offset >= size)
+		return FALSE;
+
+	return amount <= (size - offset) / elt_size;
+}
+
+static gm_menu_element *get_element(const gchar *base, gsize size,
+									const struct snapshot_element *selt)
+{
+	gm_menu_element *elt;
+	const guint32 *args;
+	guint32 i;
+
+	if (!is_valid_array(size, selt->args, selt->amount_of_args, sizeof(guint32)))
+		return NULL;
+
+	elt = gm_menu_element_create();
+	if (elt == NULL)
+		return NULL;
+
+	if (selt->has_profile == 1)
+	{
+		elt->profile = gm_launch_profile_create();
+		elt->profile->cpus = selt->profile.cpus;
+		elt->profile->max_memory = selt->profile.max_memory;
+		elt->profile->max_files = selt->profile.max_files;
+		elt->profile->nice = selt->profile.nice;
+		elt->profile->ionice_class = selt->profile.ionice_class;
+		elt->profile->ionice_level = selt->profile.ionice_level;
+		elt->profile->oom_score_adj = selt->profile.oom_score_adj;
+	}
+	elt->app_width = selt->app_width;
+	elt->app_height = selt->app_height;
+	elt->autostart = selt->autostart;
+	elt->autostart_delay = selt->autostart_delay;
+	elt->restart_backoff = selt->restart_backoff;
+	elt->restart_max_backoff = selt->restart_max_backoff;
+	elt->restart_limit = selt->restart_limit;
+	elt->restart_interval = selt->restart_interval;
+	elt->printlabel = selt->printlabel;
+	elt->zygote = selt->zygote;
+	elt->single_instance = selt->single_instance;
+	elt->capture = selt->capture;
+	elt->capture_size = selt->capture_size;
+	elt->capture_rotate_size = selt->capture_rotate_size;
+	elt->name = get_string(base, size, selt->name);
+	elt->exec = get_string(base, size, selt->exec);
+	elt->logo = get_string(base, size, selt->logo);
+	elt->module = get_string(base, size, selt->module);
+	elt->module_conffile = get_string(base, size, selt->module_conffile);
+	elt->autostart_after = get_string(base, size, selt->autostart_after);
+	elt->autostart_ready = get_string(base, size, selt->autostart_ready);
+	elt->restart = get_string(base, size, selt->restart);
+	elt->capture_file = get_string(base, size, selt->capture_file);
+
+	args = (const guint32 *)(base + selt->args);
+	for (i = 0; i < selt->amount_of_args; i++)
+	{
+		gm_menu_element_add_argument(get_string(base, size, args[i]), elt);
+	}
+
+	return elt;
+}
+
+static gm_menu *get_menu(const gchar *base, gsize size,
+						 const struct snapshot_menu *smenu)
+{
+	const struct snapshot_element *selts;
+	gm_menu_element *elt;
+	gm_menu *menu;
+	guint32 i;
+
+	if (!is_valid_array(size, smenu->elts, smenu->amount_of_elements,
+						sizeof(struct snapshot_element)))
+		return NULL;
+
+	menu = gm_menu_create();
+	if (menu == NULL)
+		return NULL;
+
+	menu->menu_width.type = smenu->width_type;
+	menu->menu_width.value = smenu->width;
+	menu->menu_height.type = smenu->height_type;
+	menu->menu_height.value = smenu->height;
+	menu->max_elts_in_single_box = smenu->max_elts_in_single_box;
+	menu->vert_alignment = smenu->vert_alignment;
+	menu->hor_alignment = smenu->hor_alignment;
+
+	selts = (const struct snapshot_element *)(base + smenu->elts);
+	for (i = 0; i < smenu->amount_of_elements; i++)
+	{
+		elt = get_element(base, size, &selts[i]);
+		if (!gm_menu_add_menu_element(elt, menu))
+		{
+			g_warning("snapshot_read: failed to add menu_element to menu");
+			gm_menu_element_free(elt);
+		}
+	}
+
+	return menu;
+}
+
+GmReturnCode snapshot_read(struct snapshot_config *config)
+{
+	const struct snapshot_header *header;
+	const gchar *base;
+	gchar *filename;
+	struct stat st;
+	gsize size;
+	int fd;
+
+	filename = get_snapshot_filename();
+	fd = open(filename, O_RDONLY | O_NOFOLLOW);
+	g_free(filename);
+	if (fd < 0)
+		return GM_COULD_NOT_LOAD_FILE;
+
+	if ((fstat(fd, &st) != 0) || (st.st_size < sizeof(struct snapshot_header)))
+	{
+		close(fd);
+		return GM_FAIL;
+	}
+
+	// anyone else could have planted a forged snapshot
+	if (!S_ISREG(st.st_mode) || (st.st_uid != getuid())
+		|| ((st.st_mode & (S_IWGRP | S_IWOTH)) != 0))
+	{
+		g_warning("snapshot_read: ignoring snapshot not owned by uid %u",
+				  (unsigned int)getuid());
+		close(fd);
+		return GM_FAIL;
+	}
+
+	size = st.st_size;
+	base = (const gchar *)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return GM_COULD_NOT_LOAD_FILE;
+
+	header = (const struct snapshot_header *)base;
+	if ((header->magic != SNAPSHOT_MAGIC) || (header->version != SNAPSHOT_VERSION)
+		|| (header->size != size))
+	{
+		g_warning("snapshot_read: ignoring snapshot with unknown format");
+		munmap((void *)base, size);
+		return GM_FAIL;
+	}
+
+	// a snapshot left behind by a gappman that did not exit cleanly is stale
+	if ((header->generation == 0) || (header->pid <= 0)
+		|| (kill(header->pid, 0) != 0))
+	{
+		munmap((void *)base, size);
+		return GM_COULD_NOT_LOAD_FILE;
+	}
+
+	config->fontsize = header->fontsize;
+	config->window_width = header->window_width;
+	config->window_height = header->window_height;
+	config->programname = get_string(base, size, header->programname);
+	config->cache_location = get_string(base, size, header->cache_location);
+	config->popup_key = get_string(base, size, header->popup_key);
+	config->conffile = get_string(base, size, header->conffile);
+	config->programs = get_menu(base, size, &header->menus[0]);
+	config->actions = get_menu(base, size, &header->menus[1]);
+	config->panel = get_menu(base, size, &header->menus[2]);
+
+	munmap((void *)base, size);
+
+	return GM_SUCCESS;
+}
+
+void snapshot_remove()
+{
+	gchar *filename;
+
+	filename = get_snapshot_filename();
+	unlink(filename);
+	g_free(filename);
+}
@@ -0,0 +1,54 @@
+/**
+ * \file gm_parseconf-snapshot.h
+ * \brief serializes the parsed configuration into a shared, read-only snapshot
+ *
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#ifndef __GAPPMAN_PARSECONF_SNAPSHOT_H__
+#define __GAPPMAN_PARSECONF_SNAPSHOT_H__
+
+#include <gm_generic.h>
+
+/**
+* \brief configuration values that are stored in or retrieved from a snapshot
+*/
+struct snapshot_config
+{
+	gchar *programname;	///< name of the program as specified in the configuration file
+	gchar *cache_location;	///< path of the cache location on disk
+	gchar *popup_key;	///< key that brings gappman to the top of the window stack
+	gchar *conffile;	///< configuration file gappman loaded
+	gint fontsize;	///< fontsize used by gappman
+	gint window_width;	///< width of gappman's main window
+	gint window_height;	///< height of gappman's main window
+	gm_menu *programs;	///< programs managed by gappman
+	gm_menu *actions;	///< actions managed by gappman
+	gm_menu *panel;	///< panel elements managed by gappman
+};
+
+/**
+* \brief writes config to a new snapshot and atomically replaces the previous snapshot
+* \param config configuration that should be published
+* \return GM_SUCCESS if the snapshot was published, GM_FAIL otherwise
+*/
+GmReturnCode snapshot_write(struct snapshot_config *config);
+
+/**
+* \brief maps the published snapshot and copies its contents into config.
+* Strings and menus in config are newly allocated.
+* \param config structure that will hold the configuration values
+* \return GM_SUCCESS, GM_COULD_NOT_LOAD_FILE if no snapshot was published or
+* its publisher is no longer running or GM_FAIL if the snapshot is invalid
+*/
+GmReturnCode snapshot_read(struct snapshot_config *config);
+
+/**
+* \brief removes the published snapshot
+*/
+void snapshot_remove();
+
+#endif
@@ -11,16 +11,50 @@
  */
 
 #include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "gm_parseconf.h"
+#include "gm_parseconf-snapshot.h"
 #include <libxml/xmlreader.h>
+#include <libxml/parser.h>
 #include <gm_generic.h>
 
+#define CONF_FRAGMENT_DIR "conf.d" ///< directory next to the configuration file holding the configuration fragments
+
+/**
+* \brief holds the parse result of a single configuration fragment in conf.d
+*/
+struct fragment
+{
+	gchar *filename;	///< absolute or relative path to the fragment
+	time_t mtime;	///< modification time of the fragment when it was parsed
+	off_t size;	///< size of the fragment when it was parsed
+	guint generation;	///< last gm_load_conf run that found this fragment on disk
+	gboolean failed;	///< TRUE if the fragment could not be read or parsed completely
+	gm_menu *programs;	///< programs defined in this fragment
+	gm_menu *actions;	///< actions defined in this fragment
+	gm_menu *panel;	///< panel elements defined in this fragment
+};
+
+static GHashTable *fragments = NULL;	///< parsed fragments indexed by filename
 static gm_menu *programs = NULL;
 static gm_menu *actions = NULL;
 static gm_menu *panel = NULL;
 static char *program_name = NULL;
 static char *cache_location = NULL;
 static char *popup_key = NULL;			//key that will bring GAppMan to top of the window stack
+static gint autostart_concurrency = -1;	///< maximum amount of programs that are autostarted concurrently
+static gboolean zygote = FALSE;	///< TRUE if the configuration file contains a zygote section
+static gboolean tcp_listener = FALSE;	///< TRUE if gappman should also accept connections over TCP
+static gint prefetch_budget = -1;	///< megabytes to prefetch when the menu is idle
+static gint sample_interval = -1;	///< milliseconds between resource usage samples of started programs
+static guint64 housekeeping_cpus = 0;	///< CPUs gappman and its panel should run on, 0 for all
+static GPtrArray *zygote_preload = NULL;	///< libraries the zygote should preload
+static char *conffile = NULL;	///< configuration file gappman loaded. Only set when loaded from a snapshot
+static gint fontsize = -1;	///< fontsize used by gappman. Only set when loaded from a snapshot
+static gint window_width = -1;	///< gappman's main window width. Only set when loaded from a snapshot
+static gint window_height = -1;	///< gappman's main window height. Only set when loaded from a snapshot
 
 static void printElements(xmlTextReaderPtr reader)
 {
@@ -72,6 +106,172 @@ static void parseLength(xmlChar * length, struct length *str_length)
 	}
 }
 
+/**
+* \brief reads the attributes of an autostart element. after holds the name
+* of the program that must be ready first, delay the amount of milliseconds to
+* wait before starting the program and ready how to determine the program is ready.
+* \param reader the XMLtext reader pointing to the autostart element.
+* \param *elt menu_element structure that will contain the attribute values
+*/
+static void processAutostartAttributes(xmlTextReaderPtr reader, gm_menu_element *elt)
+{
+	xmlChar *delay;
+
+	elt->autostart_after = (gchar *) xmlTextReaderGetAttribute(reader, BAD_CAST "after");
+	elt->autostart_ready = (gchar *) xmlTextReaderGetAttribute(reader, BAD_CAST "ready");
+	delay = xmlTextReaderGetAttribute(reader, BAD_CAST "delay");
+	if (delay != NULL)
+	{
+		elt->autostart_delay = atoi((const char *) delay);
+		xmlFree(delay);
+	}
+}
+
+/**
+* \brief reads the attributes of a restart element. backoff holds the
+* milliseconds to wait before the first restart, maxbackoff the maximum
+* milliseconds to wait, limit the maximum amount of restarts within interval
+* seconds.
+* \param reader the XMLtext reader pointing to the restart element.
+* \param *elt menu_element structure that will contain the attribute values
+*/
+static void processRestartAttributes(xmlTextReaderPtr reader, gm_menu_element *elt)
+{
+	const char *attributes[] = { "backoff", "maxbackoff", "limit", "interval" };
+	gint *values[] = { &elt->restart_backoff, &elt->restart_max_backoff,
+		&elt->restart_limit, &elt->restart_interval };
+	xmlChar *value;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(attributes); i++)
+	{
+		value = xmlTextReaderGetAttribute(reader, BAD_CAST attributes[i]);
+		if (value != NULL)
+		{
+			*values[i] = atoi((const char *) value);
+			xmlFree(value);
+		}
+	}
+}
+
+/**
+* \brief reads the attributes of a capture element. size holds the kilobytes
+* of output kept in memory, file the file the output is also written to and
+* rotatesize the kilobytes after which that file is rotated.
+* \param reader the XMLtext reader pointing to the capture element.
+* \param *elt menu_element structure that will contain the attribute values
+*/
+static void processCaptureAttributes(xmlTextReaderPtr reader, gm_menu_element *elt)
+{
+	xmlChar *value;
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "size");
+	if (value != NULL)
+	{
+		elt->capture_size = atoi((const char *) value);
+		xmlFree(value);
+	}
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "rotatesize");
+	if (value != NULL)
+	{
+		elt->capture_rotate_size = atoi((const char *) value);
+		xmlFree(value);
+	}
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "file");
+	if (value != NULL)
+	{
+		free(elt->capture_file);
+		elt->capture_file = (gchar *) value;
+	}
+}
+
+/**
+* \brief reads the attributes of a profile element:
+* - cpus: CPUs the program may run on, e.g. "2,3" or "1-3"
+* - nice: nice value
+* - ionice: "realtime:LEVEL", "best-effort:LEVEL" or "idle"
+* - maxmemory: maximum address space in bytes, RLIMIT_AS
+* - maxfiles: maximum amount of open files, RLIMIT_NOFILE
+* - oomscoreadj: value for /proc/PID/oom_score_adj
+* \param reader the XMLtext reader pointing to the profile element.
+* \param *elt menu_element structure that will contain the profile
+*/
+static void processProfileAttributes(xmlTextReaderPtr reader, gm_menu_element *elt)
+{
+	gm_launch_profile *profile;
+	xmlChar *value;
+
+	if (elt->profile == NULL)
+	{
+		elt->profile = gm_launch_profile_create();
+	}
+	profile = elt->profile;
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "cpus");
+	if (value != NULL)
+	{
+		profile->cpus = gm_launch_profile_parse_cpus((const gchar *) value);
+		if (profile->cpus == 0)
+		{
+			g_warning("Could not parse cpus %s of %s", value, elt->name);
+		}
+		xmlFree(value);
+	}
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "nice");
+	if (value != NULL)
+	{
+		profile->nice = atoi((const char *) value);
+		xmlFree(value);
+	}
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "ionice");
+	if (value != NULL)
+	{
+		if (strcmp((const char *) value, "idle") == 0)
+		{
+			profile->ionice_class = 3;
+			profile->ionice_level = 0;
+		}
+		else if (sscanf((const char *) value, "realtime:%d", &profile->ionice_level) == 1)
+		{
+			profile->ionice_class = 1;
+		}
+		else if (sscanf((const char *) value, "best-effort:%d", &profile->ionice_level) == 1)
+		{
+			profile->ionice_class = 2;
+		}
+		else
+		{
+			g_warning("Could not parse ionice %s of %s", value, elt->name);
+		}
+		xmlFree(value);
+	}
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "maxmemory");
+	if (value != NULL)
+	{
+		profile->max_memory = g_ascii_strtoll((const gchar *) value, NULL, 10);
+		xmlFree(value);
+	}
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "maxfiles");
+	if (value != NULL)
+	{
+		profile->max_files = g_ascii_strtoll((const gchar *) value, NULL, 10);
+		xmlFree(value);
+	}
+
+	value = xmlTextReaderGetAttribute(reader, BAD_CAST "oomscoreadj");
+	if (value != NULL)
+	{
+		profile->oom_score_adj = atoi((const char *) value);
+		xmlFree(value);
+	}
+}
+
 /**
 * \brief process a program element from the XML configuration file.
 * \param reader the XMLtext reader pointing to the configuration file.
@@ -97,6 +297,22 @@ processMenuElement(xmlTextReaderPtr reader, gm_menu_element *elt,
 		if (xmlTextReaderNodeType(reader) == 1)
 		{
 			name = xmlTextReaderName(reader);
+			if (strcmp((char *)name, "autostart") == 0)
+			{
+				processAutostartAttributes(reader, elt);
+			}
+			else if (strcmp((char *)name, "restart") == 0)
+			{
+				processRestartAttributes(reader, elt);
+			}
+			else if (strcmp((char *)name, "profile") == 0)
+			{
+				processProfileAttributes(reader, elt);
+			}
+			else if (strcmp((char *)name, "capture") == 0)
+			{
+				processCaptureAttributes(reader, elt);
+			}
 		}
 		else if (xmlTextReaderNodeType(reader) == 3)
 		{
@@ -127,6 +343,22 @@ processMenuElement(xmlTextReaderPtr reader, gm_menu_element *elt,
 			{
 				elt->autostart = atoi((const char *)value);
 			}
+			else if (strcmp((char *)name, "zygote") == 0)
+			{
+				elt->zygote = atoi((const char *)value);
+			}
+			else if (strcmp((char *)name, "restart") == 0)
+			{
+				elt->restart = (gchar *) value;
+			}
+			else if (strcmp((char *)name, "singleinstance") == 0)
+			{
+				elt->single_instance = atoi((const char *)value);
+			}
+			else if (strcmp((char *)name, "capture") == 0)
+			{
+				elt->capture = atoi((const char *)value);
+			}
 			else if (strcmp((char *)name, "resolution") == 0)
 			{
 				if (sscanf
@@ -258,6 +490,331 @@ static void processMenuElements(const char *element_name,
 	}
 }
 
+/**
+* \brief processes the programs, actions or panel group the reader currently points to
+* \param reader the XML reader from libxml
+* \param programs menu that should hold the program elements
+* \param actions menu that should hold the action elements
+* \param panel menu that should hold the panel elements
+* \return TRUE if the reader pointed to a menu group, FALSE otherwise
+*/
+static gboolean processMenuGroup(xmlTextReaderPtr reader, gm_menu *programs,
+								gm_menu *actions, gm_menu *panel)
+{
+	const xmlChar *name;
+
+	if (xmlTextReaderNodeType(reader) != 1)
+		return FALSE;
+
+	name = xmlTextReaderConstName(reader);
+	if (strcmp((char *)name, "programs") == 0)
+	{
+#ifdef DEBUG
+g_debug("gm_load_conf: processing %s", name);
+#endif
+		processMenuElements("program", "programs", reader, programs);
+	}
+	else if (strcmp((char *)name, "actions") == 0)
+	{
+#ifdef DEBUG
+g_debug("gm_load_conf: processing %s", name);
+#endif
+		processMenuElements("action", "actions", reader, actions);
+	}
+	else if (strcmp((char *)name, "panel") == 0)
+	{
+#ifdef DEBUG
+g_debug("gm_load_conf: processing %s", name);
+#endif
+		processMenuElements("applet", "panel", reader, panel);
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+* \brief processes the zygote section of the configuration file. Each preload
+* element holds the path of a library the zygote should load.
+* \param reader the XML reader pointing to the zygote element
+*/
+static void processZygote(xmlTextReaderPtr reader)
+{
+	const xmlChar *name = BAD_CAST "--";
+	int ret = 1;
+
+	zygote = TRUE;
+	if (zygote_preload == NULL)
+	{
+		zygote_preload = g_ptr_array_new();
+	}
+
+	while (ret == 1)
+	{
+		if (xmlTextReaderNodeType(reader) == 1)
+		{
+			name = xmlTextReaderConstName(reader);
+		}
+		else if (xmlTextReaderNodeType(reader) == 3
+				 && strcmp((char *)name, "preload") == 0)
+		{
+			g_ptr_array_add(zygote_preload, xmlTextReaderValue(reader));
+		}
+		else if (xmlTextReaderNodeType(reader) == 15
+				 && strcmp((char *)xmlTextReaderConstName(reader), "zygote") == 0)
+		{
+			break;
+		}
+		ret = xmlTextReaderRead(reader);
+	}
+}
+
+static struct fragment *fragment_create(const gchar *filename, struct stat *st)
+{
+	struct fragment *frag;
+
+	frag = (struct fragment *) g_try_malloc(sizeof(struct fragment));
+	if (frag == NULL)
+		return NULL;
+
+	frag->filename = g_strdup(filename);
+	frag->mtime = st->st_mtime;
+	frag->size = st->st_size;
+	frag->generation = 0;
+	frag->failed = FALSE;
+	frag->programs = gm_menu_create();
+	frag->actions = gm_menu_create();
+	frag->panel = gm_menu_create();
+
+	return frag;
+}
+
+static void fragment_free(struct fragment *frag)
+{
+	gm_menu_free(frag->programs);
+	free(frag->programs);
+	gm_menu_free(frag->actions);
+	free(frag->actions);
+	gm_menu_free(frag->panel);
+	free(frag->panel);
+	g_free(frag->filename);
+	g_free(frag);
+}
+
+/**
+* \brief parses a single configuration fragment. Fragments only contribute
+* programs, actions and panel elements. This function is reentrant and is
+* executed by the fragment thread pool.
+* \param data pointer to the struct fragment that should be parsed
+* \param user_data unused
+*/
+static void parse_fragment(gpointer data, gpointer user_data)
+{
+	struct fragment *frag = (struct fragment *) data;
+	xmlTextReaderPtr reader;
+	int ret;
+
+	reader = xmlReaderForFile(frag->filename, NULL, 0);
+	if (reader == NULL)
+	{
+		g_warning("Unable to open %s\n", frag->filename);
+		frag->failed = TRUE;
+		return;
+	}
+
+	ret = xmlTextReaderRead(reader);
+	while (ret == 1)
+	{
+		processMenuGroup(reader, frag->programs, frag->actions, frag->panel);
+		ret = xmlTextReaderRead(reader);
+	}
+
+	xmlFreeTextReader(reader);
+	if (ret != 0)
+	{
+		g_warning("%s : failed to parse\n", frag->filename);
+		frag->failed = TRUE;
+	}
+}
+
+/**
+* \brief checks whether a fragment should be dropped from the fragment cache.
+* Fragments that failed are parsed again by the next gm_load_conf, the
+* problem may have been fixed without changing the modification time or
+* size, e.g. when the permissions of the fragment changed.
+*/
+static gboolean fragment_is_stale(gpointer key, gpointer value, gpointer generation)
+{
+	struct fragment *frag = (struct fragment *) value;
+
+	return frag->failed || frag->generation != GPOINTER_TO_UINT(generation);
+}
+
+/**
+* \brief appends copies of all elements in src to dest
+*/
+static void merge_menu(gm_menu *src, gm_menu *dest)
+{
+	int i;
+	gm_menu_element *elt;
+
+	for (i = 0; i < gm_menu_get_amount_of_elements(src); i++)
+	{
+		elt = gm_menu_element_copy(src->elts[i]);
+		if (!gm_menu_add_menu_element(elt, dest))
+		{
+			g_warning("merge_menu: failed to add menu_element to menu");
+			gm_menu_element_free(elt);
+		}
+	}
+}
+
+static gint get_number_of_fragment_threads(gint amount_of_fragments)
+{
+	long cpus;
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1)
+		cpus = 1;
+
+	return MIN(cpus, amount_of_fragments);
+}
+
+/**
+* \brief loads all *.xml fragments from the conf.d directory next to filename
+* and merges them, sorted by filename, into programs, actions and panel.
+* Fragments that did not change since the previous call are taken from the
+* fragment cache. Changed fragments are parsed concurrently.
+* \param filename the main configuration file
+*/
+static void load_conf_fragments(const char *filename)
+{
+	static guint generation = 0;
+	gchar *confdir;
+	gchar *fragdir;
+	gchar *path;
+	const gchar *entry;
+	GDir *dir;
+	GSList *names = NULL;
+	GSList *found = NULL;
+	GSList *changed = NULL;
+	GSList *iter;
+	GThreadPool *pool = NULL;
+	struct fragment *frag;
+	struct stat st;
+
+	confdir = g_path_get_dirname(filename);
+	fragdir = g_build_filename(confdir, CONF_FRAGMENT_DIR, NULL);
+	g_free(confdir);
+
+	dir = g_dir_open(fragdir, 0, NULL);
+	if (dir != NULL)
+	{
+		while ((entry = g_dir_read_name(dir)) != NULL)
+		{
+			if (g_str_has_suffix(entry, ".xml"))
+			{
+				names = g_slist_insert_sorted(names, g_strdup(entry),
+											  (GCompareFunc) strcmp);
+			}
+		}
+		g_dir_close(dir);
+	}
+
+	if (fragments == NULL)
+	{
+		fragments = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+										  (GDestroyNotify) fragment_free);
+	}
+	generation++;
+
+	for (iter = names; iter != NULL; iter = iter->next)
+	{
+		path = g_build_filename(fragdir, (gchar *) iter->data, NULL);
+		g_free(iter->data);
+
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			g_free(path);
+			continue;
+		}
+
+		frag = (struct fragment *) g_hash_table_lookup(fragments, path);
+		if ((frag == NULL) || (frag->mtime != st.st_mtime)
+			|| (frag->size != st.st_size))
+		{
+			frag = fragment_create(path, &st);
+			if (frag == NULL)
+			{
+				g_warning("load_conf_fragments: failed to create fragment for %s", path);
+				g_free(path);
+				continue;
+			}
+			g_hash_table_replace(fragments, frag->filename, frag);
+			changed = g_slist_prepend(changed, frag);
+		}
+		g_free(path);
+
+		frag->generation = generation;
+		found = g_slist_prepend(found, frag);
+	}
+	g_slist_free(names);
+	g_free(fragdir);
+
+	if (changed != NULL)
+	{
+		if (g_thread_supported())
+		{
+			pool = g_thread_pool_new(parse_fragment, NULL,
+									 get_number_of_fragment_threads(g_slist_length(changed)),
+									 FALSE, NULL);
+		}
+
+		for (iter = changed; iter != NULL; iter = iter->next)
+		{
+			if ((pool == NULL) || !g_thread_pool_push(pool, iter->data, NULL))
+			{
+				parse_fragment(iter->data, NULL);
+			}
+		}
+
+		// Wait for all fragments to be parsed
+		if (pool != NULL)
+		{
+			g_thread_pool_free(pool, FALSE, TRUE);
+		}
+		g_slist_free(changed);
+	}
+
+	// Merge in filename order so the result does not depend on which
+	// thread finished first
+	found = g_slist_reverse(found);
+	for (iter = found; iter != NULL; iter = iter->next)
+	{
+		frag = (struct fragment *) iter->data;
+		merge_menu(frag->programs, programs);
+		merge_menu(frag->actions, actions);
+		merge_menu(frag->panel, panel);
+	}
+	g_slist_free(found);
+
+	// Forget fragments that were removed from disk or failed
+	g_hash_table_foreach_remove(fragments, fragment_is_stale,
+								GUINT_TO_POINTER(generation));
+}
+
+void gm_parseconf_clear_cache()
+{
+	if (fragments != NULL)
+	{
+		g_hash_table_destroy(fragments);
+		fragments = NULL;
+	}
+}
+
 gchar *gm_parseconf_get_cache_location()
 {
 	return cache_location;
@@ -273,6 +830,112 @@ gchar *gm_parseconf_get_programname()
 	return program_name;
 }
 
+gchar *gm_parseconf_get_conffile()
+{
+	return conffile;
+}
+
+gint gm_parseconf_get_fontsize()
+{
+	return fontsize;
+}
+
+void gm_parseconf_get_window_geometry(gint *width, gint *height)
+{
+	*width = window_width;
+	*height = window_height;
+}
+
+GmReturnCode gm_parseconf_publish_snapshot(const gchar *filename, gint size,
+										   gint width, gint height)
+{
+	struct snapshot_config snapshot;
+
+	snapshot.programname = program_name;
+	snapshot.cache_location = cache_location;
+	snapshot.popup_key = popup_key;
+	snapshot.conffile = (gchar *)filename;
+	snapshot.fontsize = size;
+	snapshot.window_width = width;
+	snapshot.window_height = height;
+	snapshot.programs = programs;
+	snapshot.actions = actions;
+	snapshot.panel = panel;
+
+	return snapshot_write(&snapshot);
+}
+
+void gm_parseconf_remove_snapshot()
+{
+	snapshot_remove();
+}
+
+GmReturnCode gm_load_conf_snapshot()
+{
+	struct snapshot_config snapshot;
+	GmReturnCode status;
+
+	status = snapshot_read(&snapshot);
+	if (status != GM_SUCCESS)
+		return status;
+
+	program_name = snapshot.programname;
+	cache_location = snapshot.cache_location;
+	popup_key = snapshot.popup_key;
+	conffile = snapshot.conffile;
+	fontsize = snapshot.fontsize;
+	window_width = snapshot.window_width;
+	window_height = snapshot.window_height;
+	programs = snapshot.programs;
+	actions = snapshot.actions;
+	panel = snapshot.panel;
+
+	return GM_SUCCESS;
+}
+
+gint gm_parseconf_get_autostart_concurrency()
+{
+	return autostart_concurrency;
+}
+
+gint gm_parseconf_get_prefetch_budget()
+{
+	return prefetch_budget;
+}
+
+gint gm_parseconf_get_sample_interval()
+{
+	return sample_interval;
+}
+
+guint64 gm_parseconf_get_housekeeping_cpus()
+{
+	return housekeeping_cpus;
+}
+
+gboolean gm_parseconf_get_zygote()
+{
+	return zygote;
+}
+
+gboolean gm_parseconf_get_tcp_listener()
+{
+	return tcp_listener;
+}
+
+gchar **gm_parseconf_get_zygote_preload()
+{
+	if (zygote_preload == NULL || zygote_preload->len == 0)
+	{
+		return NULL;
+	}
+
+	// keep the array NULL terminated without counting the terminator
+	g_ptr_array_add(zygote_preload, NULL);
+	g_ptr_array_remove_index(zygote_preload, zygote_preload->len - 1);
+	return (gchar **) zygote_preload->pdata;
+}
+
 gm_menu *gm_get_programs()
 {
 	return programs;
@@ -293,6 +956,7 @@ int gm_load_conf(const char *filename)
 	xmlTextReaderPtr reader;
 	int ret;
 	xmlChar *name;
+	xmlChar *value;
 
 	// Initialize
 	programs = gm_menu_create();
@@ -300,6 +964,22 @@ int gm_load_conf(const char *filename)
 	panel = gm_menu_create();
 	cache_location = NULL;
 	program_name = NULL;
+	autostart_concurrency = -1;
+	prefetch_budget = -1;
+	sample_interval = -1;
+	housekeeping_cpus = 0;
+	zygote = FALSE;
+	tcp_listener = FALSE;
+	if (zygote_preload != NULL)
+	{
+		g_ptr_array_foreach(zygote_preload, (GFunc) xmlFree, NULL);
+		g_ptr_array_free(zygote_preload, TRUE);
+		zygote_preload = NULL;
+	}
+
+	// Must be called from the main thread before fragments are parsed
+	// concurrently
+	xmlInitParser();
 
 	reader = xmlReaderForFile(filename, NULL, 0);
 	if (reader != NULL)
@@ -312,47 +992,87 @@ int gm_load_conf(const char *filename)
 		while (ret == 1)
 		{
 			name = xmlTextReaderName(reader);
-			if (strcmp((char *)name, "programs") == 0
-				&& xmlTextReaderNodeType(reader) == 1)
-			{
-#ifdef DEBUG
-g_debug("gm_load_conf: processing %s", name);
-#endif
-				processMenuElements("program", "programs", reader, programs);
-			}
-			else if (strcmp((char *)name, "actions") == 0
-					 && xmlTextReaderNodeType(reader) == 1)
-			{
-#ifdef DEBUG
-g_debug("gm_load_conf: processing %s", name);
-#endif
-				processMenuElements("action", "actions", reader, actions);
-			}
-			else if (strcmp((char *)name, "panel") == 0
-					 && xmlTextReaderNodeType(reader) == 1)
-			{
-#ifdef DEBUG
-g_debug("gm_load_conf: processing %s", name);
-#endif
-				processMenuElements("applet", "panel", reader, panel);
-			} 
-			else if (strcmp((char *)name, "cachelocation") == 0
-				&& xmlTextReaderNodeType(reader) == 1)
+			// the elements of a menu group are processed as a whole
+			if (!processMenuGroup(reader, programs, actions, panel))
 			{
-				ret = xmlTextReaderRead(reader);
-				cache_location = (char *)xmlTextReaderValue(reader);
+				if (strcmp((char *)name, "cachelocation") == 0
+					&& xmlTextReaderNodeType(reader) == 1)
+				{
+					ret = xmlTextReaderRead(reader);
+					cache_location = (char *)xmlTextReaderValue(reader);
 #ifdef DEBUG
 g_debug("gm_load_conf: cache_location=%s", cache_location);
 #endif
-			}
-			else if (strcmp((char *)name, "popupkey") == 0
-        && xmlTextReaderNodeType(reader) == 1)
-      {
-				ret = xmlTextReaderRead(reader);
-				popup_key = (char *)xmlTextReaderValue(reader);
+				}
+				else if (strcmp((char *)name, "popupkey") == 0
+					&& xmlTextReaderNodeType(reader) == 1)
+				{
+					ret = xmlTextReaderRead(reader);
+					popup_key = (char *)xmlTextReaderValue(reader);
 #ifdef DEBUG
 g_debug("gm_load_conf: popup_key=%s", popup_key);
 #endif
+				}
+				else if (strcmp((char *)name, "autostartconcurrency") == 0
+					&& xmlTextReaderNodeType(reader) == 1)
+				{
+					ret = xmlTextReaderRead(reader);
+					value = xmlTextReaderValue(reader);
+					if (value != NULL)
+					{
+						autostart_concurrency = atoi((const char *) value);
+						xmlFree(value);
+					}
+				}
+				else if (strcmp((char *)name, "prefetchbudget") == 0
+					&& xmlTextReaderNodeType(reader) == 1)
+				{
+					ret = xmlTextReaderRead(reader);
+					value = xmlTextReaderValue(reader);
+					if (value != NULL)
+					{
+						prefetch_budget = atoi((const char *) value);
+						xmlFree(value);
+					}
+				}
+				else if (strcmp((char *)name, "sampleinterval") == 0
+					&& xmlTextReaderNodeType(reader) == 1)
+				{
+					ret = xmlTextReaderRead(reader);
+					value = xmlTextReaderValue(reader);
+					if (value != NULL)
+					{
+						sample_interval = atoi((const char *) value);
+						xmlFree(value);
+					}
+				}
+				else if (strcmp((char *)name, "housekeepingcpus") == 0
+					&& xmlTextReaderNodeType(reader) == 1)
+				{
+					ret = xmlTextReaderRead(reader);
+					value = xmlTextReaderValue(reader);
+					if (value != NULL)
+					{
+						housekeeping_cpus = gm_launch_profile_parse_cpus((const gchar *) value);
+						xmlFree(value);
+					}
+				}
+				else if (strcmp((char *)name, "zygote") == 0
+					&& xmlTextReaderNodeType(reader) == 1)
+				{
+					processZygote(reader);
+				}
+				else if (strcmp((char *)name, "tcplistener") == 0
+					&& xmlTextReaderNodeType(reader) == 1)
+				{
+					ret = xmlTextReaderRead(reader);
+					value = xmlTextReaderValue(reader);
+					if (value != NULL)
+					{
+						tcp_listener = atoi((const char *) value) != 0;
+						xmlFree(value);
+					}
+				}
 			}
 
 			ret = xmlTextReaderRead(reader);
@@ -366,6 +1086,8 @@ g_debug("gm_load_conf: popup_key=%s", popup_key);
 		{
 			g_warning("%s : failed to parse\n", filename);
 		}
+
+		load_conf_fragments(filename);
 	}
 	else
 	{
@@ -15,11 +15,21 @@
 
 /**
 * \brief load the configuration file and parses it to create the menu_elements structures.
+* Programs, actions and panel elements found in the *.xml fragments in the conf.d
+* directory next to filename are appended in filename order. Fragments are parsed
+* concurrently when threads are initialized and are only parsed again when they
+* changed on disk since the previous call.
 * \param  *filename the name of the configuration file with the path
 * \return int 0 if configuration file was succesfully loaded, >0 otherwise
 */
 int gm_load_conf(const char *filename);
 
+/**
+* \brief releases the parse results of the configuration fragments in conf.d that
+* are kept to speed up subsequent calls to gm_load_conf.
+*/
+void gm_parseconf_clear_cache();
+
 /**
 * \brief returns the menu_elements structure that contains the programs
 * \return pointer to menu_elements structure
@@ -44,6 +54,48 @@ gm_menu *gm_get_panel();
 */
 gchar *gm_parseconf_get_popupkey();
 
+/**
+* \brief Get the maximum amount of programs that should be autostarted concurrently
+* \return amount of programs or -1 if not specified in the configuration file
+*/
+gint gm_parseconf_get_autostart_concurrency();
+
+/**
+* \brief Get the amount of megabytes gappman may prefetch when its menu is idle
+* \return megabytes or -1 if not specified in the configuration file
+*/
+gint gm_parseconf_get_prefetch_budget();
+
+/**
+* \brief Get the amount of milliseconds between resource usage samples of the programs started by gappman
+* \return milliseconds or -1 if not specified in the configuration file
+*/
+gint gm_parseconf_get_sample_interval();
+
+/**
+* \brief Get the CPUs gappman and its panel should be pinned to
+* \return mask with bit n set for CPU n, or 0 if not specified in the configuration file
+*/
+guint64 gm_parseconf_get_housekeeping_cpus();
+
+/**
+* \brief Checks if the configuration file enables the zygote
+* \return TRUE if the configuration file contains a zygote section, FALSE otherwise
+*/
+gboolean gm_parseconf_get_zygote();
+
+/**
+* \brief Checks if gappman should accept connections over TCP besides its unix domain socket
+* \return TRUE if the configuration file enables the TCP listener, FALSE otherwise
+*/
+gboolean gm_parseconf_get_tcp_listener();
+
+/**
+* \brief Get the libraries the zygote should preload
+* \return NULL terminated array of library paths or NULL if no libraries were specified
+*/
+gchar **gm_parseconf_get_zygote_preload();
+
 /**
 * \brief Get the path of the cache location on disk
 * \return string
@@ -56,4 +108,49 @@ gchar *gm_parseconf_get_cache_location();
 */
 gchar *gm_parseconf_get_programname();
 
+/**
+* \brief Publishes the loaded configuration together with the given layout values
+* as a read-only snapshot in shared memory. Other programs can load the snapshot
+* using gm_load_conf_snapshot. Publishing again replaces the previous snapshot.
+* \param filename the configuration file that was loaded
+* \param size fontsize used by the publishing program
+* \param width width of the main window of the publishing program
+* \param height height of the main window of the publishing program
+* \return GM_SUCCESS if the snapshot was published, GM_FAIL otherwise
+*/
+GmReturnCode gm_parseconf_publish_snapshot(const gchar *filename, gint size,
+										   gint width, gint height);
+
+/**
+* \brief Removes the snapshot published by gm_parseconf_publish_snapshot
+*/
+void gm_parseconf_remove_snapshot();
+
+/**
+* \brief Loads the configuration from the snapshot published by gappman instead of
+* parsing the configuration file. Afterwards gm_get_programs, gm_get_actions,
+* gm_get_panel and the gm_parseconf_get_* functions return the values gappman is running with.
+* \return GM_SUCCESS, GM_COULD_NOT_LOAD_FILE if no running gappman published a snapshot or GM_FAIL if the snapshot could not be read.
+*/
+GmReturnCode gm_load_conf_snapshot();
+
+/**
+* \brief Get the configuration file gappman loaded. Only available after gm_load_conf_snapshot.
+* \return string or NULL
+*/
+gchar *gm_parseconf_get_conffile();
+
+/**
+* \brief Get the fontsize gappman uses. Only available after gm_load_conf_snapshot.
+* \return fontsize or -1
+*/
+gint gm_parseconf_get_fontsize();
+
+/**
+* \brief Get the geometry of gappman's main window. Only available after gm_load_conf_snapshot.
+* \param width will hold the window width or -1
+* \param height will hold the window height or -1
+*/
+void gm_parseconf_get_window_geometry(gint *width, gint *height);
+
 #endif
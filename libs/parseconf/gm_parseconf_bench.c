@@ -0,0 +1,356 @@
+/**
+ * \file gm_parseconf_bench.c
+ * \brief measures parse time, allocations and peak memory of gm_load_conf and gm_menu_free
+ *
+ * Not built by default. Build with "make gm_parseconf_bench" and run with
+ * a configuration file generated by tests/genconf.sh or use tests/benchparseconf.sh.
+ *
+ * The peak heap usage is measured per phase, relative to the heap usage at
+ * the start of the phase. The peak resident set size is that of the whole
+ * process and is only reported once.
+ *
+ * GPL v2
+ *
+ * Authors:
+ *   Martijn Brekhof <m.brekhof@gmail.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <gm_generic.h>
+#include "gm_parseconf.h"
+
+#define DEFAULT_ITERATIONS 10
+
+/**
+* \brief allocation counters of a single measured phase
+*/
+struct counters
+{
+	unsigned long allocs;	///< amount of malloc, calloc, realloc and memalign family calls
+	unsigned long frees;	///< amount of free calls
+	unsigned long long bytes;	///< amount of bytes requested
+	long long live;	///< heap bytes allocated minus heap bytes freed since the phase started
+	long long peak;	///< highest value of live during the phase
+};
+
+/**
+* \brief results of a measured phase over all iterations
+*/
+struct phase
+{
+	const char *name;	///< name of the phase
+	double min_us;	///< fastest iteration in microseconds
+	double max_us;	///< slowest iteration in microseconds
+	double total_us;	///< sum of all iterations in microseconds
+	struct counters count;	///< counters summed over all iterations
+	long long peak;	///< highest peak heap usage of all iterations in bytes
+};
+
+/*
+ * The conf.d fragments are parsed by a thread pool, so the counters are
+ * updated atomically.
+ */
+static struct counters counters;
+static volatile gint counting = 0;
+
+/**
+* \brief adds an allocation of size bytes to the counters
+*/
+static void count_alloc(size_t size)
+{
+	__sync_fetch_and_add(&counters.allocs, 1);
+	__sync_fetch_and_add(&counters.bytes, (unsigned long long) size);
+}
+
+/**
+* \brief adds delta bytes to the heap usage of the phase and raises its peak
+*/
+static void add_live(long long delta)
+{
+	long long live;
+	long long peak;
+
+	live = __sync_add_and_fetch(&counters.live, delta);
+	peak = counters.peak;
+	while ((live > peak) && !__sync_bool_compare_and_swap(&counters.peak, peak, live))
+	{
+		peak = counters.peak;
+	}
+}
+
+#ifdef __GLIBC__
+/*
+ * Count allocations by interposing the allocator. This also catches the
+ * allocations done by libxml2 and glib, including the aligned allocations
+ * of the glib slice allocator. When the benchmark runs under valgrind these
+ * calls end up in valgrind's allocator, which keeps the leak check intact.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+/**
+* \brief counts an allocation of size bytes that returned ptr
+*/
+static void *counted(void *ptr, size_t size)
+{
+	if (g_atomic_int_get(&counting))
+	{
+		count_alloc(size);
+		if (ptr != NULL)
+		{
+			add_live(malloc_usable_size(ptr));
+		}
+	}
+	return ptr;
+}
+
+void *malloc(size_t size)
+{
+	return counted(__libc_malloc(size), size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	return counted(__libc_calloc(nmemb, size), nmemb * size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	size_t old_size;
+	void *result;
+
+	// only realloc(NULL, size) creates a new allocation
+	if (ptr == NULL)
+	{
+		return malloc(size);
+	}
+
+	old_size = malloc_usable_size(ptr);
+	result = __libc_realloc(ptr, size);
+	if (g_atomic_int_get(&counting))
+	{
+		__sync_fetch_and_add(&counters.bytes, (unsigned long long) size);
+		// on failure the old block is kept, realloc(ptr, 0) frees it
+		if (result != NULL)
+		{
+			add_live((long long) malloc_usable_size(result) - (long long) old_size);
+		}
+		else if (size == 0)
+		{
+			add_live(-(long long) old_size);
+		}
+	}
+	return result;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+	return counted(__libc_memalign(alignment, size), size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+void *valloc(size_t size)
+{
+	return memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	void *ptr;
+
+	if ((alignment == 0) || (alignment % sizeof(void *) != 0)
+		|| ((alignment & (alignment - 1)) != 0))
+	{
+		return EINVAL;
+	}
+
+	ptr = memalign(alignment, size);
+	if (ptr == NULL)
+	{
+		return ENOMEM;
+	}
+	*memptr = ptr;
+	return 0;
+}
+
+void free(void *ptr)
+{
+	if (g_atomic_int_get(&counting) && ptr != NULL)
+	{
+		__sync_fetch_and_add(&counters.frees, 1);
+		add_live(-(long long) malloc_usable_size(ptr));
+	}
+	__libc_free(ptr);
+}
+#endif
+
+/**
+* \brief returns the monotonic time in microseconds
+*/
+static double now_us()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static void start_phase()
+{
+	memset(&counters, 0, sizeof(counters));
+	g_atomic_int_set(&counting, 1);
+}
+
+/**
+* \brief stops counting and adds the measured time to phase
+* \param phase the phase that was measured
+* \param start time in microseconds at which the phase started
+*/
+static void stop_phase(struct phase *phase, double start)
+{
+	double elapsed;
+
+	elapsed = now_us() - start;
+	g_atomic_int_set(&counting, 0);
+
+	if ((phase->min_us == 0) || (elapsed < phase->min_us))
+	{
+		phase->min_us = elapsed;
+	}
+	if (elapsed > phase->max_us)
+	{
+		phase->max_us = elapsed;
+	}
+	phase->total_us += elapsed;
+	phase->count.allocs += counters.allocs;
+	phase->count.frees += counters.frees;
+	phase->count.bytes += counters.bytes;
+	if (counters.peak > phase->peak)
+	{
+		phase->peak = counters.peak;
+	}
+}
+
+/**
+* \brief prints the timings and the allocation counters per iteration of phase
+*/
+static void print_phase(struct phase *phase, int iterations)
+{
+	printf("%s: iterations=%d min_us=%.0f mean_us=%.0f max_us=%.0f allocs=%lu frees=%lu bytes=%llu peak_heap_bytes=%lld\n",
+	       phase->name, iterations, phase->min_us,
+	       phase->total_us / iterations, phase->max_us,
+	       phase->count.allocs / iterations, phase->count.frees / iterations,
+	       phase->count.bytes / iterations, phase->peak);
+}
+
+static int menu_length(gm_menu *menu)
+{
+	return menu == NULL ? 0 : menu->amount_of_elements;
+}
+
+static void usage(const char *programname)
+{
+	fprintf(stderr, "usage: %s [-i ITERATIONS] <CONFFILE>\n", programname);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+	struct phase load = { "gm_load_conf", 0, 0, 0, {0, 0, 0, 0, 0}, 0 };
+	struct phase release = { "gm_menu_free", 0, 0, 0, {0, 0, 0, 0, 0}, 0 };
+	struct rusage usage_info;
+	gm_menu *programs;
+	gm_menu *actions;
+	gm_menu *panel;
+	const char *conffile;
+	double start;
+	int iterations = DEFAULT_ITERATIONS;
+	int i;
+
+	if ((argc == 4) && (strcmp(argv[1], "-i") == 0))
+	{
+		iterations = atoi(argv[2]);
+		conffile = argv[3];
+	}
+	else if (argc == 2)
+	{
+		conffile = argv[1];
+	}
+	else
+	{
+		usage(argv[0]);
+	}
+
+	if (iterations < 1)
+	{
+		usage(argv[0]);
+	}
+
+	for (i = 0; i < iterations; i++)
+	{
+		/* every iteration should parse the fragments again */
+		gm_parseconf_clear_cache();
+
+		start_phase();
+		start = now_us();
+		if (gm_load_conf(conffile) != GM_SUCCESS)
+		{
+			g_atomic_int_set(&counting, 0);
+			fprintf(stderr, "Error: failed to load %s\n", conffile);
+			return EXIT_FAILURE;
+		}
+		stop_phase(&load, start);
+
+		programs = gm_get_programs();
+		actions = gm_get_actions();
+		panel = gm_get_panel();
+
+		if (i == 0)
+		{
+			printf("elements: programs=%d actions=%d panel=%d\n",
+			       menu_length(programs), menu_length(actions),
+			       menu_length(panel));
+		}
+
+		start_phase();
+		start = now_us();
+		gm_menu_free(programs);
+		free(programs);
+		gm_menu_free(actions);
+		free(actions);
+		gm_menu_free(panel);
+		free(panel);
+		stop_phase(&release, start);
+	}
+
+	gm_parseconf_clear_cache();
+
+	print_phase(&load, iterations);
+	print_phase(&release, iterations);
+	// summed over all iterations so a leak in any iteration shows up
+	printf("unreleased: allocs=%ld\n",
+	       (long) (load.count.allocs + release.count.allocs)
+	       - (long) (load.count.frees + release.count.frees));
+
+	if (getrusage(RUSAGE_SELF, &usage_info) == 0)
+	{
+		// of the whole run, so it is not attributed to a phase
+		printf("process_peak: maxrss_kb=%ld\n", usage_info.ru_maxrss);
+	}
+
+	return EXIT_SUCCESS;
+}
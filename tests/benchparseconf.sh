@@ -0,0 +1,42 @@
+#!/bin/bash
+#
+# Benchmarks gm_load_conf against synthetic configuration files of
+# increasing size and checks the parser for leaks using valgrind.
+# Requires libs/parseconf/gm_parseconf_bench, build it using
+# "make -C libs/parseconf gm_parseconf_bench".
+
+[ ! -x ./tests/benchparseconf.sh ] && echo "Error: script must be executed from package toplevel directory as follows:
+./tests/benchparseconf.sh" && exit 1
+
+BENCH=./libs/parseconf/gm_parseconf_bench
+[ ! -x $BENCH ] && echo "Error: $BENCH not found. Build it using:
+make -C libs/parseconf gm_parseconf_bench" && exit 1
+
+ITERATIONS=${ITERATIONS:-10}
+WORKDIR=$(mktemp -d /tmp/gappman-bench.XXXXXX) || exit 1
+trap 'rm -rf "$WORKDIR"' EXIT
+
+# <PROGRAMS> <ARGS> <STRINGLENGTH> <FRAGMENTS> <DEPTH>
+SCALES="10 2 32 0 2
+1000 16 128 0 8
+10000 16 128 0 8
+10000 64 1024 0 8
+10000 16 128 16 8
+1000 16 128 0 64"
+
+echo "$SCALES" | while read PROGRAMS ARGS LENGTH FRAGMENTS DEPTH
+do
+	rm -rf "$WORKDIR"/*
+	./tests/genconf.sh -p $PROGRAMS -a $ARGS -l $LENGTH -f $FRAGMENTS -d $DEPTH "$WORKDIR/conf.xml" || exit 1
+
+	echo "== programs=$PROGRAMS args=$ARGS length=$LENGTH fragments=$FRAGMENTS depth=$DEPTH size_kb=$(du -sk "$WORKDIR" | cut -f1)"
+	$BENCH -i $ITERATIONS "$WORKDIR/conf.xml" || exit 1
+
+	# run valgrind on the actual binary instead of the libtool wrapper script
+	if which valgrind > /dev/null 2>&1
+	then
+		./libs/libtool --mode=execute valgrind --leak-check=full \
+			"$BENCH" -i 1 "$WORKDIR/conf.xml" 2>&1 | \
+			grep -E "definitely lost|indirectly lost|total heap usage" | sed 's/^==[0-9]*== */leakcheck: /'
+	fi
+done
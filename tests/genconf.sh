@@ -0,0 +1,153 @@
+#!/bin/bash
+#
+# Generates a synthetic gappman configuration file to measure the cost
+# of parsing the configuration. See tests/benchparseconf.sh.
+
+usage()
+{
+	echo "usage: $0 [-p PROGRAMS] [-a ARGS] [-c ACTIONS] [-n APPLETS] [-d DEPTH] [-l STRINGLENGTH] [-f FRAGMENTS] <OUTPUTFILE>
+
+-p PROGRAMS      amount of programs (default: 2000)
+-a ARGS          amount of arguments per program (default: 16)
+-c ACTIONS       amount of actions (default: 50)
+-n APPLETS       amount of panel applets (default: 50)
+-d DEPTH         nesting depth of the settings of each panel applet (default: 8)
+-l STRINGLENGTH  length of names, paths and arguments (default: 128)
+-f FRAGMENTS     spread the programs over this amount of conf.d fragments
+                 next to OUTPUTFILE (default: 0)"
+	exit 1
+}
+
+PROGRAMS=2000
+ARGS=16
+ACTIONS=50
+APPLETS=50
+DEPTH=8
+LENGTH=128
+FRAGMENTS=0
+
+while getopts "p:a:c:n:d:l:f:h" opt
+do
+	case $opt in
+		p) PROGRAMS=$OPTARG ;;
+		a) ARGS=$OPTARG ;;
+		c) ACTIONS=$OPTARG ;;
+		n) APPLETS=$OPTARG ;;
+		d) DEPTH=$OPTARG ;;
+		l) LENGTH=$OPTARG ;;
+		f) FRAGMENTS=$OPTARG ;;
+		*) usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+[ -z "$1" ] && usage
+OUTPUT=$1
+
+# padding used to create strings of the requested length
+PAD=$(head -c "$LENGTH" /dev/zero | tr '\0' 'x')
+
+# pad <PREFIX>: prints PREFIX padded to LENGTH characters
+pad()
+{
+	local str="$1$PAD"
+	echo "${str:0:$LENGTH}"
+}
+
+# menu_element <TAG> <INDEX> <ARGS>
+menu_element()
+{
+	local i
+	echo "    <$1>"
+	echo "      <name>$(pad "$1-$2-")</name>"
+	echo "      <printlabel>$(( $2 % 2 ))</printlabel>"
+	echo "      <logo>$(pad "/usr/share/gappman/logos/$1-$2-")</logo>"
+	echo "      <resolution>800x600</resolution>"
+	echo "      <exec>$(pad "/usr/bin/$1-$2-")</exec>"
+	for ((i = 0; i < $3; i++))
+	do
+		echo "      <arg>$(pad "--argument-$i=")</arg>"
+	done
+	echo "      <autostart>0</autostart>"
+	echo "    </$1>"
+}
+
+# settings <LEVEL> <INDENT>: prints applet settings nested DEPTH levels
+# deep. The parser has to walk through all of them to find the end of
+# the applet.
+settings()
+{
+	[ "$1" -gt "$DEPTH" ] && return
+	echo "$2<setting level=\"$1\">"
+	echo "$2  <value>$(pad "setting-$1-")</value>"
+	settings $(( $1 + 1 )) "$2  "
+	echo "$2</setting>"
+}
+
+# applet <INDEX>
+applet()
+{
+	echo "    <applet>"
+	echo "      <name>$(pad "applet-$1-")</name>"
+	echo "      <objectfile>$(pad "/usr/lib/gappman/applet-$1-")</objectfile>"
+	echo "      <conffile>$(pad "/etc/gappman/applet-$1-")</conffile>"
+	settings 1 "      "
+	echo "    </applet>"
+}
+
+# programs <FIRST> <LAST>
+programs()
+{
+	local i
+	for ((i = $1; i < $2; i++))
+	do
+		menu_element program $i $ARGS
+	done
+}
+
+MAIN_PROGRAMS=$PROGRAMS
+[ "$FRAGMENTS" -gt 0 ] && MAIN_PROGRAMS=0
+
+{
+	echo '<?xml version="1.0"?>'
+	echo '<appmanager>'
+	echo "  <cachelocation>$(pad /tmp/gappman-cache-)</cachelocation>"
+	echo '  <popupkey>&lt;ctl&gt;g</popupkey>'
+	echo '  <actions width="40%" height="15%" align="top,left">'
+	for ((i = 0; i < ACTIONS; i++))
+	do
+		menu_element action $i 2
+	done
+	echo '  </actions>'
+	echo '  <programs width="100%" height="50%" align="bottom,center" max_elts="12">'
+	programs 0 $MAIN_PROGRAMS
+	echo '  </programs>'
+	echo '  <panel width="40%" height="15%" align="top,right">'
+	for ((i = 0; i < APPLETS; i++))
+	do
+		applet $i
+	done
+	echo '  </panel>'
+	echo '</appmanager>'
+} > "$OUTPUT" || exit 1
+
+if [ "$FRAGMENTS" -gt 0 ]
+then
+	FRAGDIR=$(dirname "$OUTPUT")/conf.d
+	mkdir -p "$FRAGDIR" || exit 1
+	PER_FRAGMENT=$(( (PROGRAMS + FRAGMENTS - 1) / FRAGMENTS ))
+	for ((f = 0; f < FRAGMENTS; f++))
+	do
+		FIRST=$((f * PER_FRAGMENT))
+		LAST=$((FIRST + PER_FRAGMENT))
+		[ $LAST -gt $PROGRAMS ] && LAST=$PROGRAMS
+		{
+			echo '<?xml version="1.0"?>'
+			echo '<appmanager>'
+			echo '  <programs>'
+			programs $FIRST $LAST
+			echo '  </programs>'
+			echo '</appmanager>'
+		} > "$(printf "%s/%04d-programs.xml" "$FRAGDIR" $f)" || exit 1
+	done
+fi
@@ -0,0 +1,101 @@
+#!/bin/bash
+#
+# Checks that a program asking gappman to stop all programs, like the
+# shutdown applet does before it shuts down, is not stopped itself while the
+# other programs are.
+# Requires a built gappman, Xvfb and socat.
+
+[ ! -x ./tests/stopprocesses.sh ] && echo "Error: script must be executed from package toplevel directory as follows:
+./tests/stopprocesses.sh" && exit 1
+
+GAPPMAN=./appmanager/gappman
+[ ! -x $GAPPMAN ] && echo "Error: $GAPPMAN not found. Build gappman first" && exit 1
+
+! which Xvfb > /dev/null 2>&1 && echo "Error: Xvfb not found" && exit 1
+! which socat > /dev/null 2>&1 && echo "Error: socat not found" && exit 1
+
+TMP=$(mktemp -d)
+chmod 700 $TMP
+
+# find a display that is not in use
+DISPLAYNR=99
+while [ -e /tmp/.X11-unix/X$DISPLAYNR ] || [ -e /tmp/.X$DISPLAYNR-lock ]
+do
+	DISPLAYNR=$((DISPLAYNR + 1))
+done
+
+Xvfb :$DISPLAYNR -screen 0 1280x1024x24 -nolisten tcp > /dev/null 2>&1 &
+XVFB=$!
+trap 'kill $GAPPMANPID $XVFB 2> /dev/null; rm -rf $TMP' EXIT
+
+for i in $(seq 50)
+do
+	[ -e /tmp/.X11-unix/X$DISPLAYNR ] && break
+	! kill -0 $XVFB 2> /dev/null && echo "Error: Xvfb failed to start" && exit 1
+	sleep 0.1
+done
+export DISPLAY=:$DISPLAYNR
+# keep gappman's socket out of the runtime directory of the user
+export XDG_RUNTIME_DIR=$TMP
+
+# stands in for the shutdown applet: asks gappman to stop all programs and
+# only "shuts down" if it survived the stop
+cat > $TMP/requester.sh << EOF
+#!/bin/bash
+trap 'echo SIGTERM > $TMP/requester.signal; exit 1' TERM
+sleep 2
+echo "::stopprocesses::" | socat -t 15 - UNIX-CONNECT:$TMP/gappman.sock > $TMP/reply
+echo done > $TMP/requester.done
+EOF
+chmod +x $TMP/requester.sh
+
+cat > $TMP/conf.xml << EOF
+<?xml version="1.0"?>
+<appmanager>
+  <programs width="100%" height="50%" align="bottom,center" max_elts="3">
+    <program>
+      <name>Sleeper</name>
+      <exec>/bin/sleep</exec>
+      <arg>300</arg>
+      <logo>./logos/firefox.png</logo>
+      <autostart>1</autostart>
+    </program>
+    <program>
+      <name>Shutdown</name>
+      <exec>$TMP/requester.sh</exec>
+      <logo>./logos/firefox.png</logo>
+      <autostart>1</autostart>
+    </program>
+  </programs>
+</appmanager>
+EOF
+
+GTK2_RC_FILES=./gtk-config/gtkrc $GAPPMAN --width 640 --height 480 --conffile $TMP/conf.xml --windowed > $TMP/gappman.log 2>&1 &
+GAPPMANPID=$!
+
+for i in $(seq 200)
+do
+	[ -e $TMP/requester.done ] || [ -e $TMP/requester.signal ] && break
+	sleep 0.1
+done
+
+FAILURES=0
+check()
+{
+	if eval "$1"
+	then
+		echo "ok: $2"
+	else
+		echo "FAIL: $2"
+		FAILURES=$((FAILURES + 1))
+	fi
+}
+
+check "[ -e $TMP/requester.done ]" "requester finished after the stop"
+check "[ ! -e $TMP/requester.signal ]" "requester did not get SIGTERM"
+check "grep -q '^killed::0' $TMP/reply" "stop replied without killing programs"
+check "! pgrep -f -x '/bin/sleep 300' > /dev/null" "other program was stopped"
+
+[ $FAILURES -ne 0 ] && cat $TMP/gappman.log
+echo "$FAILURES checks failed"
+[ $FAILURES -eq 0 ]
@@ -0,0 +1,94 @@
+#!/bin/bash
+#
+# Checks that a kept alive connection that subscribes to events gets each
+# event preceded by its length, like the replies before it.
+# Requires a built gappman, Xvfb and socat.
+
+[ ! -x ./tests/subscribe.sh ] && echo "Error: script must be executed from package toplevel directory as follows:
+./tests/subscribe.sh" && exit 1
+
+GAPPMAN=./appmanager/gappman
+[ ! -x $GAPPMAN ] && echo "Error: $GAPPMAN not found. Build gappman first" && exit 1
+
+! which Xvfb > /dev/null 2>&1 && echo "Error: Xvfb not found" && exit 1
+! which socat > /dev/null 2>&1 && echo "Error: socat not found" && exit 1
+
+TMP=$(mktemp -d)
+chmod 700 $TMP
+
+# find a display that is not in use
+DISPLAYNR=99
+while [ -e /tmp/.X11-unix/X$DISPLAYNR ] || [ -e /tmp/.X$DISPLAYNR-lock ]
+do
+	DISPLAYNR=$((DISPLAYNR + 1))
+done
+
+Xvfb :$DISPLAYNR -screen 0 1280x1024x24 -nolisten tcp > /dev/null 2>&1 &
+XVFB=$!
+trap 'kill $GAPPMANPID $XVFB 2> /dev/null; rm -rf $TMP' EXIT
+
+for i in $(seq 50)
+do
+	[ -e /tmp/.X11-unix/X$DISPLAYNR ] && break
+	! kill -0 $XVFB 2> /dev/null && echo "Error: Xvfb failed to start" && exit 1
+	sleep 0.1
+done
+export DISPLAY=:$DISPLAYNR
+# keep gappman's socket out of the runtime directory of the user
+export XDG_RUNTIME_DIR=$TMP
+
+# exits after the subscriber connected, so gappman sends an exited event
+cat > $TMP/conf.xml << EOF
+<?xml version="1.0"?>
+<appmanager>
+  <programs width="100%" height="50%" align="bottom,center" max_elts="3">
+    <program>
+      <name>Sleeper</name>
+      <exec>/bin/sleep</exec>
+      <arg>3</arg>
+      <logo>./logos/firefox.png</logo>
+      <autostart>1</autostart>
+    </program>
+  </programs>
+</appmanager>
+EOF
+
+GTK2_RC_FILES=./gtk-config/gtkrc $GAPPMAN --width 640 --height 480 --conffile $TMP/conf.xml --windowed > $TMP/gappman.log 2>&1 &
+GAPPMANPID=$!
+
+for i in $(seq 50)
+do
+	[ -S $TMP/gappman.sock ] && break
+	sleep 0.1
+done
+
+printf "::keepalive::\n::subscribe::\n" | socat -t 6 - UNIX-CONNECT:$TMP/gappman.sock > $TMP/received
+
+# split the received data into messages using their lengths
+MESSAGES=()
+while read -r LENGTH
+do
+	! [[ "$LENGTH" =~ ^[0-9]+$ ]] && MESSAGES+=("unframed:$LENGTH") && break
+	read -r -N $LENGTH MESSAGE
+	MESSAGES+=("$MESSAGE")
+done < $TMP/received
+
+FAILURES=0
+check()
+{
+	if eval "$1"
+	then
+		echo "ok: $2"
+	else
+		echo "FAIL: $2"
+		FAILURES=$((FAILURES + 1))
+	fi
+}
+
+check "[ \"${MESSAGES[0]}\" = keepalive::1 ]" "keepalive reply is framed"
+check "[ \"${MESSAGES[1]}\" = subscribe::1 ]" "subscribe reply is framed"
+check "[[ \"${MESSAGES[2]}\" == exited::* ]]" "exited event is framed"
+
+[ $FAILURES -ne 0 ] && cat $TMP/received $TMP/gappman.log
+echo "$FAILURES checks failed"
+[ $FAILURES -eq 0 ]
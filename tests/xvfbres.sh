@@ -0,0 +1,50 @@
+#!/bin/bash
+#
+# Switches the resolution of a scratch Xvfb server through all its modes
+# using the gm_changeresolution backend.
+# Requires libs/layout/gm_changeresolution_test, build it using
+# "make -C libs/layout gm_changeresolution_test", and Xvfb. If xrandr is
+# installed a few extra modes are added to the server first.
+
+[ ! -x ./tests/xvfbres.sh ] && echo "Error: script must be executed from package toplevel directory as follows:
+./tests/xvfbres.sh" && exit 1
+
+TEST=./libs/layout/gm_changeresolution_test
+[ ! -x $TEST ] && echo "Error: $TEST not found. Build it using:
+make -C libs/layout gm_changeresolution_test" && exit 1
+
+! which Xvfb > /dev/null 2>&1 && echo "Error: Xvfb not found" && exit 1
+
+# find a display that is not in use
+DISPLAYNR=99
+while [ -e /tmp/.X11-unix/X$DISPLAYNR ] || [ -e /tmp/.X$DISPLAYNR-lock ]
+do
+	DISPLAYNR=$((DISPLAYNR + 1))
+done
+
+Xvfb :$DISPLAYNR -screen 0 1280x1024x24 -nolisten tcp > /dev/null 2>&1 &
+XVFB=$!
+trap 'kill $XVFB 2> /dev/null' EXIT
+
+for i in $(seq 50)
+do
+	[ -e /tmp/.X11-unix/X$DISPLAYNR ] && break
+	! kill -0 $XVFB 2> /dev/null && echo "Error: Xvfb failed to start" && exit 1
+	sleep 0.1
+done
+export DISPLAY=:$DISPLAYNR
+
+# <NAME> <MODELINE>
+MODES="800x600_60.00 38.25 800 832 912 1024 600 603 607 624 -hsync +vsync
+1024x768_60.00 63.50 1024 1072 1176 1328 768 771 775 798 -hsync +vsync"
+
+if which xrandr > /dev/null 2>&1
+then
+	OUTPUT=$(xrandr | awk '/ connected/ { print $1; exit }')
+	echo "$MODES" | while read NAME MODELINE
+	do
+		xrandr --newmode $NAME $MODELINE && xrandr --addmode "$OUTPUT" $NAME
+	done
+fi
+
+$TEST